@@ -10,6 +10,7 @@
 #include <chain/contract_objects.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/contract_worker.hpp>
 
 #include <fc/macros.hpp>
@@ -74,11 +75,10 @@ namespace taiyi { namespace chain {
         const auto* nfa_symbol = _db.find<nfa_symbol_object, by_symbol>(nfa_symbol_name);
         FC_ASSERT(nfa_symbol != nullptr, "NFA symbol named \"${n}\" is not exist.", ("n", nfa_symbol_name));
         
-        const auto* current_trx = _db.get_current_trx_ptr();
-        FC_ASSERT(current_trx);
-        const flat_set<public_key_type>& sigkeys = current_trx->get_signature_keys(_db.get_chain_id(), fc::ecc::fc_canonical);
+        const flat_set<public_key_type>& sigkeys = _db.get_current_trx_signature_keys();
         
-        LuaContext context;
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
         _db.initialize_VM_baseENV(context);
         
         const auto& nfa = _db.create_nfa(creator, *nfa_symbol, sigkeys, true, context);
@@ -101,6 +101,8 @@ namespace taiyi { namespace chain {
         });
         
         _db.initialize_actor_talents(new_actor);
+        _db.adjust_population_stats(new_actor, 1);
+        _db.schedule_actor_tick(new_actor, new_actor.next_tick_time); //新角色的心跳时间为最早时刻，尽快开始心跳
                 
         if( o.fee.amount > 0 ) {
             _db.modify(nfa, [&](nfa_object& obj) {
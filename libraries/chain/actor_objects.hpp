@@ -6,6 +6,8 @@
 
 #include <chain/taiyi_object_types.hpp>
 
+#include <limits>
+
 namespace taiyi { namespace chain {
     
     using chainbase::t_flat_map;
@@ -75,7 +77,7 @@ namespace taiyi { namespace chain {
         uint32_t            pregnant_lock_end_block_num = 0;    //怀孕锁定期结束时间
 
         time_point_sec      last_update;
-        time_point_sec      next_tick_time;
+        time_point_sec      next_tick_time; //要通过 database::schedule_actor_tick 登记到心跳时间轮
 
         E_ACTOR_STANDPOINT_TYPE get_standpoint_type() const {
             if(standpoint <= 124)
@@ -97,7 +99,6 @@ namespace taiyi { namespace chain {
     struct by_base;
     struct by_health;
     struct by_solor_term;
-    struct by_tick_time;
     typedef multi_index_container<
         actor_object,
         indexed_by<
@@ -128,12 +129,6 @@ namespace taiyi { namespace chain {
                     member< actor_object, int, &actor_object::born_vtimes >,
                     member< actor_object, actor_id_type, &actor_object::id >
                 >
-            >,
-            ordered_unique< tag< by_tick_time >,
-                composite_key< actor_object,
-                    member< actor_object, time_point_sec, &actor_object::next_tick_time >,
-                    member< actor_object, actor_id_type, &actor_object::id >
-                >
             >
         >,
         allocator< actor_object >
@@ -176,6 +171,25 @@ namespace taiyi { namespace chain {
 
         time_point_sec      last_update;
         time_point_sec      created;
+        
+        //按序号访问核心属性，序号与 attribute_names 中的名字一一对应
+        static const std::vector<std::string>& attribute_names() {
+            static const std::vector<std::string> names = { "strength", "physique", "agility", "vitality", "comprehension", "willpower", "charm", "mood" };
+            return names;
+        }
+        int16_t get_attribute(uint8_t index) const {
+            switch(index) {
+                case 0: return strength;
+                case 1: return physique;
+                case 2: return agility;
+                case 3: return vitality;
+                case 4: return comprehension;
+                case 5: return willpower;
+                case 6: return charm;
+                case 7: return mood;
+                default: return 0;
+            }
+        }
     };
 
     struct by_actor;
@@ -232,7 +246,7 @@ namespace taiyi { namespace chain {
     public:
         template< typename Constructor, typename Allocator >
         actor_talent_rule_object(Constructor&& c, allocator< Allocator > a)
-            : title(a), description(a)
+            : title(a), description(a), min_attributes(a)
         {
             c(*this);
         }
@@ -246,8 +260,27 @@ namespace taiyi { namespace chain {
         int                 max_triggers = 1;   //最大触发次数
         bool                removed = false;
         
+        //天赋合约在初始化时声明的触发条件，不满足条件的天赋不进入虚拟机运行 trigger 函数
+        uint16_t                        min_trigger_age = 0;    //可触发的最小年龄
+        uint16_t                        max_trigger_age = std::numeric_limits<uint16_t>::max(); //可触发的最大年龄
+        t_flat_map< uint8_t, int16_t >  min_attributes;         //可触发的核心属性下限，键为 actor_core_attributes_object 的属性序号
+        
         time_point_sec      last_update;
         time_point_sec      created;
+        
+        bool can_trigger(uint16_t age, uint16_t trigger_number, const actor_core_attributes_object* attrs) const {
+            if(trigger_number >= max_triggers || age < min_trigger_age || age > max_trigger_age)
+                return false;
+            if(min_attributes.empty())
+                return true;
+            if(attrs == nullptr)
+                return false;
+            for(const auto& p : min_attributes) {
+                if(attrs->get_attribute(p.first) < p.second)
+                    return false;
+            }
+            return true;
+        }
     };
 
     struct by_contract;
@@ -312,7 +345,7 @@ CHAINBASE_SET_INDEX_TYPE(taiyi::chain::actor_core_attributes_object, taiyi::chai
 FC_REFLECT(taiyi::chain::actor_group_object, (id)(actor)(leader))
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::actor_group_object, taiyi::chain::actor_group_index)
 
-FC_REFLECT(taiyi::chain::actor_talent_rule_object, (id)(main_contract)(title)(description)(init_attribute_amount_modifier)(max_triggers)(removed)(last_update)(created))
+FC_REFLECT(taiyi::chain::actor_talent_rule_object, (id)(main_contract)(title)(description)(init_attribute_amount_modifier)(max_triggers)(removed)(min_trigger_age)(max_trigger_age)(min_attributes)(last_update)(created))
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::actor_talent_rule_object, taiyi::chain::actor_talent_rule_index)
 
 FC_REFLECT(taiyi::chain::actor_talents_object, (id)(actor)(talents)(last_update)(created))
@@ -3,9 +3,17 @@
 #include <fc/io/raw.hpp>
 
 #include <boost/thread/mutex.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/interprocess/sync/lock_options.hpp>
 
+#include <zlib.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
 
@@ -17,11 +25,68 @@ namespace taiyi { namespace chain {
 
     namespace detail {
   
+        /* A compressed log starts with this magic, while a raw log starts with the all zero `previous` id of
+         * block 1. Each block of a compressed log is stored as a frame: the packed size (uint32), the
+         * compressed size (uint32) and the zlib compressed packed block, followed by the frame position as usual.
+         */
+        const char     compressed_log_magic[] = { 'T', 'A', 'I', 'Y', 'I', 'B', 'L', 'Z' };
+        const uint64_t compressed_log_header_size = sizeof( compressed_log_magic );
+        const uint64_t frame_header_size = 2 * sizeof( uint32_t );
+
+        std::vector< char > compress_frame( const std::vector< char >& packed )
+        {
+            uLongf compressed_size = compressBound( packed.size() );
+            std::vector< char > frame( frame_header_size + compressed_size );
+            int result = compress2( (Bytef*)frame.data() + frame_header_size, &compressed_size, (const Bytef*)packed.data(), packed.size(), Z_DEFAULT_COMPRESSION );
+            FC_ASSERT( result == Z_OK, "Unable to compress block.", ("result", result) );
+
+            uint32_t sizes[2] = { uint32_t( packed.size() ), uint32_t( compressed_size ) };
+            memcpy( frame.data(), sizes, frame_header_size );
+            frame.resize( frame_header_size + compressed_size );
+            return frame;
+        }
+
+        // Return the packed block of the frame at `frame`, setting frame_size to the bytes the frame occupies
+        std::vector< char > decompress_frame( const char* frame, uint64_t available, uint64_t& frame_size )
+        {
+            FC_ASSERT( available >= frame_header_size, "Truncated block frame." );
+            uint32_t sizes[2];
+            memcpy( sizes, frame, frame_header_size );
+            frame_size = frame_header_size + sizes[1];
+            FC_ASSERT( frame_size <= available, "Truncated block frame.", ("frame_size", frame_size)("available", available) );
+
+            std::vector< char > packed( sizes[0] );
+            uLongf packed_size = sizes[0];
+            int result = uncompress( (Bytef*)packed.data(), &packed_size, (const Bytef*)frame + frame_header_size, sizes[1] );
+            FC_ASSERT( result == Z_OK && packed_size == sizes[0], "Unable to decompress block frame.", ("result", result) );
+            return packed;
+        }
+
+        /* A read only mapping of the block log and its index as of the last remap. Readers hold on to
+         * the view they loaded, so a remap never invalidates memory that is still being read.
+         */
+        struct mapped_view
+        {
+            boost::interprocess::mapped_region  block_region;
+            boost::interprocess::mapped_region  index_region;
+            const char*                         blocks = nullptr;
+            uint64_t                            blocks_size = 0;
+            const uint64_t*                     positions = nullptr;
+            uint32_t                            block_count = 0;
+
+            // Block n (1 based, n <= block_count) ends 8 bytes before the next block starts
+            uint64_t block_end( uint32_t block_num )const
+            {
+                return ( block_num < block_count ? positions[ block_num ] : blocks_size ) - sizeof( uint64_t );
+            }
+        };
+
         class block_log_impl
         {
         public:
             optional< signed_block > head;
             block_id_type            head_id;
+            std::atomic< uint32_t >  head_num{ 0 };
             std::fstream             block_stream;
             std::fstream             index_stream;
             fc::path                 block_file;
@@ -30,9 +95,85 @@ namespace taiyi { namespace chain {
             bool                     index_write = false;
 
             bool                     use_locking = true;
+            bool                     compressed = false;
 
             boost::mutex             mtx;
 
+            std::shared_ptr< const mapped_view > view;   // only accessed through std::atomic_load/atomic_store
+
+            /* Return a view containing block_num and the byte at pos, remapping the files if they grew
+             * since the current view was taken. Only the remap takes the mutex.
+             */
+            std::shared_ptr< const mapped_view > get_view( uint32_t block_num, uint64_t pos = 0 )
+            {
+                auto contains = [&]( const std::shared_ptr< const mapped_view >& v ) {
+                    return v && block_num <= v->block_count && pos < v->blocks_size;
+                };
+
+                auto v = std::atomic_load( &view );
+                if( contains( v ) )
+                    return v;
+
+                scoped_lock lock( mtx );
+                v = std::atomic_load( &view );
+                if( !contains( v ) )
+                    v = remap();
+                FC_ASSERT( contains( v ), "Block log does not contain the requested data.",
+                          ("block_num", block_num)("pos", pos)("block_count", v->block_count)("size", v->blocks_size) );
+                return v;
+            }
+
+            // Requires mtx
+            std::shared_ptr< const mapped_view > remap()
+            { try {
+                if( block_write )
+                    block_stream.flush();
+                if( index_write )
+                    index_stream.flush();
+
+                auto v = std::make_shared< mapped_view >();
+                uint64_t blocks_size = fc::file_size( block_file );
+                uint64_t index_size = fc::file_size( index_file );
+                if( blocks_size > 0 && index_size >= sizeof( uint64_t ) )
+                {
+                    using namespace boost::interprocess;
+                    file_mapping block_mapping( block_file.generic_string().c_str(), read_only );
+                    file_mapping index_mapping( index_file.generic_string().c_str(), read_only );
+                    v->block_region = mapped_region( block_mapping, read_only, 0, blocks_size );
+                    v->index_region = mapped_region( index_mapping, read_only, 0, index_size );
+                    v->blocks = static_cast< const char* >( v->block_region.get_address() );
+                    v->blocks_size = blocks_size;
+                    v->positions = static_cast< const uint64_t* >( v->index_region.get_address() );
+                    v->block_count = index_size / sizeof( uint64_t );
+                }
+
+                std::shared_ptr< const mapped_view > result = v;
+                std::atomic_store( &view, result );
+                return result;
+            } FC_LOG_AND_RETHROW() }
+
+            void reset_view()
+            {
+                std::atomic_store( &view, std::shared_ptr< const mapped_view >() );
+            }
+
+            uint64_t first_block_pos()const
+            {
+                return compressed ? compressed_log_header_size : 0;
+            }
+
+            // The packed bytes of block_num, which must be in the view
+            std::vector< char > packed_block( const mapped_view& v, uint32_t block_num )const
+            {
+                const char* begin = v.blocks + v.positions[ block_num - 1 ];
+                const char* end = v.blocks + v.block_end( block_num );
+                if( !compressed )
+                    return std::vector< char >( begin, end );
+
+                uint64_t frame_size;
+                return decompress_frame( begin, end - begin, frame_size );
+            }
+
             inline void check_block_read()
             { try {
                 if( block_write )
@@ -88,13 +229,15 @@ namespace taiyi { namespace chain {
         flush();
     }
 
-    void block_log::open( const fc::path& file )
+    void block_log::open( const fc::path& file, bool compress_new_log )
     {
         if( my->block_stream.is_open() )
             my->block_stream.close();
         if( my->index_stream.is_open() )
             my->index_stream.close();
         
+        my->reset_view();
+        my->head_num = 0;
         my->block_file = file;
         my->index_file = fc::path( file.generic_string() + ".index" );
         
@@ -124,11 +267,33 @@ namespace taiyi { namespace chain {
         auto log_size = fc::file_size( my->block_file );
         auto index_size = fc::file_size( my->index_file );
 
-        if( log_size )
+        my->compressed = false;
+        if( log_size >= detail::compressed_log_header_size )
+        {
+            my->check_block_read();
+            char magic[ detail::compressed_log_header_size ];
+            my->block_stream.seekg( 0 );
+            my->block_stream.read( magic, sizeof( magic ) );
+            my->compressed = memcmp( magic, detail::compressed_log_magic, sizeof( magic ) ) == 0;
+        }
+        else if( log_size == 0 && compress_new_log )
+        {
+            my->check_block_write();
+            my->block_stream.write( detail::compressed_log_magic, detail::compressed_log_header_size );
+            my->block_stream.flush();
+            my->compressed = true;
+            log_size = detail::compressed_log_header_size;
+        }
+
+        if( compress_new_log != my->compressed && log_size > my->first_block_pos() )
+            wlog( "Keeping the existing ${f} block log format", ("f", my->compressed ? "compressed" : "raw") );
+
+        if( log_size > my->first_block_pos() )
         {
             ilog( "Log is nonempty" );
             my->head = read_head();
             my->head_id = my->head->id();
+            my->head_num = my->head->block_num();
             
             if( index_size )
             {
@@ -182,12 +347,22 @@ namespace taiyi { namespace chain {
     }
     
     uint64_t block_log::append( const signed_block& b )
+    {
+        return append_packed( b, b.id(), fc::raw::pack_to_vector( b ) );
+    }
+    
+    uint64_t block_log::append( const block_state& b )
+    {
+        return append_packed( b.get_block(), b.get_id(), b.get_packed() );
+    }
+    
+    uint64_t block_log::append_packed( const signed_block& b, const block_id_type& id, std::vector< char > data )
     { try {
         scoped_lock lock( my->mtx, defer_lock );
         
         if( my->use_locking )
         {
-            lock.lock();;
+            lock.lock();
         }
         
         my->check_block_write();
@@ -197,12 +372,14 @@ namespace taiyi { namespace chain {
         FC_ASSERT( static_cast<uint64_t>(my->index_stream.tellp()) == sizeof( uint64_t ) * ( b.block_num() - 1 ),
                   "Append to index file occuring at wrong position.",
                   ( "position", (uint64_t) my->index_stream.tellp() )( "expected",( b.block_num() - 1 ) * sizeof( uint64_t ) ) );
-        auto data = fc::raw::pack_to_vector( b );
+        if( my->compressed )
+            data = detail::compress_frame( data );
         my->block_stream.write( data.data(), data.size() );
         my->block_stream.write( (char*)&pos, sizeof( pos ) );
         my->index_stream.write( (char*)&pos, sizeof( pos ) );
         my->head = b;
-        my->head_id = b.id();
+        my->head_id = id;
+        my->head_num = b.block_num();
         
         return pos;
     } FC_LOG_AND_RETHROW() }
@@ -213,7 +390,7 @@ namespace taiyi { namespace chain {
         
         if( my->use_locking )
         {
-            lock.lock();;
+            lock.lock();
         }
         
         my->block_stream.flush();
@@ -221,16 +398,31 @@ namespace taiyi { namespace chain {
     }
 
     std::pair< signed_block, uint64_t > block_log::read_block( uint64_t pos )const
-    {
-        scoped_lock lock( my->mtx, defer_lock );
+    { try {
+        auto view = my->get_view( 0, pos );
         
-        if( my->use_locking )
+        std::pair<signed_block,uint64_t> result;
+        if( my->compressed )
         {
-            lock.lock();;
+            uint64_t frame_size;
+            auto packed = detail::decompress_frame( view->blocks + pos, view->blocks_size - pos, frame_size );
+            result.first = fc::raw::unpack_from_vector< signed_block >( packed );
+            result.second = pos + frame_size + 8;
+            return result;
         }
         
-        return read_block_helper( pos );
-    }
+        fc::datastream< const char* > ds( view->blocks + pos, view->blocks_size - pos );
+        fc::raw::unpack( ds, result.first );
+        result.second = view->blocks_size - ds.remaining() + 8;
+        return result;
+    } FC_LOG_AND_RETHROW() }
+
+    std::vector< char > block_log::read_serialized_block( uint32_t block_num )const
+    { try {
+        FC_ASSERT( block_num > 0 && block_num <= my->head_num.load(), "Block is not in the block log.", ("block_num", block_num) );
+        
+        return my->packed_block( *my->get_view( block_num ), block_num );
+    } FC_LOG_AND_RETHROW() }
 
     std::pair< signed_block, uint64_t > block_log::read_block_helper( uint64_t pos )const
     { try {
@@ -238,52 +430,54 @@ namespace taiyi { namespace chain {
         
         my->block_stream.seekg( pos );
         std::pair<signed_block,uint64_t> result;
-        fc::raw::unpack( my->block_stream, result.first );
+        if( my->compressed )
+        {
+            uint32_t sizes[2];
+            my->block_stream.read( (char*)sizes, detail::frame_header_size );
+            std::vector< char > frame( detail::frame_header_size + sizes[1] );
+            memcpy( frame.data(), sizes, detail::frame_header_size );
+            my->block_stream.read( frame.data() + detail::frame_header_size, sizes[1] );
+            
+            uint64_t frame_size;
+            result.first = fc::raw::unpack_from_vector< signed_block >( detail::decompress_frame( frame.data(), frame.size(), frame_size ) );
+        }
+        else
+        {
+            fc::raw::unpack( my->block_stream, result.first );
+        }
         result.second = uint64_t(my->block_stream.tellg()) + 8;
         return result;
     } FC_LOG_AND_RETHROW() }
 
     optional< signed_block > block_log::read_block_by_num( uint32_t block_num )const
     { try {
-        scoped_lock lock( my->mtx, defer_lock );
+        optional< signed_block > b;
+        if( block_num == 0 || block_num > my->head_num.load() )
+            return b;
         
-        if( my->use_locking )
+        auto view = my->get_view( block_num );
+        signed_block block;
+        if( my->compressed )
         {
-            lock.lock();;
+            block = fc::raw::unpack_from_vector< signed_block >( my->packed_block( *view, block_num ) );
         }
-        
-        optional< signed_block > b;
-        uint64_t pos = get_block_pos_helper( block_num );
-        if( pos != npos )
+        else
         {
-            b = read_block_helper( pos ).first;
-            FC_ASSERT( b->block_num() == block_num , "Wrong block was read from block log.", ( "returned", b->block_num() )( "expected", block_num ));
+            uint64_t pos = view->positions[ block_num - 1 ];
+            fc::datastream< const char* > ds( view->blocks + pos, view->block_end( block_num ) - pos );
+            fc::raw::unpack( ds, block );
         }
+        FC_ASSERT( block.block_num() == block_num , "Wrong block was read from block log.", ( "returned", block.block_num() )( "expected", block_num ));
+        b = std::move( block );
         return b;
     } FC_LOG_AND_RETHROW() }
 
     uint64_t block_log::get_block_pos( uint32_t block_num ) const
-    {
-        scoped_lock lock( my->mtx, defer_lock );
-        
-        if( my->use_locking )
-        {
-            lock.lock();;
-        }
-        
-        return get_block_pos_helper( block_num );
-    }
-
-    uint64_t block_log::get_block_pos_helper( uint32_t block_num ) const
     { try {
-        my->check_index_read();
-        
-        if( !( my->head.valid() && block_num <= protocol::block_header::num_from_id( my->head_id ) && block_num > 0 ) )
+        if( block_num == 0 || block_num > my->head_num.load() )
             return npos;
-        my->index_stream.seekg( sizeof( uint64_t ) * ( block_num - 1 ) );
-        uint64_t pos;
-        my->index_stream.read( (char*)&pos, sizeof( pos ) );
-        return pos;
+        
+        return my->get_view( block_num )->positions[ block_num - 1 ];
     } FC_LOG_AND_RETHROW() }
 
     signed_block block_log::read_head()const
@@ -292,7 +486,7 @@ namespace taiyi { namespace chain {
         
         if( my->use_locking )
         {
-            lock.lock();;
+            lock.lock();
         }
         
         my->check_block_read();
@@ -303,13 +497,23 @@ namespace taiyi { namespace chain {
         return read_block_helper( pos ).first;
     } FC_LOG_AND_RETHROW() }
 
+    bool block_log::is_compressed()const
+    {
+        return my->compressed;
+    }
+    
+    uint32_t block_log::head_block_num()const
+    {
+        return my->head_num.load();
+    }
+    
     const optional< signed_block >& block_log::head()const
     {
         scoped_lock lock( my->mtx, defer_lock );
         
         if( my->use_locking )
         {
-            lock.lock();;
+            lock.lock();
         }
         
         return my->head;
@@ -318,12 +522,13 @@ namespace taiyi { namespace chain {
     void block_log::construct_index()
     { try {
         ilog( "Reconstructing Block Log Index..." );
+        my->reset_view();
         my->index_stream.close();
         fc::remove_all( my->index_file );
         my->index_stream.open( my->index_file.generic_string().c_str(), LOG_WRITE );
         my->index_write = true;
         
-        uint64_t pos = 0;
+        uint64_t pos = my->first_block_pos();
         uint64_t end_pos;
         my->check_block_read();
         
@@ -335,7 +540,16 @@ namespace taiyi { namespace chain {
         
         while( pos < end_pos )
         {
-            fc::raw::unpack( my->block_stream, tmp );
+            if( my->compressed )
+            {
+                uint32_t sizes[2];
+                my->block_stream.read( (char*)sizes, detail::frame_header_size );
+                my->block_stream.seekg( sizes[1], std::ios::cur );
+            }
+            else
+            {
+                fc::raw::unpack( my->block_stream, tmp );
+            }
             my->block_stream.read( (char*)&pos, sizeof( pos ) );
             my->index_stream.write( (char*)&pos, sizeof( pos ) );
         }
@@ -346,4 +560,98 @@ namespace taiyi { namespace chain {
         my->use_locking = true;
     }
     
+    block_prefetcher::block_prefetcher( const block_log& log, uint32_t first, uint32_t last, uint32_t threads, uint32_t capacity )
+    : _log( log ), _last( last ), _capacity( std::max( capacity, 1u ) ), _next_read( first ), _next_consume( first ), _ring( _capacity )
+    {
+        for( uint32_t i = 0; i < std::max( threads, 1u ); ++i )
+            _workers.emplace_back( [this](){ work(); } );
+    }
+    
+    block_prefetcher::~block_prefetcher()
+    {
+        {
+            std::lock_guard< std::mutex > lock( _mtx );
+            _stop = true;
+        }
+        _space_cv.notify_all();
+        
+        for( auto& w : _workers )
+            w.join();
+    }
+    
+    void block_prefetcher::work()
+    {
+        while( true )
+        {
+            uint32_t block_num;
+            {
+                std::unique_lock< std::mutex > lock( _mtx );
+                // Block n reuses the slot of block n - capacity, which must have been consumed already
+                _space_cv.wait( lock, [&]() { return _stop || _error || _next_read > _last || _next_read < _next_consume + _capacity; } );
+                if( _stop || _error || _next_read > _last )
+                    return;
+                block_num = _next_read++;
+            }
+            
+            try
+            {
+                auto start = fc::time_point::now();
+                auto data = _log.read_serialized_block( block_num );
+                auto read_done = fc::time_point::now();
+                
+                auto block = fc::raw::unpack_from_vector< signed_block >( data );
+                FC_ASSERT( block.block_num() == block_num, "Wrong block was read from block log.", ("returned", block.block_num())("expected", block_num) );
+                auto state = block_state::create( std::move( block ), std::move( data ) );
+                auto decode_done = fc::time_point::now();
+                
+                {
+                    std::lock_guard< std::mutex > lock( _mtx );
+                    _ring[ block_num % _capacity ] = std::move( state );
+                    ++_stats.blocks;
+                    _stats.read_time += read_done - start;
+                    _stats.decode_time += decode_done - read_done;
+                }
+            }
+            catch( ... )
+            {
+                std::lock_guard< std::mutex > lock( _mtx );
+                if( !_error )
+                    _error = std::current_exception();
+            }
+            
+            _ready_cv.notify_all();
+        }
+    }
+    
+    block_state_ptr block_prefetcher::next()
+    {
+        std::unique_lock< std::mutex > lock( _mtx );
+        FC_ASSERT( _next_consume <= _last, "No more blocks to prefetch." );
+        
+        auto& slot = _ring[ _next_consume % _capacity ];
+        if( !slot )
+        {
+            auto start = fc::time_point::now();
+            _ready_cv.wait( lock, [&]() { return slot || _error; } );
+            _stats.consumer_wait += fc::time_point::now() - start;
+        }
+        
+        if( !slot )
+            std::rethrow_exception( _error );
+        
+        block_state_ptr block = std::move( slot );
+        slot.reset();
+        ++_next_consume;
+        lock.unlock();
+        
+        _space_cv.notify_all();
+        return block;
+    }
+    
+    block_prefetcher::stats block_prefetcher::get_stats()const
+    {
+        std::lock_guard< std::mutex > lock( _mtx );
+        return _stats;
+    }
+    
 } } // taiyi::chain
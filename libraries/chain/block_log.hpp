@@ -1,6 +1,11 @@
 #pragma once
 #include <fc/filesystem.hpp>
-#include <protocol/block.hpp>
+#include <protocol/block_state.hpp>
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 namespace taiyi { namespace chain {
 
@@ -31,6 +36,12 @@ namespace taiyi { namespace chain {
      *
      * The main file is the only file that needs to persist. The index file can be reconstructed during a
      * linear scan of the main file.
+     *
+     * A log can also be written in a compressed format: it starts with a magic header and every block is a
+     * zlib compressed frame. The index then points at frames and reads decompress transparently.
+     *
+     * Reads are served from read only memory maps of both files and do not take the log lock. The maps are
+     * replaced when a read asks for data appended after the current map was taken.
      */
 
     class block_log
@@ -39,21 +50,35 @@ namespace taiyi { namespace chain {
         block_log();
         ~block_log();
         
-        void open( const fc::path& file );
+        /**
+         * Open or create the log. A new log is created in the compressed format when compress_new_log is set,
+         * an existing log keeps the format it was written in.
+         */
+        void open( const fc::path& file, bool compress_new_log = false );
         void close();
         bool is_open()const;
 
         uint64_t append( const signed_block& b );
+        /** Append a block reusing its cached packed bytes and id. */
+        uint64_t append( const block_state& b );
         void flush();
         std::pair< signed_block, uint64_t > read_block( uint64_t file_pos )const;
         optional< signed_block > read_block_by_num( uint32_t block_num )const;
 
+        /**
+         * Return the packed bytes of a block without unpacking them, so the caller can
+         * deserialize outside of the log lock.
+         */
+        std::vector< char > read_serialized_block( uint32_t block_num )const;
+
         /**
          * Return offset of block in file, or block_log::npos if it does not exist.
          */
         uint64_t get_block_pos( uint32_t block_num ) const;
         signed_block read_head()const;
         const optional< signed_block >& head()const;
+        uint32_t head_block_num()const;
+        bool is_compressed()const;
 
         /*
          * Used by the database to skip locking when reindexing
@@ -67,9 +92,52 @@ namespace taiyi { namespace chain {
         void construct_index();
         
         std::pair< signed_block, uint64_t > read_block_helper( uint64_t file_pos )const;
-        uint64_t get_block_pos_helper( uint32_t block_num ) const;
+        uint64_t append_packed( const signed_block& b, const block_id_type& id, std::vector< char > data );
         
         std::unique_ptr<detail::block_log_impl> my;
     };
 
+    /* Reads the blocks [first, last] of a block log ahead of a single consumer. Worker threads copy the
+     * packed blocks out of the log, unpack them and build their block_state, so ids, digests and merkle roots
+     * are hashed off the consumer thread; at most `capacity` blocks are held ahead of the consumer, which
+     * receives them strictly in block number order.
+     */
+    class block_prefetcher
+    {
+    public:
+        struct stats
+        {
+            uint32_t            blocks = 0;          ///< blocks read and unpacked so far
+            fc::microseconds    read_time;           ///< summed over all workers
+            fc::microseconds    decode_time;         ///< unpacking and hashing, summed over all workers
+            fc::microseconds    consumer_wait;       ///< time the consumer waited for the next block
+        };
+
+        block_prefetcher( const block_log& log, uint32_t first, uint32_t last, uint32_t threads, uint32_t capacity );
+        ~block_prefetcher();
+
+        /* Return the next block in order, rethrowing any error raised by a worker. */
+        block_state_ptr next();
+
+        stats get_stats()const;
+
+    private:
+        void work();
+
+        const block_log&                        _log;
+        const uint32_t                          _last;
+        const uint32_t                          _capacity;
+        uint32_t                                _next_read;
+        uint32_t                                _next_consume;
+        bool                                    _stop = false;
+        std::exception_ptr                      _error;
+        std::vector< block_state_ptr >          _ring;
+        stats                                   _stats;
+
+        mutable std::mutex                      _mtx;
+        std::condition_variable                 _space_cv;
+        std::condition_variable                 _ready_cv;
+        std::vector< std::thread >              _workers;
+    };
+
 } } //taiyi::chain
@@ -9,6 +9,7 @@
 #include <chain/contract_objects.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/contract_worker.hpp>
 
 #include <lua.hpp>
@@ -108,9 +109,7 @@ namespace taiyi { namespace chain {
         const auto& caller = _db.get<account_object, by_name>(o.caller);
         const auto& contract = _db.get<contract_object, by_name>(o.contract_name);
 
-        const auto* current_trx = _db.get_current_trx_ptr();
-        FC_ASSERT(current_trx);
-        const flat_set<public_key_type>& sigkeys = current_trx->get_signature_keys(_db.get_chain_id(), fc::ecc::fc_canonical);
+        const flat_set<public_key_type>& sigkeys = _db.get_current_trx_signature_keys();
         
         //evaluate contract authority
         if(o.caller != TAIYI_COMMITTEE_ACCOUNT)
@@ -127,7 +126,8 @@ namespace taiyi { namespace chain {
                 
         contract_worker worker;
         
-        LuaContext context;
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
         _db.initialize_VM_baseENV(context);
         
         //qi可能在执行合约中被进一步使用，所以这里记录当前的qi来计算虚拟机的执行消耗
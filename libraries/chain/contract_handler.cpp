@@ -14,12 +14,16 @@
 #include <chain/cultivation_objects.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 
 #include <chain/contract_handles.hpp>
 #include <chain/taiyi_geography.hpp>
 
 #include <chain/util/name_generator.hpp>
 
+//合约寻路按每个区域和每条连接收取的drops
+#define TAIYI_ZONE_ROUTE_DROPS_PER_ITEM 1
+
 namespace taiyi { namespace chain {
     
     asset_symbol_type s_get_symbol_type_from_string(const string name)
@@ -106,14 +110,65 @@ namespace taiyi { namespace chain {
     {
         result.contract_name = contract.name;
         account_contract_data_cache = db.prepare_account_contract_data(caller, contract);
-        contract_data_cache = contract.contract_data;
+        
+        //硬分叉0.1之前：构造时取整表快照，析构时用快照整表覆盖，重入调用时以后析构的为准
+        contract_data_snapshot = !db.has_hardfork(TAIYI_HARDFORK_0_1);
+        if (contract_data_snapshot) {
+            load_all_contract_data();
+            account_contract_data_dirty = true;
+        }
     }
     //=============================================================================
     contract_handler::~contract_handler()
     {
-        const auto& acd = db.get<account_contract_data_object, by_account_contract>( boost::make_tuple(caller.id, contract.id) );
-        db.modify(acd, [&](account_contract_data_object &obj) { obj.contract_data = account_contract_data_cache; });
-        db.modify(contract, [&](contract_object& c) { c.contract_data = contract_data_cache; });
+        //整表覆盖：快照和数据库中现有的键都要写回，快照中没有的键被删除
+        if (contract_data_snapshot) {
+            const auto& idx = db.get_index<contract_data_index, by_contract_key>();
+            for (auto itr = idx.lower_bound(contract.id); itr != idx.end() && itr->contract_id == contract.id; ++itr)
+                contract_data_dirty.insert(itr->key);
+            for (const auto& p : contract_data_cache)
+                contract_data_dirty.insert(p.first);
+        }
+        
+        if (account_contract_data_dirty) {
+            const auto& acd = db.get<account_contract_data_object, by_account_contract>( boost::make_tuple(caller.id, contract.id) );
+            db.modify(acd, [&](account_contract_data_object &obj) { obj.contract_data = account_contract_data_cache; });
+        }
+        
+        //只写回修改过的顶层键，合约对象上的统计按数据库中的现值增减，以兼容同一合约被重入调用的情况
+        if (contract_data_dirty.size()) {
+            int64_t count_delta = 0;
+            int64_t size_delta = 0;
+            for (const auto& key : contract_data_dirty) {
+                const auto* cdo = db.find<contract_data_object, by_contract_key>( boost::make_tuple(contract.id, key) );
+                if (cdo) {
+                    count_delta--;
+                    size_delta -= cdo->entry_size();
+                }
+                
+                auto itr = contract_data_cache.find(key);
+                if (itr != contract_data_cache.end()) {
+                    if (cdo)
+                        db.modify(*cdo, [&](contract_data_object& obj) { obj.value = itr->second; });
+                    else {
+                        cdo = &db.create<contract_data_object>([&](contract_data_object& obj) {
+                            obj.contract_id = contract.id;
+                            obj.key = key;
+                            obj.value = itr->second;
+                        });
+                    }
+                    count_delta++;
+                    size_delta += cdo->entry_size();
+                }
+                else if (cdo)
+                    db.remove(*cdo);
+            }
+            
+            db.modify(contract, [&](contract_object& c) {
+                c.contract_data_count += count_delta;
+                c.contract_data_size += size_delta;
+            });
+        }
         
         for (auto c : _sub_chs)
             delete c;
@@ -125,7 +180,110 @@ namespace taiyi { namespace chain {
         uint64_t contract_total_data_size      = 10L * 1024 * 1024;
         uint64_t contract_max_data_size        = 2L * 1024 * 1024 * 1024;
         FC_ASSERT(fc::raw::pack_size(account_contract_data_cache) <= contract_private_data_size, "the contract private data size is too large.");
-        FC_ASSERT(fc::raw::pack_size(contract_data_cache) <= contract_total_data_size, "the contract total data size is too large.");
+        FC_ASSERT(contract_data_pack_size() <= contract_total_data_size, "the contract total data size is too large.");
+    }
+    //=============================================================================
+    uint64_t contract_handler::contract_data_pack_size() const
+    {
+        if (contract_data_snapshot)
+            return fc::raw::pack_size(contract_data_cache);
+        
+        //等价于整个合约数据表的打包大小：数据库中的统计值加上本次调用修改过的键带来的差值
+        int64_t count = contract.contract_data_count;
+        int64_t size = contract.contract_data_size;
+        for (const auto& key : contract_data_dirty) {
+            const auto* cdo = db.find<contract_data_object, by_contract_key>( boost::make_tuple(contract.id, key) );
+            if (cdo) {
+                count--;
+                size -= cdo->entry_size();
+            }
+            
+            auto itr = contract_data_cache.find(key);
+            if (itr != contract_data_cache.end()) {
+                count++;
+                size += fc::raw::pack_size(itr->first) + fc::raw::pack_size(itr->second);
+            }
+        }
+        
+        return fc::raw::pack_size(fc::unsigned_int(uint32_t(count))) + size;
+    }
+    //=============================================================================
+    bool contract_handler::need_all_contract_data(const lua_map& key_list)
+    {
+        //空键表表示整表读写，顶层的start/stop区间读取需要按序遍历，这两种情况都要用到全部数据
+        static auto start_key = lua_key(lua_string("start"));
+        static auto stop_key = lua_key(lua_string("stop"));
+        if (key_list.size() == 0)
+            return true;
+        
+        auto start_itr = key_list.find(start_key);
+        if (start_itr != key_list.end() && start_itr->second.which() == lua_types::tag<lua_int>::value)
+            return true;
+        
+        auto stop_itr = key_list.find(stop_key);
+        if (stop_itr != key_list.end() && stop_itr->second.which() == lua_types::tag<lua_int>::value)
+            return true;
+        
+        return false;
+    }
+    //=============================================================================
+    lua_map contract_handler::fetch_contract_data(const database& db, const contract_object& contract, const lua_map& key_list)
+    {
+        lua_map data;
+        if (need_all_contract_data(key_list)) {
+            const auto& idx = db.get_index<contract_data_index, by_contract_key>();
+            for (auto itr = idx.lower_bound(contract.id); itr != idx.end() && itr->contract_id == contract.id; ++itr)
+                data[itr->key] = itr->value;
+        }
+        else {
+            for (const auto& p : key_list) {
+                const auto* cdo = db.find<contract_data_object, by_contract_key>( boost::make_tuple(contract.id, p.first) );
+                if (cdo)
+                    data[p.first] = cdo->value;
+            }
+        }
+        
+        return data;
+    }
+    //=============================================================================
+    void contract_handler::load_contract_data(const lua_map& key_list)
+    {
+        if (contract_data_all_loaded)
+            return;
+        
+        if (need_all_contract_data(key_list)) {
+            load_all_contract_data();
+            return;
+        }
+        
+        for (const auto& p : key_list)
+            load_contract_data(p.first);
+    }
+    //=============================================================================
+    void contract_handler::load_contract_data(const lua_key& key)
+    {
+        if (contract_data_all_loaded || !contract_data_loaded.insert(key).second)
+            return;
+        
+        const auto* cdo = db.find<contract_data_object, by_contract_key>( boost::make_tuple(contract.id, key) );
+        if (cdo)
+            contract_data_cache[key] = cdo->value;
+    }
+    //=============================================================================
+    void contract_handler::load_all_contract_data()
+    {
+        if (contract_data_all_loaded)
+            return;
+        
+        //已载入的键可能已在本次调用中被修改或删除，不能用数据库中的旧值覆盖
+        const auto& idx = db.get_index<contract_data_index, by_contract_key>();
+        for (auto itr = idx.lower_bound(contract.id); itr != idx.end() && itr->contract_id == contract.id; ++itr) {
+            if (contract_data_loaded.find(itr->key) == contract_data_loaded.end())
+                contract_data_cache[itr->key] = itr->value;
+        }
+        
+        contract_data_all_loaded = true;
+        contract_data_loaded.clear();
     }
     //=============================================================================
     bool contract_handler::is_owner()
@@ -422,9 +580,11 @@ namespace taiyi { namespace chain {
         {
             const auto& contract = db.get<contract_object, by_name>(contract_name);
 
+            lua_map contract_data = fetch_contract_data(db, contract, read_list);
+            
             vector<lua_types> stacks = {};
             lua_map result;
-            read_table_data(result, read_list, contract.contract_data, stacks);
+            read_table_data(result, read_list, contract_data, stacks);
             return result;
         }
         catch (fc::exception e)
@@ -566,13 +726,6 @@ namespace taiyi { namespace chain {
     //=============================================================================
     lua_map contract_handler::eval_nfa_action(int64_t nfa_id, const string& action, const lua_map& params)
     {
-        LuaContext nfa_context;
-        
-        if(lua_getdropsenabled(context.mState)) {
-            lua_enabledrops(nfa_context.mState, 1, 1);
-            lua_setdrops(nfa_context.mState, lua_getdrops(context.mState)); //上层虚拟机还剩下的drops可用
-        }
-
         try
         {
             const nfa_object& nfa = db.get<nfa_object, by_id>(nfa_id);
@@ -588,7 +741,7 @@ namespace taiyi { namespace chain {
             if(abi_itr->second.which() != lua_types::tag<lua_table>::value)
                 return lua_map();
             
-            lua_map action_def = abi_itr->second.get<lua_table>().v;
+            const lua_map& action_def = abi_itr->second.get<lua_table>().v;
             auto def_itr = action_def.find(lua_types(lua_string("consequence")));
             if(def_itr != action_def.end())
                 FC_ASSERT(def_itr->second.get<lua_bool>().v == false, "Can not eval action ${a} in nfa ${nfa} with consequence history. should signing it in transaction.", ("a", action)("nfa", nfa_id));
@@ -610,72 +763,10 @@ namespace taiyi { namespace chain {
                 FC_ASSERT(value_list.size() == func_abi_itr->second.get<lua_function>().arglist.size(), "input values count is ${n}, but ${f}`s parameter list is ${p}...", ("n", value_list.size())("f", function_name)("p", func_abi_itr->second.get<lua_function>().arglist));
             FC_ASSERT(value_list.size() <= 20, "value list is greater than 20 limit");
             
-            auto current_contract_name = context.readVariable<string>("current_contract");
-            auto current_cbi = context.readVariable<contract_base_info*>(current_contract_name, "contract_base_info");
-            auto current_ch = context.readVariable<contract_handler*>(current_contract_name, "contract_helper");
-            const auto &baseENV = db.get<contract_bin_code_object, by_id>(0);
-            
-            const auto& nfa_contract = *contract_ptr;
-            const auto& nfa_contract_owner = db.get<account_object, by_id>(nfa_contract.owner).name;
-            const auto& nfa_contract_code = db.get<contract_bin_code_object, by_id>(nfa_contract.lua_code_b_id);
-            
-            contract_base_info cbi(db, nfa_context, nfa_contract_owner, nfa_contract.name, current_cbi->caller, string(nfa_contract.creation_date), string(nfa_contract.contract_authority), current_cbi->invoker_contract_name);
-            contract_handler ch(db, current_ch->caller, 0, nfa_contract, current_ch->result, nfa_context, current_ch->sigkeys, current_ch->is_in_eval);
-            contract_nfa_handler cnh(current_ch->caller, nfa, nfa_context, db, ch);
-            
-            const auto& name = nfa_contract.name;
-            nfa_context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size()); //sandbox
-            
-            FC_ASSERT(nfa_contract_code.lua_code_b.size()>0);
-            nfa_context.load_script_to_sandbox(name, nfa_contract_code.lua_code_b.data(), nfa_contract_code.lua_code_b.size());
-            
-            nfa_context.writeVariable("current_contract", name);
-            nfa_context.writeVariable(name, "_G", "protected");
-
-            nfa_context.writeVariable(name, "contract_helper", &ch);
-            nfa_context.writeVariable(name, "contract_base_info", &cbi);
-            nfa_context.writeVariable(name, "nfa_helper", &cnh);
-
-            nfa_context.get_function(name, function_name);
-            //push function actual parameters
-            for (vector<lua_types>::iterator itr = value_list.begin(); itr != value_list.end(); itr++)
-                LuaContext::Pusher<lua_types>::push(nfa_context.mState, *itr).release();
-            
-            int err = lua_pcall(nfa_context.mState, value_list.size(), 1, 0);
-            lua_types error_message;
-            lua_table result_table;
-            try
-            {
-                if (err)
-                    error_message = *LuaContext::Reader<lua_types>::read(nfa_context.mState, -1);
-                else if(lua_istable(nfa_context.mState, -1))
-                    result_table = *LuaContext::Reader<lua_table>::read(nfa_context.mState, -1);
-            }
-            catch (...)
-            {
-                error_message = lua_string(" Unexpected errors ");
-            }
-            lua_pop(nfa_context.mState, -1);
-            nfa_context.close_sandbox(name);
-            if (err)
-                FC_THROW("Try the contract resolution execution failure, ${message}", ("message", error_message));
-            
-            ch.assert_contract_data_size();
-            
-            for(auto& temp : ch.result.contract_affecteds) {
-                if(temp.which() == contract_affected_type::tag<contract_result>::value)
-                    ch.result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
-            }
-            ch.result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
-
-            return result_table.v;
+            return call_nfa_contract_function(0, nfa, *contract_ptr, function_name, value_list, false, true);
         }
         catch(fc::exception e)
         {
-            if(lua_getdropsenabled(context.mState)) {
-                auto vm_drops = lua_getdrops(nfa_context.mState);
-                lua_setdrops(context.mState, vm_drops); //即使崩溃了也要将使用drops情况反馈到上层
-            }
             LUA_C_ERR_THROW(context.mState, e.to_string());
         }
     }
@@ -683,7 +774,6 @@ namespace taiyi { namespace chain {
     lua_map contract_handler::do_nfa_action(int64_t nfa_id, const string& action, const lua_map& params)
     {
         //TODO: do的权限以及产生的消耗
-        LuaContext nfa_context;
         try
         {
             const nfa_object& nfa = db.get<nfa_object, by_id>(nfa_id);
@@ -699,7 +789,7 @@ namespace taiyi { namespace chain {
             if(abi_itr->second.which() != lua_types::tag<lua_table>::value)
                 return lua_map();
             
-            lua_map action_def = abi_itr->second.get<lua_table>().v;
+            const lua_map& action_def = abi_itr->second.get<lua_table>().v;
             auto def_itr = action_def.find(lua_types(lua_string("consequence")));
             if(def_itr != action_def.end())
                 FC_ASSERT(def_itr->second.get<lua_bool>().v == true, "Can not perform action ${a} in nfa ${nfa} without consequence history. should eval it in api.", ("a", action)("nfa", nfa_id));
@@ -721,65 +811,7 @@ namespace taiyi { namespace chain {
                 FC_ASSERT(value_list.size() == func_abi_itr->second.get<lua_function>().arglist.size(), "input values count is ${n}, but ${f}`s parameter list is ${p}...", ("n", value_list.size())("f", function_name)("p", func_abi_itr->second.get<lua_function>().arglist));
             FC_ASSERT(value_list.size() <= 20, "value list is greater than 20 limit");
             
-            auto current_contract_name = context.readVariable<string>("current_contract");
-            auto current_cbi = context.readVariable<contract_base_info*>(current_contract_name, "contract_base_info");
-            auto current_ch = context.readVariable<contract_handler*>(current_contract_name, "contract_helper");
-            const auto &baseENV = db.get<contract_bin_code_object, by_id>(0);
-            
-            const auto& nfa_contract = *contract_ptr;
-            const auto& nfa_contract_owner = db.get<account_object, by_id>(nfa_contract.owner).name;
-            const auto& nfa_contract_code = db.get<contract_bin_code_object, by_id>(nfa_contract.lua_code_b_id);
-            
-            contract_base_info cbi(db, nfa_context, nfa_contract_owner, nfa_contract.name, current_cbi->caller, string(nfa_contract.creation_date), string(nfa_contract.contract_authority), current_cbi->invoker_contract_name);
-            contract_handler ch(db, current_ch->caller, 0, nfa_contract, current_ch->result, nfa_context, current_ch->sigkeys, false);
-            contract_nfa_handler cnh(current_ch->caller, nfa, nfa_context, db, ch);
-            
-            const auto& name = nfa_contract.name;
-            nfa_context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size()); //sandbox
-            
-            FC_ASSERT(nfa_contract_code.lua_code_b.size()>0);
-            nfa_context.load_script_to_sandbox(name, nfa_contract_code.lua_code_b.data(), nfa_contract_code.lua_code_b.size());
-            
-            nfa_context.writeVariable("current_contract", name);
-            nfa_context.writeVariable(name, "_G", "protected");
-
-            nfa_context.writeVariable(name, "contract_helper", &ch);
-            nfa_context.writeVariable(name, "contract_base_info", &cbi);
-            nfa_context.writeVariable(name, "nfa_helper", &cnh);
-
-            nfa_context.get_function(name, function_name);
-            //push function actual parameters
-            for (vector<lua_types>::iterator itr = value_list.begin(); itr != value_list.end(); itr++)
-                LuaContext::Pusher<lua_types>::push(nfa_context.mState, *itr).release();
-            
-            int err = lua_pcall(nfa_context.mState, value_list.size(), 1, 0);
-            lua_types error_message;
-            lua_table result_table;
-            try
-            {
-                if (err)
-                    error_message = *LuaContext::Reader<lua_types>::read(nfa_context.mState, -1);
-                else if(lua_istable(nfa_context.mState, -1))
-                    result_table = *LuaContext::Reader<lua_table>::read(nfa_context.mState, -1);
-            }
-            catch (...)
-            {
-                error_message = lua_string(" Unexpected errors ");
-            }
-            lua_pop(nfa_context.mState, -1);
-            nfa_context.close_sandbox(name);
-            if (err)
-                FC_THROW("Try the contract resolution execution failure, ${message}", ("message", error_message));
-            
-            ch.assert_contract_data_size();
-
-            for(auto& temp : ch.result.contract_affecteds) {
-                if(temp.which() == contract_affected_type::tag<contract_result>::value)
-                    ch.result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
-            }
-            ch.result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
-
-            return result_table.v;
+            return call_nfa_contract_function(0, nfa, *contract_ptr, function_name, value_list, true, false);
         }
         catch (fc::exception e)
         {
@@ -790,7 +822,6 @@ namespace taiyi { namespace chain {
     lua_map contract_handler::call_nfa_function_with_caller(const account_object& caller, int64_t nfa_id, const string& function_name, const lua_map& params, bool assert_when_function_not_exist)
     {
         //TODO: call产生的消耗
-        LuaContext nfa_context;
         try
         {
             const nfa_object& nfa = db.get<nfa_object, by_id>(nfa_id);
@@ -820,24 +851,54 @@ namespace taiyi { namespace chain {
                 FC_ASSERT(value_list.size() == func_abi_itr->second.get<lua_function>().arglist.size(), "input values count is ${n}, but ${f}`s parameter list is ${p}...", ("n", value_list.size())("f", function_name)("p", func_abi_itr->second.get<lua_function>().arglist));
             FC_ASSERT(value_list.size() <= 20, "value list is greater than 20 limit");
             
-            auto current_contract_name = context.readVariable<string>("current_contract");
-            auto current_cbi = context.readVariable<contract_base_info*>(current_contract_name, "contract_base_info");
-            auto current_ch = context.readVariable<contract_handler*>(current_contract_name, "contract_helper");
-            const auto &baseENV = db.get<contract_bin_code_object, by_id>(0);
-            
-            const auto& nfa_contract = *contract_ptr;
-            const auto& nfa_contract_owner = db.get<account_object, by_id>(nfa_contract.owner).name;
-            const auto& nfa_contract_code = db.get<contract_bin_code_object, by_id>(nfa_contract.lua_code_b_id);
-            
-            contract_base_info cbi(db, nfa_context, nfa_contract_owner, nfa_contract.name, caller.name, string(nfa_contract.creation_date), string(nfa_contract.contract_authority), current_cbi->invoker_contract_name);
-            contract_handler ch(db, caller, 0, nfa_contract, current_ch->result, nfa_context, current_ch->sigkeys, current_ch->is_in_eval);
-            contract_nfa_handler cnh(caller, nfa, nfa_context, db, ch);
+            return call_nfa_contract_function(0, nfa, *contract_ptr, function_name, value_list, false, false, &caller);
+        }
+        catch (fc::exception e)
+        {
+            LUA_C_ERR_THROW(context.mState, e.to_string());
+        }
+    }
+    //=============================================================================
+    lua_map contract_handler::call_nfa_function(int64_t nfa_id, const string& function_name, const lua_map& params, bool assert_when_function_not_exist)
+    {
+        auto current_contract_name = context.readVariable<string>("current_contract");
+        auto current_ch = context.readVariable<contract_handler*>(current_contract_name, "contract_helper");
+        return call_nfa_function_with_caller(current_ch->caller, nfa_id, function_name, params, assert_when_function_not_exist);
+    }
+    //=============================================================================
+    lua_map contract_handler::call_nfa_contract_function(const nfa_object* nfa_caller, const nfa_object& nfa, const contract_object& nfa_contract, const string& function_name, const vector<lua_types>& value_list, bool consequence, bool share_drops, const account_object* caller)
+    {
+        auto current_contract_name = context.readVariable<string>("current_contract");
+        auto current_cbi = context.readVariable<contract_base_info*>(current_contract_name, "contract_base_info");
+        auto current_ch = context.readVariable<contract_handler*>(current_contract_name, "contract_helper");
+        const auto& nfa_caller_account = caller ? *caller : current_ch->caller;
+        const auto &baseENV = db.get<contract_bin_code_object, by_id>(0);
+        
+        const auto& nfa_contract_owner = db.get<account_object, by_id>(nfa_contract.owner).name;
+        const auto& nfa_contract_code = db.get<contract_bin_code_object, by_id>(nfa_contract.lua_code_b_id);
+        
+        //调用方已经检查过目标函数和参数，这时才借用虚拟机，不执行的调用不必付出借出和归还回收的代价
+        //嵌套调用不与上层共用虚拟机：同一合约的NFA互相调用时沙盒同名，而且内存drops要从零计量
+        pooled_lua_context pooled_nfa_context;
+        LuaContext& nfa_context = pooled_nfa_context.single_call();
+        
+        bool drops_shared = share_drops && lua_getdropsenabled(context.mState);
+        if(drops_shared) {
+            lua_enabledrops(nfa_context.mState, 1, 1);
+            lua_setdrops(nfa_context.mState, lua_getdrops(context.mState)); //上层虚拟机还剩下的drops可用
+        }
+        
+        try
+        {
+            contract_base_info cbi(db, nfa_context, nfa_contract_owner, nfa_contract.name, nfa_caller_account.name, string(nfa_contract.creation_date), string(nfa_contract.contract_authority), current_cbi->invoker_contract_name);
+            contract_handler ch(db, nfa_caller_account, nfa_caller, nfa_contract, current_ch->result, nfa_context, current_ch->sigkeys, consequence ? false : current_ch->is_in_eval);
+            contract_nfa_handler cnh(nfa_caller_account, nfa, nfa_context, db, ch);
             
             const auto& name = nfa_contract.name;
             nfa_context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size()); //sandbox
             
             FC_ASSERT(nfa_contract_code.lua_code_b.size()>0);
-            nfa_context.load_script_to_sandbox(name, nfa_contract_code.lua_code_b.data(), nfa_contract_code.lua_code_b.size());
+            nfa_context.load_script_to_sandbox(name, nfa_contract_code.id._id, nfa_contract_code.lua_code_b.data(), nfa_contract_code.lua_code_b.size());
             
             nfa_context.writeVariable("current_contract", name);
             nfa_context.writeVariable(name, "_G", "protected");
@@ -848,7 +909,7 @@ namespace taiyi { namespace chain {
 
             nfa_context.get_function(name, function_name);
             //push function actual parameters
-            for (vector<lua_types>::iterator itr = value_list.begin(); itr != value_list.end(); itr++)
+            for (auto itr = value_list.begin(); itr != value_list.end(); itr++)
                 LuaContext::Pusher<lua_types>::push(nfa_context.mState, *itr).release();
             
             int err = lua_pcall(nfa_context.mState, value_list.size(), 1, 0);
@@ -871,28 +932,25 @@ namespace taiyi { namespace chain {
                 FC_THROW("Try the contract resolution execution failure, ${message}", ("message", error_message));
             
             ch.assert_contract_data_size();
-
+            
             for(auto& temp : ch.result.contract_affecteds) {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     ch.result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            ch.result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
+            ch.result.relevant_datasize += ch.contract_data_pack_size() + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
 
             return result_table.v;
         }
-        catch (fc::exception e)
+        catch(fc::exception e)
         {
-            LUA_C_ERR_THROW(context.mState, e.to_string());
+            if(drops_shared) {
+                auto vm_drops = lua_getdrops(nfa_context.mState);
+                lua_setdrops(context.mState, vm_drops); //即使崩溃了也要将使用drops情况反馈到上层
+            }
+            throw;
         }
     }
     //=============================================================================
-    lua_map contract_handler::call_nfa_function(int64_t nfa_id, const string& function_name, const lua_map& params, bool assert_when_function_not_exist)
-    {
-        auto current_contract_name = context.readVariable<string>("current_contract");
-        auto current_ch = context.readVariable<contract_handler*>(current_contract_name, "contract_helper");
-        return call_nfa_function_with_caller(current_ch->caller, nfa_id, function_name, params, assert_when_function_not_exist);
-    }
-    //=============================================================================
     void contract_handler::change_nfa_contract(int64_t nfa_id, const string& contract_name)
     {
         try
@@ -1093,6 +1151,8 @@ namespace taiyi { namespace chain {
     {
         try
         {
+            load_contract_data(read_list);
+            
             vector<lua_types> stacks = {};
             lua_map result;
             read_table_data(result, read_list, contract_data_cache, stacks);
@@ -1114,8 +1174,25 @@ namespace taiyi { namespace chain {
     {
         try
         {
+            load_contract_data(write_list);
+            
+            //整表写入时原有的键都可能被删除，写入前后出现过的键都需要写回
+            if (write_list.size() == 0) {
+                for (const auto& p : contract_data_cache)
+                    contract_data_dirty.insert(p.first);
+            }
+            
             vector<lua_types> stacks = {};
             write_table_data(contract_data_cache, write_list, data, stacks);
+            
+            if (write_list.size() == 0) {
+                for (const auto& p : contract_data_cache)
+                    contract_data_dirty.insert(p.first);
+            }
+            else {
+                for (const auto& p : write_list)
+                    contract_data_dirty.insert(p.first);
+            }
         }
         catch (fc::exception e)
         {
@@ -1181,6 +1258,7 @@ namespace taiyi { namespace chain {
         {
             vector<lua_types> stacks = {};
             write_table_data(account_contract_data_cache, write_list, data, stacks);
+            account_contract_data_dirty = true;
         }
         catch (fc::exception e)
         {
@@ -1246,17 +1324,29 @@ namespace taiyi { namespace chain {
         static auto start_key = lua_types(lua_string("start"));
         static auto stop_key = lua_types(lua_string("stop"));
         uint32_t start = 0, stop = 0, index = 0;
-        lua_map keys = rkeys;
         
-        if (keys.find(start_key) != keys.end() && keys[start_key].which() == lua_types::tag<lua_int>::value) {
-            start = keys[start_key].get<lua_int>().v;
-            keys.erase(start_key);
-        }
+        //只有带区间参数时才需要复制一份去掉start/stop的键表
+        auto start_itr = rkeys.find(start_key);
+        if (start_itr != rkeys.end() && start_itr->second.which() == lua_types::tag<lua_int>::value)
+            start = start_itr->second.get<lua_int>().v;
+        else
+            start_itr = rkeys.end();
         
-        if (keys.find(stop_key) != keys.end() && keys[stop_key].which() == lua_types::tag<lua_int>::value) {
-            stop = keys[stop_key].get<lua_int>().v;
-            keys.erase(stop_key);
-        }
+        auto stop_itr = rkeys.find(stop_key);
+        if (stop_itr != rkeys.end() && stop_itr->second.which() == lua_types::tag<lua_int>::value)
+            stop = stop_itr->second.get<lua_int>().v;
+        else
+            stop_itr = rkeys.end();
+        
+        lua_map range_stripped_keys;
+        if (start_itr != rkeys.end() || stop_itr != rkeys.end()) {
+            range_stripped_keys = rkeys;
+            if (start_itr != rkeys.end())
+                range_stripped_keys.erase(start_key);
+            if (stop_itr != rkeys.end())
+                range_stripped_keys.erase(stop_key);
+        }
+        const lua_map& keys = (start_itr != rkeys.end() || stop_itr != rkeys.end()) ? range_stripped_keys : rkeys;
         
         if (start || stop)
         {
@@ -1506,9 +1596,7 @@ namespace taiyi { namespace chain {
 
             auto new_type = get_zone_type_from_string(type);
             FC_ASSERT(new_type != _ZONE_INVALID_TYPE, "invalid zone type \"${t}\"", ("t", type));
-            db.modify(*zone, [&](zone_object& obj){
-                obj.type = new_type;
-            });
+            db.change_zone_type(*zone, new_type);
         }
         catch (fc::exception e)
         {
@@ -1623,6 +1711,35 @@ namespace taiyi { namespace chain {
         }
     }
     //=============================================================================
+    vector<string> contract_handler::find_way_to_zone(const string& from_zone_name, const string& to_zone_name, bool weighted)
+    {
+        try
+        {
+            //硬分叉0.1之前合约中没有这个函数
+            FC_ASSERT(db.has_hardfork(TAIYI_HARDFORK_0_1), "find_way_to_zone is not available before hardfork 0.1");
+            
+            const auto* from_zone = db.find<zone_object, by_name>(from_zone_name);
+            FC_ASSERT(from_zone != nullptr, "Zone named ${n} is not exist", ("n", from_zone_name));
+            const auto* to_zone = db.find<zone_object, by_name>(to_zone_name);
+            FC_ASSERT(to_zone != nullptr, "Zone named ${n} is not exist", ("n", to_zone_name));
+
+            //按未命中缓存时搜索的上限收费，是否命中缓存是各节点自己的状态，不能影响消耗
+            if(lua_getdropsenabled(context.mState)) {
+                long long route_drops = (long long)(db.get_index<zone_index>().indices().size() + db.get_index<zone_connect_index>().indices().size()) * TAIYI_ZONE_ROUTE_DROPS_PER_ITEM;
+                FC_ASSERT(lua_setdrops(context.mState, lua_getdrops(context.mState) - route_drops), "Not enough drops to find way to zone ${n}", ("n", to_zone_name));
+            }
+
+            vector<string> way_points;
+            for(const auto& zone : db.find_zone_route(*from_zone, *to_zone, weighted))
+                way_points.push_back(db.get<zone_object, by_id>(zone).name);
+            return way_points;
+        }
+        catch (fc::exception e)
+        {
+            LUA_C_ERR_THROW(context.mState, e.to_string());
+        }
+    }
+    //=============================================================================
     bool contract_handler::is_actor_valid(int64_t nfa_id)
     {
         return db.find<actor_object, by_nfa_id>(nfa_id) != nullptr;
@@ -1760,10 +1877,12 @@ namespace taiyi { namespace chain {
 
             //finish movement
             auto now = db.head_block_time();
+            db.adjust_population_stats( *actor, -1 );
             db.modify( *actor, [&]( actor_object& act ) {
                 act.location = target_zone->id;
                 act.last_update = now;
             });
+            db.adjust_population_stats( *actor, 1 );
             
             //以目的地视角回调目的地函数：on_actor_enter
             lua_map param;
@@ -1948,11 +2067,10 @@ namespace taiyi { namespace chain {
             string nfa_symbol_name = "nfa.zone.default";
             const auto& nfa_symbol = db.get<nfa_symbol_object, by_symbol>(nfa_symbol_name);
             
-            const auto* current_trx = db.get_current_trx_ptr();
-            FC_ASSERT(current_trx);
-            const flat_set<public_key_type>& sigkeys = current_trx->get_signature_keys(db.get_chain_id(), fc::ecc::fc_canonical);
+            const flat_set<public_key_type>& sigkeys = db.get_current_trx_signature_keys();
             
-            LuaContext context;
+            pooled_lua_context pooled_context;
+            LuaContext& context = *pooled_context;
             db.initialize_VM_baseENV(context);
             
             const auto& new_nfa = db.create_nfa(creator, nfa_symbol, sigkeys, true, context, &actor_nfa);
@@ -208,7 +208,12 @@ namespace taiyi { namespace chain {
         LuaContext&                         context;
         const flat_set<public_key_type>&    sigkeys;
         lua_map                             account_contract_data_cache;
-        lua_map                             contract_data_cache;
+        bool                                account_contract_data_dirty = false;
+        lua_map                             contract_data_cache;        //按顶层键延迟载入的合约数据
+        std::set<lua_key>                   contract_data_loaded;       //已从数据库载入（含不存在）的顶层键
+        std::set<lua_key>                   contract_data_dirty;        //已修改、需要写回的顶层键
+        bool                                contract_data_all_loaded = false;
+        bool                                contract_data_snapshot = false; //硬分叉0.1之前的整表快照语义
         bool                                is_in_eval; //只读模式标记，表示在eval调用中
         
         std::vector<contract_handler*>      _sub_chs;
@@ -217,6 +222,12 @@ namespace taiyi { namespace chain {
         ~contract_handler();
     
         void assert_contract_data_size();
+        uint64_t contract_data_pack_size() const;
+        void load_contract_data(const lua_map& key_list);
+        void load_contract_data(const lua_key& key);
+        void load_all_contract_data();
+        static lua_map fetch_contract_data(const database& db, const contract_object& contract, const lua_map& key_list);
+        static bool need_all_contract_data(const lua_map& key_list);
         bool is_owner();
         int64_t get_nfa_caller();
         void log(string message);
@@ -280,6 +291,7 @@ namespace taiyi { namespace chain {
         contract_zone_base_info get_zone_info(int64_t nfa_id);
         contract_zone_base_info get_zone_info_by_name(const string& name);
         void connect_zones(int64_t from_zone_nfa_id, int64_t to_zone_nfa_id);
+        vector<string> find_way_to_zone(const string& from_zone_name, const string& to_zone_name, bool weighted);
         vector<contract_actor_base_info> list_actors_on_zone(int64_t nfa_id);
         string exploit_zone(const string& actor_name, const string& zone_name);
         string break_new_zone(const string& actor_name);
@@ -307,6 +319,8 @@ namespace taiyi { namespace chain {
         void read_table_data(lua_map& out_data, const lua_map& keys, const lua_map& target_table, vector<lua_types>& stacks);
         lua_map call_nfa_function(int64_t nfa_id, const string& function_name, const lua_map& params, bool assert_when_function_not_exist = true);
         lua_map call_nfa_function_with_caller(const account_object& caller, int64_t nfa_id, const string& function_name, const lua_map& params, bool assert_when_function_not_exist = true);
+        //在借用的池化虚拟机中执行NFA合约函数，consequence表示有后果的do_行为，share_drops表示使用上层虚拟机剩余的drops
+        lua_map call_nfa_contract_function(const nfa_object* nfa_caller, const nfa_object& nfa, const contract_object& nfa_contract, const string& function_name, const vector<lua_types>& value_list, bool consequence, bool share_drops, const account_object* caller = nullptr);
     };
     
     asset_symbol_type s_get_symbol_type_from_string(const string name);
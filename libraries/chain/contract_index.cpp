@@ -11,6 +11,7 @@ namespace taiyi { namespace chain {
         TAIYI_ADD_CORE_INDEX(db, contract_index);
         TAIYI_ADD_CORE_INDEX(db, account_contract_data_index);
         TAIYI_ADD_CORE_INDEX(db, contract_bin_code_index);
+        TAIYI_ADD_CORE_INDEX(db, contract_data_index);
     }
 
 } }
@@ -173,14 +173,14 @@ namespace taiyi { namespace chain {
         {
             auto committee_id = db.get<account_object, by_name>(TAIYI_COMMITTEE_ACCOUNT).id;
             FC_ASSERT(contract->owner == committee_id, "The blacklist of contracts is not controlled by the committee");
-            const auto black_list_p = contract->contract_data.find(lua_key(lua_string("black_list")));
-            if(black_list_p == contract->contract_data.end() || black_list_p->second.which() != lua_types::tag<lua_table>::value)
+            const auto* black_list_p = db.find<contract_data_object, by_contract_key>(boost::make_tuple(contract->id, lua_key(lua_string("black_list"))));
+            if(black_list_p == nullptr || black_list_p->value.which() != lua_types::tag<lua_table>::value)
             {
                 return true;
             }
             else
             {
-                const auto& black_list = black_list_p->second.get<lua_table>().v;
+                const auto& black_list = black_list_p->value.get<lua_table>().v;
                 auto isfind = black_list.find(lua_key(lua_string(name)));
                 if(isfind == black_list.end())
                     return true;
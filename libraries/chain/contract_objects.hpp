@@ -6,6 +6,7 @@
 
 namespace taiyi { namespace chain {
 
+    using protocol::lua_key;
     using protocol::lua_map;
     using protocol::lua_types;
     using protocol::public_key_type;
@@ -20,7 +21,7 @@ namespace taiyi { namespace chain {
     public:
         template< typename Constructor, typename Allocator >
         contract_object(Constructor&& c, allocator< Allocator > a)
-            : name(a), contract_data(a), contract_ABI(a)
+            : name(a), contract_ABI(a)
         {
             c(*this);
         }
@@ -34,7 +35,8 @@ namespace taiyi { namespace chain {
         public_key_type     contract_authority;
         bool                is_release = false;
         bool                check_contract_authority = false;
-        lua_map             contract_data;
+        uint32_t            contract_data_count = 0;    //合约数据顶层键数量，数据按键存放在contract_data_object中
+        uint64_t            contract_data_size = 0;     //合约数据所有顶层键值对的打包字节数之和
         lua_map             contract_ABI;
         contract_bin_code_id_type lua_code_b_id;
         
@@ -42,6 +44,7 @@ namespace taiyi { namespace chain {
         
     public:
         bool check_contract_authority_falg() { return check_contract_authority; }
+        uint64_t contract_data_pack_size() const { return fc::raw::pack_size(fc::unsigned_int(contract_data_count)) + contract_data_size; }
         optional<lua_types> get_lua_data(LuaContext &context, int index, bool check_fc = false);
         void push_global_parameters(LuaContext &context, lua_map &global_variable_list, string tablename = "");
         void push_table_parameters(LuaContext &context, lua_map &table_variable, string tablename);
@@ -134,10 +137,48 @@ namespace taiyi { namespace chain {
         allocator< contract_bin_code_object >
     > contract_bin_code_index;
 
+    //=============================================================================
+
+    //合约数据的一个顶层键值对，合约调用时按键载入和写回，不必整体复制合约数据
+    class contract_data_object : public object < contract_data_object_type, contract_data_object >
+    {
+        TAIYI_STD_ALLOCATOR_CONSTRUCTOR(contract_data_object)
+        
+    public:
+        template< typename Constructor, typename Allocator >
+        contract_data_object(Constructor&& c, allocator< Allocator > a)
+        {
+            c(*this);
+        }
+        
+        id_type             id;
+        
+        contract_id_type    contract_id;
+        lua_key             key;
+        lua_types           value;
+        
+        uint64_t entry_size() const { return fc::raw::pack_size(key) + fc::raw::pack_size(value); }
+    };
+
+    struct by_contract_key;
+    typedef multi_index_container<
+        contract_data_object,
+        indexed_by<
+            ordered_unique< tag< by_id >, member< contract_data_object, contract_data_id_type, &contract_data_object::id > >,
+            ordered_unique< tag< by_contract_key >,
+                composite_key< contract_data_object,
+                    member< contract_data_object, contract_id_type, &contract_data_object::contract_id >,
+                    member< contract_data_object, lua_key, &contract_data_object::key >
+                >
+            >
+        >,
+        allocator< contract_data_object >
+    > contract_data_index;
+
 } } // taiyi::chain
 
 
-FC_REFLECT(taiyi::chain::contract_object, (id)(owner)(name)(user_invoke_share_percent)(current_version)(contract_authority)(is_release)(check_contract_authority)(contract_data)(contract_ABI)(lua_code_b_id)(creation_date) )
+FC_REFLECT(taiyi::chain::contract_object, (id)(owner)(name)(user_invoke_share_percent)(current_version)(contract_authority)(is_release)(check_contract_authority)(contract_data_count)(contract_data_size)(contract_ABI)(lua_code_b_id)(creation_date) )
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::contract_object, taiyi::chain::contract_index)
 
 FC_REFLECT(taiyi::chain::account_contract_data_object, (id)(owner)(contract_id)(contract_data) )
@@ -149,3 +190,6 @@ FC_REFLECT(taiyi::chain::contract_bin_code_object, (id)(contract_id)(lua_code_b)
 FC_REFLECT(taiyi::chain::contract_bin_code_object, (id)(contract_id)(lua_code_b) )
 #endif
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::contract_bin_code_object, taiyi::chain::contract_bin_code_index)
+
+FC_REFLECT(taiyi::chain::contract_data_object, (id)(contract_id)(key)(value) )
+CHAINBASE_SET_INDEX_TYPE(taiyi::chain::contract_data_object, taiyi::chain::contract_data_index)
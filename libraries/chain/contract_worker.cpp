@@ -18,7 +18,7 @@ extern "C" {
 
 namespace taiyi { namespace chain {
 
-    lua_table contract_worker::do_contract_function(const account_object& caller, string function_name, vector<lua_types> value_list, const flat_set<public_key_type> &sigkeys, const contract_object& contract, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db)
+    lua_table contract_worker::do_contract_function(const account_object& caller, string function_name, const vector<lua_types>& value_list, const flat_set<public_key_type> &sigkeys, const contract_object& contract, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db)
     { try {
 
         lua_table result_table;
@@ -49,7 +49,7 @@ namespace taiyi { namespace chain {
             
             const auto& contract_code = db.get<contract_bin_code_object, by_id>(contract.lua_code_b_id);
             FC_ASSERT(contract_code.lua_code_b.size()>0);
-            context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+            context.load_script_to_sandbox(name, contract_code.id._id, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
             context.writeVariable("current_contract", name);
             context.writeVariable(name, "_G", "protected");
             
@@ -60,7 +60,7 @@ namespace taiyi { namespace chain {
             bool bOK = context.get_function(name, function_name);
             FC_ASSERT(bOK);
             //push function actual parameters
-            for (vector<lua_types>::iterator itr = value_list.begin(); itr != value_list.end(); itr++)
+            for (auto itr = value_list.begin(); itr != value_list.end(); itr++)
                 LuaContext::Pusher<lua_types>::push(context.mState, *itr).release();
             
             int err = lua_pcall(context.mState, value_list.size(), 1, 0);
@@ -93,7 +93,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(result.contract_affecteds);
+            result.relevant_datasize += ch.contract_data_pack_size() + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(result.contract_affecteds);
         }
         catch (LuaContext::VMcollapseErrorException e)
         {
@@ -287,7 +287,7 @@ namespace taiyi { namespace chain {
         }
     } FC_CAPTURE_AND_RETHROW() }
     //=============================================================================
-    string contract_worker::eval_nfa_contract_action(const nfa_object& caller_nfa, const string& action, vector<lua_types> value_list, vector<lua_types>&result, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db)
+    string contract_worker::eval_nfa_contract_action(const nfa_object& caller_nfa, const string& action, const vector<lua_types>& value_list, vector<lua_types>&result, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db)
     { try {
         //check existence and consequence type
         const auto* contract_ptr = db.find<chain::contract_object, by_id>(caller_nfa.is_miraged?caller_nfa.mirage_contract:caller_nfa.main_contract);
@@ -300,7 +300,7 @@ namespace taiyi { namespace chain {
         if(abi_itr->second.which() != lua_types::tag<lua_table>::value)
             return FORMAT_MESSAGE("#t&&y#实体的行为\"${a}\"没有定义好#a&&i#", ("a", action));;
 
-        lua_map action_def = abi_itr->second.get<lua_table>().v;
+        const lua_map& action_def = abi_itr->second.get<lua_table>().v;
         auto def_itr = action_def.find(lua_types(lua_string("consequence")));
         if(def_itr != action_def.end())
             FC_ASSERT(def_itr->second.get<lua_bool>().v == false, "Can not eval action ${a} in nfa with consequence history. should signing it in transaction.", ("a", action));
@@ -321,7 +321,7 @@ namespace taiyi { namespace chain {
         return "";        
     } FC_CAPTURE_AND_RETHROW() }
     //=============================================================================
-    std::string contract_worker::do_nfa_contract_action(const nfa_object& caller_nfa, const string& action, vector<lua_types> value_list, vector<lua_types>&result, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db)
+    std::string contract_worker::do_nfa_contract_action(const nfa_object& caller_nfa, const string& action, const vector<lua_types>& value_list, vector<lua_types>&result, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db)
     { try {
         //check existence and consequence type
         const auto* contract_ptr = db.find<chain::contract_object, by_id>(caller_nfa.is_miraged?caller_nfa.mirage_contract:caller_nfa.main_contract);
@@ -334,7 +334,7 @@ namespace taiyi { namespace chain {
         if(abi_itr->second.which() != lua_types::tag<lua_table>::value)
             return FORMAT_MESSAGE("#t&&y#实体的行为\"${a}\"没有定义好#a&&i#", ("a", action));;
         
-        lua_map action_def = abi_itr->second.get<lua_table>().v;
+        const lua_map& action_def = abi_itr->second.get<lua_table>().v;
         auto def_itr = action_def.find(lua_types(lua_string("consequence")));
         FC_ASSERT(def_itr != action_def.end(), "Can not perform action ${a} in nfa without consequence type defined.", ("a", action));
         FC_ASSERT(def_itr->second.get<lua_bool>().v == true, "Can not perform action ${a} in nfa without consequence history. should eval it in api.", ("a", action));
@@ -355,7 +355,7 @@ namespace taiyi { namespace chain {
         return "";
     } FC_CAPTURE_AND_RETHROW() }
     //=============================================================================
-    lua_table contract_worker::do_nfa_contract_function(const nfa_object& caller_nfa, const string& function_name, vector<lua_types> value_list, const flat_set<public_key_type> &sigkeys, const contract_object& contract, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db, bool eval)
+    lua_table contract_worker::do_nfa_contract_function(const nfa_object& caller_nfa, const string& function_name, const vector<lua_types>& value_list, const flat_set<public_key_type> &sigkeys, const contract_object& contract, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db, bool eval)
     { try {
         lua_table result_table;
 
@@ -383,7 +383,7 @@ namespace taiyi { namespace chain {
             
             const auto& contract_code = db.get<contract_bin_code_object, by_id>(contract.lua_code_b_id);
             FC_ASSERT(contract_code.lua_code_b.size()>0);
-            context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+            context.load_script_to_sandbox(name, contract_code.id._id, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
             context.writeVariable("current_contract", name);
             context.writeVariable(name, "_G", "protected");
 
@@ -393,7 +393,7 @@ namespace taiyi { namespace chain {
 
             context.get_function(name, function_name);
             //push function actual parameters
-            for (vector<lua_types>::iterator itr = value_list.begin(); itr != value_list.end(); itr++)
+            for (auto itr = value_list.begin(); itr != value_list.end(); itr++)
                 LuaContext::Pusher<lua_types>::push(context.mState, *itr).release();
             
             int err = lua_pcall(context.mState, value_list.size(), 1, 0);
@@ -435,7 +435,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(result.contract_affecteds);
+            result.relevant_datasize += ch.contract_data_pack_size() + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(result.contract_affecteds);
         }
         catch (LuaContext::VMcollapseErrorException e)
         {
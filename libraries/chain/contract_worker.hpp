@@ -16,11 +16,11 @@ namespace taiyi { namespace chain {
     public:
         protocol::lua_table do_contract(contract_id_type id, const string& name, const string& lua_code, vector<char>& lua_code_b, long long& vm_drops, database &db);
         
-        protocol::lua_table do_contract_function(const account_object& caller, string function_name, vector<lua_types> value_list, const flat_set<public_key_type> &sigkeys, const contract_object& contract, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db);
+        protocol::lua_table do_contract_function(const account_object& caller, string function_name, const vector<lua_types>& value_list, const flat_set<public_key_type> &sigkeys, const contract_object& contract, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db);
         
-        std::string eval_nfa_contract_action(const nfa_object& caller_nfa, const string& action, vector<lua_types> value_list, vector<lua_types>&result, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db);
-        std::string do_nfa_contract_action(const nfa_object& caller_nfa, const string& action, vector<lua_types> value_list, vector<lua_types>&result, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db);
-        protocol::lua_table do_nfa_contract_function(const nfa_object& caller_nfa, const string& function_name, vector<lua_types> value_list, const flat_set<public_key_type> &sigkeys, const contract_object& contract, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db, bool eval);
+        std::string eval_nfa_contract_action(const nfa_object& caller_nfa, const string& action, const vector<lua_types>& value_list, vector<lua_types>&result, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db);
+        std::string do_nfa_contract_action(const nfa_object& caller_nfa, const string& action, const vector<lua_types>& value_list, vector<lua_types>&result, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db);
+        protocol::lua_table do_nfa_contract_function(const nfa_object& caller_nfa, const string& function_name, const vector<lua_types>& value_list, const flat_set<public_key_type> &sigkeys, const contract_object& contract, long long& vm_drops, bool reset_vm_memused, LuaContext& context, database &db, bool eval);
 
         const contract_result& get_result() { return result; }
         
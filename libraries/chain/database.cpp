@@ -13,15 +13,19 @@
 #include <chain/taiyi_evaluator.hpp>
 #include <chain/taiyi_objects.hpp>
 #include <chain/tiandao_property_object.hpp>
+#include <chain/population_stats_object.hpp>
 #include <chain/account_object.hpp>
 #include <chain/transaction_object.hpp>
 #include <chain/contract_objects.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/nfa_objects.hpp>
 #include <chain/siming_objects.hpp>
 #include <chain/siming_schedule.hpp>
 
 #include <chain/util/uint256.hpp>
 
+#include <protocol/transaction_util.hpp>
+
 #include <fc/smart_ref_impl.hpp>
 #include <fc/uint128.hpp>
 
@@ -33,13 +37,26 @@
 
 #include <rocksdb/perf_context.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #include <cstdint>
 #include <deque>
 #include <fstream>
 #include <functional>
 
+//签名公钥缓存的容量，超出时淘汰最久未用的条目，防止被大量无效交易撑大
+#define TAIYI_MAX_CACHED_SIGNATURE_KEYS 100000
+
+//块内交易少于这个数量时不值得启动工作线程预先恢复签名
+#define TAIYI_MIN_PARALLEL_SIGNATURE_RECOVERY 8
+
+//重放时预读线程最多领先应用线程的块数
+#define TAIYI_REPLAY_PREFETCH_BLOCKS 1024
+
 namespace taiyi { namespace chain {
 
     class database_impl
@@ -49,6 +66,26 @@ namespace taiyi { namespace chain {
         
         database&                                       _self;
         evaluator_registry< operation >                 _evaluator_registry;
+        
+        //后台刷盘线程，待刷盘的块号和统计数据都由 _flush_mutex 保护
+        std::thread                                     _flush_thread;
+        mutable std::mutex                              _flush_mutex;
+        std::condition_variable                         _flush_cv;
+        optional< uint32_t >                            _pending_flush_block;
+        bool                                            _flush_deferred = false;   //有待定交易，留给写线程在下一个块边界刷盘
+        bool                                            _flush_stop = false;
+        database::flush_stats                           _flush_stats;
+        
+        //签名预恢复的工作线程，第一次使用时创建，各块之间复用，close 时停止
+        //块应用线程发布任务后自己也参与，_recovery_generation 每发布一次加一，工作线程各执行一次后递减 _recovery_running
+        std::vector< std::thread >                      _recovery_threads;
+        std::mutex                                      _recovery_mutex;
+        std::condition_variable                         _recovery_cv;
+        std::condition_variable                         _recovery_done_cv;
+        const std::function< void() >*                  _recovery_job = nullptr;
+        uint64_t                                        _recovery_generation = 0;
+        size_t                                          _recovery_running = 0;
+        bool                                            _recovery_stop = false;
     };
 
     database_impl::database_impl( database& self )
@@ -61,6 +98,8 @@ namespace taiyi { namespace chain {
 
     database::~database()
     {
+        stop_async_flush();
+        stop_signature_recovery_pool();
         clear_pending();
     }
 
@@ -71,6 +110,12 @@ namespace taiyi { namespace chain {
         initialize_indexes();
         initialize_evaluators();
         
+        if( args.load_snapshot_dir.valid() ) {
+            with_write_lock( [&]() {
+                import_snapshot( *args.load_snapshot_dir );
+            });
+        }
+        
         if( !find< dynamic_global_property_object >() ) {
             with_write_lock( [&]() {
                 init_genesis( args.initial_supply );
@@ -81,7 +126,7 @@ namespace taiyi { namespace chain {
         
         assert( args.data_dir.is_absolute() );
         chainbase::bfs::create_directories( args.data_dir );
-        _block_log.open( args.data_dir / "block_log" );
+        _block_log.open( args.data_dir / "block_log", args.compress_block_log );
         
         auto log_head = _block_log.head();
         
@@ -193,19 +238,55 @@ namespace taiyi { namespace chain {
                 skip_block_log;
             
             with_write_lock( [&]() {
-                _block_log.set_locking( false );
-                auto itr = _block_log.read_block( 0 );
                 auto last_block_num = _block_log.head()->block_num();
                 if( args.stop_replay_at > 0 && args.stop_replay_at < last_block_num )
                     last_block_num = args.stop_replay_at;
+                
+                //读取和反序列化交给预读线程，应用线程只按顺序取块
+                std::unique_ptr< block_prefetcher > prefetcher;
+                if( args.replay_prefetch_threads > 0 )
+                {
+                    ilog( "Prefetching blocks on ${n} threads", ("n", args.replay_prefetch_threads) );
+                    prefetcher.reset( new block_prefetcher( _block_log, 1, last_block_num, args.replay_prefetch_threads, TAIYI_REPLAY_PREFETCH_BLOCKS ) );
+                }
+                else
+                {
+                    _block_log.set_locking( false );
+                }
+                
+                uint64_t next_pos = _block_log.get_block_pos( 1 );
+                auto read_next_block = [&]() -> block_state_ptr {
+                    if( prefetcher )
+                        return prefetcher->next();
+                    auto itr = _block_log.read_block( next_pos );
+                    next_pos = itr.second;
+                    return block_state::create( std::move( itr.first ) );
+                };
+                
+                fc::microseconds apply_time;
+                auto report_stages = [&]( uint32_t block_num ) {
+                    auto rate = []( uint32_t blocks, const fc::microseconds& t ) { return t.count() > 0 ? uint64_t( blocks * 1000000.0 / t.count() ) : 0; };
+                    if( prefetcher )
+                    {
+                        auto s = prefetcher->get_stats();
+                        ilog( "Replay stages at block ${n}: read ${r} blocks/s, decode ${d} blocks/s (per thread), apply ${a} blocks/s, applier waited ${w} ms",
+                             ("n", block_num)("r", rate( s.blocks, s.read_time ))("d", rate( s.blocks, s.decode_time ))("a", rate( block_num, apply_time ))("w", s.consumer_wait.count() / 1000) );
+                    }
+                    else
+                    {
+                        ilog( "Replay stages at block ${n}: apply ${a} blocks/s", ("n", block_num)("a", rate( block_num, apply_time )) );
+                    }
+                };
+                
                 if( args.benchmark.first > 0 )
                 {
                     args.benchmark.second( 0, get_abstract_index_cntr() );
                 }
                 
-                while( itr.first.block_num() != last_block_num )
+                auto block = read_next_block();
+                while( block->get_block_num() != last_block_num )
                 {
-                    auto cur_block_num = itr.first.block_num();
+                    auto cur_block_num = block->get_block_num();
                     if( cur_block_num % 100000 == 0 )
                     {
                         std::cerr << "   " << double( cur_block_num ) * 100  / last_block_num << "%   " << cur_block_num << " of " << last_block_num << "   (" <<
@@ -214,7 +295,9 @@ namespace taiyi { namespace chain {
                         //rocksdb::SetPerfLevel(rocksdb::kEnableCount);
                         //rocksdb::get_perf_context()->Reset();
                     }
-                    apply_block( itr.first, skip_flags );
+                    auto apply_start = fc::time_point::now();
+                    apply_block( *block, skip_flags );
+                    apply_time += fc::time_point::now() - apply_start;
                     
                     if( cur_block_num % 100000 == 0 )
                     {
@@ -226,15 +309,23 @@ namespace taiyi { namespace chain {
                     }
                     
                     if( (args.benchmark.first > 0) && (cur_block_num % args.benchmark.first == 0) )
+                    {
                         args.benchmark.second( cur_block_num, get_abstract_index_cntr() );
-                    itr = _block_log.read_block( itr.second );
+                        report_stages( cur_block_num );
+                    }
+                    block = read_next_block();
                 }
                 
-                apply_block( itr.first, skip_flags );
-                note.last_block_number = itr.first.block_num();
+                auto apply_start = fc::time_point::now();
+                apply_block( *block, skip_flags );
+                apply_time += fc::time_point::now() - apply_start;
+                note.last_block_number = block->get_block_num();
                 
                 if( (args.benchmark.first > 0) && (note.last_block_number % args.benchmark.first == 0) )
                     args.benchmark.second( note.last_block_number, get_abstract_index_cntr() );
+                if( args.benchmark.first > 0 )
+                    report_stages( note.last_block_number );
+                prefetcher.reset();
                 set_revision( head_block_num() );
                 _block_log.set_locking( true );
                 
@@ -276,6 +367,8 @@ namespace taiyi { namespace chain {
         // Since pop_block() will move tx's in the popped blocks into pending,
         // we have to clear_pending() after we're done popping to get a clean
         // DB state (issue #336).
+        stop_async_flush();
+        stop_signature_recovery_pool();
         clear_pending();
         
         undo_all();
@@ -355,6 +448,24 @@ namespace taiyi { namespace chain {
         return b->data;
     } FC_CAPTURE_AND_RETHROW() }
     
+    block_state_ptr database::fetch_block_state_by_id( const block_id_type& id )const
+    { try {
+        auto b = _fork_db.fetch_block( id );
+        if( b )
+            return b->state;
+        
+        uint32_t block_num = protocol::block_header::num_from_id( id );
+        if( block_num == 0 || block_num > _block_log.head_block_num() )
+            return block_state_ptr();
+        
+        auto packed = _block_log.read_serialized_block( block_num );
+        auto block = fc::raw::unpack_from_vector< signed_block >( packed );
+        if( block.id() != id )
+            return block_state_ptr();
+        
+        return block_state::create( std::move( block ), std::move( packed ) );
+    } FC_CAPTURE_AND_RETHROW( (id) ) }
+    
     optional<signed_block> database::fetch_block_by_number( uint32_t block_num )const
     { try {
         optional< signed_block > b;
@@ -412,7 +523,7 @@ namespace taiyi { namespace chain {
         if(!_block_log.head())
             return;
         
-        auto itr = _block_log.read_block( 0 );
+        auto itr = _block_log.read_block( _block_log.get_block_pos( 1 ) );
         auto last_block_num = _block_log.head()->block_num();
         signed_block_header previousBlockHeader = itr.first;
         while( itr.first.block_num() != last_block_num )
@@ -521,15 +632,21 @@ namespace taiyi { namespace chain {
      * @return true if we switched forks as a result of this push.
      */
     bool database::push_block(const signed_block& new_block, uint32_t skip)
+    {
+        return push_block( block_state::create( new_block ), skip );
+    }
+    
+    bool database::push_block(const block_state_ptr& new_state, uint32_t skip)
     {
         //fc::time_point begin_time = fc::time_point::now();
         
-        auto block_num = new_block.block_num();
+        const signed_block& new_block = new_state->get_block();
+        auto block_num = new_state->get_block_num();
         if( _checkpoints.size() && _checkpoints.rbegin()->second != block_id_type() )
         {
             auto itr = _checkpoints.find( block_num );
             if( itr != _checkpoints.end() )
-                FC_ASSERT( new_block.id() == itr->second, "Block did not match checkpoint", ("checkpoint",*itr)("block_id",new_block.id()) );
+                FC_ASSERT( new_state->get_id() == itr->second, "Block did not match checkpoint", ("checkpoint",*itr)("block_id",new_state->get_id()) );
             
             if( _checkpoints.rbegin()->first >= block_num )
                 skip = skip_siming_signature
@@ -552,7 +669,7 @@ namespace taiyi { namespace chain {
             detail::without_pending_transactions( *this, std::move(_pending_tx), [&]() {
                 try
                 {
-                    result = _push_block(new_block);
+                    result = _push_block(new_state);
                 }
                 FC_CAPTURE_AND_RETHROW( (new_block) )                
             });
@@ -580,7 +697,7 @@ namespace taiyi { namespace chain {
         }
     }
 
-    bool database::_push_block(const signed_block& new_block)
+    bool database::_push_block(const block_state_ptr& new_block)
     { try {
         uint32_t skip = get_node_properties().skip_flags;
         //uint32_t skip_undo_db = skip & skip_undo_block;
@@ -597,8 +714,8 @@ namespace taiyi { namespace chain {
                 //Only switch forks if new_head is actually higher than head
                 if( new_head->data.block_num() > head_block_num() )
                 {
-                    wlog( "Switching to fork: ${id}", ("id",new_head->data.id()) );
-                    auto branches = _fork_db.fetch_branch_from(new_head->data.id(), head_block_id());
+                    wlog( "Switching to fork: ${id}", ("id",new_head->id) );
+                    auto branches = _fork_db.fetch_branch_from(new_head->id, head_block_id());
                     
                     // pop blocks until we hit the forked block
                     while( head_block_id() != branches.second.back()->data.previous )
@@ -607,13 +724,13 @@ namespace taiyi { namespace chain {
                     // push all blocks on the new fork
                     for( auto ritr = branches.first.rbegin(); ritr != branches.first.rend(); ++ritr )
                     {
-                        ilog( "pushing blocks from fork ${n} ${id}", ("n",(*ritr)->data.block_num())("id",(*ritr)->data.id()) );
+                        ilog( "pushing blocks from fork ${n} ${id}", ("n",(*ritr)->num)("id",(*ritr)->id) );
                         optional<fc::exception> except;
                         try
                         {
                             _fork_db.set_head( *ritr );
                             auto session = start_undo_session();
-                            apply_block( (*ritr)->data, skip );
+                            apply_block( *(*ritr)->state, skip );
                             session.push();
                         }
                         catch ( const fc::exception& e ) { except = e; }
@@ -623,7 +740,7 @@ namespace taiyi { namespace chain {
                             // remove the rest of branches.first from the fork_db, those blocks are invalid
                             while( ritr != branches.first.rend() )
                             {
-                                _fork_db.remove( (*ritr)->data.id() );
+                                _fork_db.remove( (*ritr)->id );
                                 ++ritr;
                             }
                             
@@ -636,7 +753,7 @@ namespace taiyi { namespace chain {
                             {
                                 _fork_db.set_head( *ritr );
                                 auto session = start_undo_session();
-                                apply_block( (*ritr)->data, skip );
+                                apply_block( *(*ritr)->state, skip );
                                 session.push();
                             }
                             throw *except;
@@ -652,13 +769,13 @@ namespace taiyi { namespace chain {
         try
         {
             auto session = start_undo_session();
-            apply_block(new_block, skip);
+            apply_block(*new_block, skip);
             session.push();
         }
         catch( const fc::exception& e )
         {
             elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
-            _fork_db.remove(new_block.id());
+            _fork_db.remove(new_block->get_id());
             throw;
         }
         
@@ -1477,6 +1594,12 @@ namespace taiyi { namespace chain {
             g_init_tiandao_property_object(p);
         } );
         
+        create< population_stats_object >( [&]( population_stats_object& s ) {
+            s.zone = zone_id_type::max();
+            s.living_by_zone_type.resize((int)_ZONE_TYPE_NUM, 0);
+            s.living_by_age.resize(population_stats_object::age_bucket_num, 0);
+        } );
+        
         for( int i = 0; i < 0x10000; i++ )
             create< block_summary_object >( [&]( block_summary_object& ) {});
         
@@ -1548,14 +1671,221 @@ namespace taiyi { namespace chain {
         _next_flush_block = 0;
     }
     
+    void database::set_signature_recovery_threads( uint32_t threads )
+    {
+        //线程数变化时旧的工作线程在下次使用前按新数量重建
+        if( threads != _signature_recovery_threads )
+            stop_signature_recovery_pool();
+        _signature_recovery_threads = threads;
+    }
+    
+    void database::start_signature_recovery_pool()
+    {
+        if( !_my->_recovery_threads.empty() || _signature_recovery_threads <= 1 )
+            return;
+        
+        _my->_recovery_stop = false;
+        //新线程从当前的任务代数开始等待，只有块应用线程发布任务，这里读取不会与发布冲突
+        const uint64_t start_generation = _my->_recovery_generation;
+        for( uint32_t t = 1; t < _signature_recovery_threads; ++t )
+        {
+            _my->_recovery_threads.emplace_back( [this, start_generation]() {
+                uint64_t seen_generation = start_generation;
+                std::unique_lock< std::mutex > lock( _my->_recovery_mutex );
+                while( true )
+                {
+                    _my->_recovery_cv.wait( lock, [&]() { return _my->_recovery_stop || _my->_recovery_generation != seen_generation; } );
+                    if( _my->_recovery_stop )
+                        return;
+                    
+                    seen_generation = _my->_recovery_generation;
+                    const auto* job = _my->_recovery_job;
+                    lock.unlock();
+                    (*job)();
+                    lock.lock();
+                    
+                    if( --_my->_recovery_running == 0 )
+                        _my->_recovery_done_cv.notify_one();
+                }
+            });
+        }
+    }
+    
+    void database::stop_signature_recovery_pool()
+    {
+        if( _my->_recovery_threads.empty() )
+            return;
+        
+        {
+            std::lock_guard< std::mutex > lock( _my->_recovery_mutex );
+            _my->_recovery_stop = true;
+        }
+        _my->_recovery_cv.notify_all();
+        for( auto& t : _my->_recovery_threads )
+            t.join();
+        _my->_recovery_threads.clear();
+    }
+    
+    void database::set_async_flush( bool async )
+    {
+        if( async == _my->_flush_thread.joinable() )
+            return;
+        
+        if( !async )
+        {
+            stop_async_flush();
+            return;
+        }
+        
+        _my->_flush_stop = false;
+        _my->_flush_thread = std::thread( [this]() {
+            while( true )
+            {
+                {
+                    std::unique_lock< std::mutex > lock( _my->_flush_mutex );
+                    _my->_flush_cv.wait( lock, [this]() { return _my->_flush_stop || ( _my->_pending_flush_block.valid() && !_my->_flush_deferred ); } );
+                    if( _my->_flush_stop )
+                        break;
+                }
+                
+                //拿到写锁时没有块或交易正在应用；写线程可能已经代为刷盘，所以在锁内再取块号
+                with_write_lock( [&]() {
+                    {
+                        std::lock_guard< std::mutex > lock( _my->_flush_mutex );
+                        if( !_my->_pending_flush_block.valid() )
+                            return;
+                        
+                        //待定交易已经写进状态，这时刷盘的状态版本会是头块加一，只能交给写线程在块边界刷盘
+                        if( _pending_tx_session.valid() )
+                        {
+                            _my->_flush_deferred = true;
+                            return;
+                        }
+                        
+                        _my->_pending_flush_block.reset();
+                    }
+                    
+                    flush_state( head_block_num(), false );
+                });
+            }
+        });
+    }
+    
+    database::flush_stats database::get_flush_stats()const
+    {
+        std::lock_guard< std::mutex > lock( _my->_flush_mutex );
+        return _my->_flush_stats;
+    }
+    
+    void database::schedule_flush( uint32_t block_num )
+    {
+        bool blocking = false;
+        if( _my->_flush_thread.joinable() )
+        {
+            std::unique_lock< std::mutex > lock( _my->_flush_mutex );
+            if( !_my->_pending_flush_block.valid() )
+            {
+                _my->_pending_flush_block = block_num;
+                lock.unlock();
+                _my->_flush_cv.notify_one();
+                return;
+            }
+            
+            //上一次刷盘还没轮到后台线程或被推迟，由写线程直接完成，两次合并为一次
+            _my->_pending_flush_block.reset();
+            _my->_flush_deferred = false;
+            blocking = true;
+        }
+        
+        flush_state( block_num, blocking );
+    }
+    
+    void database::run_deferred_flush( uint32_t block_num )
+    {
+        if( !_my->_flush_thread.joinable() )
+            return;
+        
+        {
+            std::lock_guard< std::mutex > lock( _my->_flush_mutex );
+            if( !_my->_flush_deferred )
+                return;
+            
+            _my->_pending_flush_block.reset();
+            _my->_flush_deferred = false;
+        }
+        
+        flush_state( block_num, true );
+    }
+    
+    //进程累计写到存储设备的字节数，读不到时为0
+    static uint64_t process_write_bytes()
+    {
+#ifdef __linux__
+        std::ifstream io( "/proc/self/io" );
+        std::string key;
+        uint64_t value = 0;
+        while( io >> key >> value )
+        {
+            if( key == "write_bytes:" )
+                return value;
+        }
+#endif
+        return 0;
+    }
+    
+    void database::flush_state( uint32_t block_num, bool blocking )
+    {
+        //刷盘期间持有写锁，其他写入都在等待，这段时间进程写出的字节基本都来自刷盘
+        uint64_t write_bytes = process_write_bytes();
+        fc::time_point start = fc::time_point::now();
+        chainbase::database::flush();
+        fc::microseconds duration = fc::time_point::now() - start;
+        uint64_t flushed_bytes = process_write_bytes() - write_bytes;
+        
+        {
+            std::lock_guard< std::mutex > lock( _my->_flush_mutex );
+            auto& stats = _my->_flush_stats;
+            ++stats.flush_count;
+            if( blocking )
+                ++stats.blocking_flushes;
+            stats.last_block_num = block_num;
+            stats.last_duration = duration;
+            stats.max_duration = std::max( stats.max_duration, duration );
+            stats.total_duration += duration;
+            stats.last_flushed_bytes = flushed_bytes;
+            stats.total_flushed_bytes += flushed_bytes;
+        }
+        
+        ilog( "Flushed database state at block ${b} in ${t} ms, ${n} bytes written${w}",
+             ("b", block_num)("t", duration.count() / 1000)("n", flushed_bytes)("w", blocking ? " (by the writer)" : "") );
+    }
+    
+    void database::stop_async_flush()
+    {
+        if( !_my->_flush_thread.joinable() )
+            return;
+        
+        {
+            std::lock_guard< std::mutex > lock( _my->_flush_mutex );
+            _my->_flush_stop = true;
+        }
+        _my->_flush_cv.notify_all();
+        _my->_flush_thread.join();
+        
+        //关闭数据库时会同步刷盘，未执行的请求直接丢弃
+        _my->_pending_flush_block.reset();
+        _my->_flush_deferred = false;
+    }
+    
     //////////////////// private methods ////////////////////
     
-    void database::apply_block( const signed_block& next_block, uint32_t skip )
+    void database::apply_block( const block_state& next_state, uint32_t skip )
     { try {
+        const signed_block& next_block = next_state.get_block();
         //fc::time_point begin_time = fc::time_point::now();
         
         detail::with_skip_flags( *this, skip, [&]() {
-            _apply_block( next_block );
+            _apply_block( next_state );
         } );
         
         try
@@ -1566,7 +1896,7 @@ namespace taiyi { namespace chain {
         }
         FC_CAPTURE_AND_RETHROW( (next_block) );
 
-        auto block_num = next_block.block_num();
+        auto block_num = next_state.get_block_num();
 
         //fc::time_point end_time = fc::time_point::now();
         //fc::microseconds dt = end_time - begin_time;
@@ -1592,16 +1922,21 @@ namespace taiyi { namespace chain {
             if( _next_flush_block == block_num )
             {
                 _next_flush_block = 0;
-                //ilog( "Flushing database state at block ${b}", ("b", block_num) );
-                chainbase::database::flush();
+                schedule_flush( block_num );
+            }
+            else
+            {
+                //块刚应用完、待定交易还没重新应用，状态正好是这个块
+                run_deferred_flush( block_num );
             }
         }
         
     } FC_CAPTURE_AND_RETHROW( (next_block) ) }
     
-    void database::_apply_block( const signed_block& next_block )
+    void database::_apply_block( const block_state& next_state )
     { try {
-        block_notification note( next_block );
+        const signed_block& next_block = next_state.get_block();
+        block_notification note( next_state );
         notify_pre_apply_block( note );
         
         const uint32_t next_block_num = note.block_num;
@@ -1611,6 +1946,9 @@ namespace taiyi { namespace chain {
         } BOOST_SCOPE_EXIT_END
         _currently_processing_block_id = note.block_id;
         
+        //硬分叉0.1之前合约每次都在新建的虚拟机中执行，drops与池化之前一致
+        lua_context_pool::instance().set_reuse_contexts( has_hardfork( TAIYI_HARDFORK_0_1 ) );
+        
         uint32_t skip = get_node_properties().skip_flags;
         
         _current_block_num    = next_block_num;
@@ -1655,11 +1993,11 @@ namespace taiyi { namespace chain {
         
         if( !( skip & skip_merkle_check ) )
         {
-            auto merkle_root = next_block.calculate_merkle_root();
+            const auto& merkle_root = next_state.get_merkle_root();
             
             try
             {
-                FC_ASSERT( next_block.transaction_merkle_root == merkle_root, "Merkle check failed", ("next_block.transaction_merkle_root",next_block.transaction_merkle_root)("calc",merkle_root)("next_block",next_block)("id",next_block.id()) );
+                FC_ASSERT( next_block.transaction_merkle_root == merkle_root, "Merkle check failed", ("next_block.transaction_merkle_root",next_block.transaction_merkle_root)("calc",merkle_root)("next_block",next_block)("id",note.block_id) );
             }
             catch( fc::assert_exception& e )
             {
@@ -1667,10 +2005,10 @@ namespace taiyi { namespace chain {
             }
         }
         
-        const siming_object& signing_siming = validate_block_header(skip, next_block);
+        const siming_object& signing_siming = validate_block_header(skip, next_state);
         
         const auto& gprops = get_dynamic_global_properties();
-        auto block_size = fc::raw::pack_size( next_block );
+        auto block_size = next_state.get_packed().size();
         FC_ASSERT( block_size <= gprops.maximum_block_size, "Block Size is too Big", ("next_block_num",next_block_num)("block_size", block_size)("max",gprops.maximum_block_size) );
         if( block_size < TAIYI_MIN_BLOCK_SIZE )
             elog( "Block size is too small", ("next_block_num",next_block_num)("block_size", block_size)("min",TAIYI_MIN_BLOCK_SIZE));
@@ -1690,6 +2028,10 @@ namespace taiyi { namespace chain {
                   ("siming",siming)("next_block.siming",next_block.siming)("hardfork_state", hardfork_state)
                   );
         
+        if( !( skip & ( skip_transaction_signatures | skip_authority_check ) ) )
+            prerecover_signature_keys( next_state );
+        
+        const auto& trx_ids = next_state.get_transaction_ids();
         for( const auto& trx : next_block.transactions )
         {
             /* We do not need to push the undo state for each transaction
@@ -1703,7 +2045,8 @@ namespace taiyi { namespace chain {
              * 然而，为了不影响当前节点的状态，对广播来的交易（自己收交易请求api也走的
              * 广播）的验证，以及在出块时候对打包交易的验证，都是需要专门的回滚操作的。
              */
-            apply_transaction( trx, skip );
+            //交易id已在块状态中算好，跳过标志也已由 apply_block 设置
+            _apply_transaction( trx, trx_ids[ _current_trx_in_block ] );
             ++_current_trx_in_block;
         }
         
@@ -1749,7 +2092,7 @@ namespace taiyi { namespace chain {
         
         trim_cache();
         
-    } FC_CAPTURE_LOG_AND_RETHROW( (next_block.block_num()) ) }
+    } FC_CAPTURE_LOG_AND_RETHROW( (next_state.get_block_num()) ) }
 
     struct process_header_visitor
     {
@@ -1804,13 +2147,20 @@ namespace taiyi { namespace chain {
     }
     
     void database::_apply_transaction(const signed_transaction& trx)
+    {
+        _apply_transaction( trx, trx.id() );
+    }
+    
+    void database::_apply_transaction(const signed_transaction& trx, const transaction_id_type& id)
     { try {
-        transaction_notification note(trx);
+        transaction_notification note(trx, id);
         _current_trx_id = note.transaction_id;
         _current_trx = &trx;
         const transaction_id_type& trx_id = note.transaction_id;
         _current_virtual_op = 0;
         
+        lua_context_pool::instance().set_reuse_contexts( has_hardfork( TAIYI_HARDFORK_0_1 ) );
+        
         uint32_t skip = get_node_properties().skip_flags;
         
         if( !(skip&skip_validate) )   /* issue #505 explains why this skip_flag is disabled */
@@ -1831,8 +2181,11 @@ namespace taiyi { namespace chain {
             
             try
             {
-                trx.verify_authority( chain_id, get_active, get_owner, get_posting, TAIYI_MAX_SIG_CHECK_DEPTH,
-                                     TAIYI_MAX_AUTHORITY_MEMBERSHIP, TAIYI_MAX_SIG_CHECK_ACCOUNTS, fc::ecc::bip_0062);
+                //同 signed_transaction::verify_authority，出错时带上交易内容
+                try {
+                    protocol::verify_authority( trx.operations, get_signature_keys( trx, trx_id, fc::ecc::bip_0062 ), get_active, get_owner, get_posting,
+                                               TAIYI_MAX_SIG_CHECK_DEPTH, TAIYI_MAX_AUTHORITY_MEMBERSHIP, TAIYI_MAX_SIG_CHECK_ACCOUNTS );
+                } FC_CAPTURE_AND_RETHROW( (trx) )
             }
             catch( protocol::tx_missing_active_auth& e )
             {
@@ -2041,14 +2394,15 @@ namespace taiyi { namespace chain {
         return connect_impl(_post_reindex_signal, func, plugin, group, "<-reindex");
     }
 
-    const siming_object& database::validate_block_header( uint32_t skip, const signed_block& next_block )const
+    const siming_object& database::validate_block_header( uint32_t skip, const block_state& next_state )const
     { try {
+        const signed_block& next_block = next_state.get_block();
         FC_ASSERT( head_block_id() == next_block.previous, "", ("head_block_id",head_block_id())("next.prev",next_block.previous) );
         FC_ASSERT( head_block_time() < next_block.timestamp, "", ("head_block_time",head_block_time())("next",next_block.timestamp)("blocknum",next_block.block_num()) );
         const siming_object& siming = get_siming( next_block.siming );
         
         if( !(skip&skip_siming_signature) )
-            FC_ASSERT( next_block.validate_signee( siming.signing_key, fc::ecc::bip_0062 ) );
+            FC_ASSERT( next_state.validate_signee( siming.signing_key, fc::ecc::bip_0062 ) );
         
         if( !(skip&skip_siming_schedule_check) )
         {
@@ -2067,7 +2421,8 @@ namespace taiyi { namespace chain {
     { try {
         block_summary_id_type sid( next_block.block_num() & 0xffff );
         modify( get< block_summary_object >( sid ), [&](block_summary_object& p) {
-            p.block_id = next_block.id();
+            // _currently_processing_block_id is always set by _apply_block
+            p.block_id = *_currently_processing_block_id;
         });
     } FC_CAPTURE_AND_RETHROW() }
     
@@ -2218,7 +2573,7 @@ namespace taiyi { namespace chain {
                 
                 for( auto block_itr = blocks_to_write.begin(); block_itr != blocks_to_write.end(); ++block_itr )
                 {
-                    _block_log.append( block_itr->get()->data );
+                    _block_log.append( *block_itr->get()->state );
                 }
                 
                 _block_log.flush();
@@ -2240,6 +2595,123 @@ namespace taiyi { namespace chain {
         const auto& dedupe_index = transaction_idx.indices().get< by_expiration >();
         while( ( !dedupe_index.empty() ) && ( head_block_time() > dedupe_index.begin()->expiration ) )
             remove( *dedupe_index.begin() );
+        
+        //过期的交易不会再被应用，其签名公钥缓存也一并清除
+        auto& keys_by_exp = _trx_signature_keys.get< by_trx_expiration >();
+        keys_by_exp.erase( keys_by_exp.begin(), keys_by_exp.lower_bound( head_block_time() ) );
+    }
+    
+    const flat_set<public_key_type>& database::get_signature_keys( const signed_transaction& trx, const transaction_id_type& trx_id, fc::ecc::canonical_signature_type canon_type )
+    {
+        const auto& keys_by_trx = _trx_signature_keys.get< by_trx_canon >();
+        auto itr = keys_by_trx.find( boost::make_tuple( trx_id, canon_type ) );
+        if( itr != keys_by_trx.end() && itr->signatures == trx.signatures )
+        {
+            auto& keys_by_recency = _trx_signature_keys.get< by_recency >();
+            keys_by_recency.relocate( keys_by_recency.begin(), _trx_signature_keys.project< by_recency >( itr ) );
+            return itr->keys;
+        }
+        
+        //恢复失败（签名不规范、重复签名）时直接抛出，不留下缓存
+        return cache_signature_keys( trx, trx_id, canon_type, trx.get_signature_keys( get_chain_id(), canon_type ) );
+    }
+    
+    const flat_set<public_key_type>* database::find_cached_signature_keys( const signed_transaction& trx, const transaction_id_type& trx_id, fc::ecc::canonical_signature_type canon_type )const
+    {
+        const auto& keys_by_trx = _trx_signature_keys.get< by_trx_canon >();
+        auto itr = keys_by_trx.find( boost::make_tuple( trx_id, canon_type ) );
+        if( itr != keys_by_trx.end() && itr->signatures == trx.signatures )
+            return &itr->keys;
+        
+        return nullptr;
+    }
+    
+    const flat_set<public_key_type>& database::cache_signature_keys( const signed_transaction& trx, const transaction_id_type& trx_id, fc::ecc::canonical_signature_type canon_type, flat_set<public_key_type>&& keys )
+    {
+        auto& keys_by_trx = _trx_signature_keys.get< by_trx_canon >();
+        auto itr = keys_by_trx.find( boost::make_tuple( trx_id, canon_type ) );
+        if( itr != keys_by_trx.end() )
+        {
+            keys_by_trx.modify( itr, [&]( recovered_signature_keys& entry ) {
+                entry.signatures = trx.signatures;
+                entry.keys = std::move( keys );
+                entry.expiration = trx.expiration;
+            });
+        }
+        else
+        {
+            recovered_signature_keys entry;
+            entry.trx_id = trx_id;
+            entry.canon_type = canon_type;
+            entry.signatures = trx.signatures;
+            entry.keys = std::move( keys );
+            entry.expiration = trx.expiration;
+            itr = keys_by_trx.insert( std::move( entry ) ).first;
+        }
+        
+        auto& keys_by_recency = _trx_signature_keys.get< by_recency >();
+        keys_by_recency.relocate( keys_by_recency.begin(), _trx_signature_keys.project< by_recency >( itr ) );
+        while( keys_by_recency.size() > TAIYI_MAX_CACHED_SIGNATURE_KEYS )
+            keys_by_recency.pop_back();
+        
+        return itr->keys;
+    }
+    
+    void database::prerecover_signature_keys( const block_state& next_block )
+    {
+        const auto& transactions = next_block.get_block().transactions;
+        const auto& trx_ids = next_block.get_transaction_ids();
+        if( _signature_recovery_threads <= 1 || transactions.size() < TAIYI_MIN_PARALLEL_SIGNATURE_RECOVERY )
+            return;
+        
+        //签名恢复只依赖交易本身和链id，工作线程不接触任何数据库状态
+        vector< optional< flat_set<public_key_type> > > results( transactions.size() );
+        const chain_id_type& chain_id = get_chain_id();
+        
+        std::atomic< size_t > next_trx( 0 );
+        std::function< void() > worker = [&]() {
+            for( size_t i = next_trx++; i < transactions.size(); i = next_trx++ )
+            {
+                try
+                {
+                    results[i] = transactions[i].get_signature_keys( chain_id, fc::ecc::bip_0062 );
+                }
+                catch( ... )
+                {
+                    //失败的交易留给串行应用时重新恢复并抛出确切的异常
+                }
+            }
+        };
+        
+        //交给常驻的工作线程，块应用线程也一起领取交易，全部完成后才继续
+        start_signature_recovery_pool();
+        {
+            std::lock_guard< std::mutex > lock( _my->_recovery_mutex );
+            _my->_recovery_job = &worker;
+            _my->_recovery_running = _my->_recovery_threads.size();
+            ++_my->_recovery_generation;
+        }
+        _my->_recovery_cv.notify_all();
+        worker();
+        {
+            std::unique_lock< std::mutex > lock( _my->_recovery_mutex );
+            _my->_recovery_done_cv.wait( lock, [&]() { return _my->_recovery_running == 0; } );
+            _my->_recovery_job = nullptr;
+        }
+        
+        for( size_t i = 0; i < transactions.size(); ++i )
+        {
+            if( !results[i].valid() )
+                continue;
+            
+            cache_signature_keys( transactions[i], trx_ids[i], fc::ecc::bip_0062, std::move( *results[i] ) );
+        }
+    }
+    
+    const flat_set<public_key_type>& database::get_current_trx_signature_keys()
+    {
+        FC_ASSERT( _current_trx );
+        return get_signature_keys( *_current_trx, _current_trx_id, fc::ecc::fc_canonical );
     }
     
     void database::clear_expired_delegations()
@@ -2566,6 +3038,9 @@ namespace taiyi { namespace chain {
     {
         _hardfork_versions.times[ 0 ] = fc::time_point_sec( TAIYI_GENESIS_TIME );
         _hardfork_versions.versions[ 0 ] = hardfork_version( 0, 0 );
+        FC_ASSERT( TAIYI_HARDFORK_0_1 == 1, "Invalid hardfork configuration" );
+        _hardfork_versions.times[ TAIYI_HARDFORK_0_1 ] = fc::time_point_sec( TAIYI_HARDFORK_0_1_TIME );
+        _hardfork_versions.versions[ TAIYI_HARDFORK_0_1 ] = TAIYI_HARDFORK_0_1_VERSION;
         
         const auto& hardforks = get_hardfork_property_object();
         FC_ASSERT( hardforks.last_hardfork <= TAIYI_NUM_HARDFORKS, "Chain knows of more hardforks than configuration", ("hardforks.last_hardfork",hardforks.last_hardfork)("TAIYI_NUM_HARDFORKS",TAIYI_NUM_HARDFORKS) );
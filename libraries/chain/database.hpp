@@ -5,6 +5,7 @@
 #include <chain/hardfork_property_object.hpp>
 #include <chain/node_property_object.hpp>
 #include <chain/notifications.hpp>
+#include <chain/zone_router.hpp>
 
 #include <chain/util/advanced_benchmark_dumper.hpp>
 #include <chain/util/signal.hpp>
@@ -18,6 +19,12 @@
 
 #include <fc/log/logger.hpp>
 
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
 #include <functional>
 #include <map>
 
@@ -41,9 +48,18 @@ namespace taiyi { namespace chain {
     class LuaContext;
 
     using set_index_type_func = std::function< void(database&, mira::index_type, const boost::filesystem::path&, const boost::any&) >;
+
+    //快照按段顺序读写，每个索引一段
+    using snapshot_sink = std::function< void(const char*, size_t) >;
+    using snapshot_source = std::function< void(char*, size_t) >;
+    using write_snapshot_func = std::function< uint64_t(const database&, const snapshot_sink&) >;
+    using read_snapshot_func = std::function< uint64_t(database&, const snapshot_source&) >;
+
     struct index_delegate
     {
         set_index_type_func set_index_type;
+        write_snapshot_func write_snapshot;
+        read_snapshot_func  read_snapshot;
     };
 
     using index_delegate_map = std::map< std::string, index_delegate >;
@@ -111,9 +127,12 @@ namespace taiyi { namespace chain {
             fc::variant database_cfg;
             bool replay_in_memory = false;
             std::vector< std::string > replay_memory_indices{};
+            fc::optional< fc::path > load_snapshot_dir;
+            bool compress_block_log = false;   ///< only applies when a new block log is created
 
             // The following fields are only used on reindexing
             uint32_t stop_replay_at = 0;
+            uint32_t replay_prefetch_threads = 0;   ///< threads reading and unpacking blocks ahead of the applier, 0 reads on the applier thread
             TBenchmark benchmark = TBenchmark(0, []( uint32_t, const abstract_index_cntr_t& ){});
         };
 
@@ -158,6 +177,8 @@ namespace taiyi { namespace chain {
         block_id_type              get_block_id_for_num( uint32_t block_num )const;
         optional<signed_block>     fetch_block_by_id( const block_id_type& id )const;
         optional<signed_block>     fetch_block_by_number( uint32_t num )const;
+        /// 分叉库中的块直接返回共享的块状态，块日志中的块复用日志里的打包字节，找不到时返回空指针
+        block_state_ptr            fetch_block_state_by_id( const block_id_type& id )const;
         const signed_transaction   get_recent_transaction( const transaction_id_type& trx_id )const;
         std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
 
@@ -199,9 +220,11 @@ namespace taiyi { namespace chain {
         bool before_last_checkpoint()const;
 
         bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
+        /// 块id、摘要、默克尔根等已在 block_state 中算好，推荐在写线程之外创建后再推入
+        bool push_block( const block_state_ptr& b, uint32_t skip = skip_nothing );
         void push_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
         void _maybe_warn_multiple_production( uint32_t height )const;
-        bool _push_block( const signed_block& b );
+        bool _push_block( const block_state_ptr& b );
         void _push_transaction( const signed_transaction& trx );
 
         void pop_block();
@@ -346,14 +369,21 @@ namespace taiyi { namespace chain {
         void born_actor( const actor_object& act, int gender, int sexuality, const string& zone_name );
         void try_trigger_actor_talents( const actor_object& act, uint16_t age );
         void try_trigger_actor_contract_grow( const actor_object& act );
+        void schedule_actor_tick( const actor_object& act, const time_point_sec& tick_time );
 
         //************ database_zone.cpp ************//
 
         const tiandao_property_object& get_tiandao_properties()const;
+        const population_stats_object& get_population_stats()const;
+        const population_stats_object* find_population_stats( const zone_id_type& zone )const;
+        void adjust_population_stats( const actor_object& act, int32_t delta );
+        void change_zone_type( const zone_object& zone, E_ZONE_TYPE type );
         void initialize_zone_object( zone_object& zone, const std::string& name, const nfa_object& nfa, E_ZONE_TYPE type );
         const zone_object&  get_zone(  const std::string& name )const;
         const zone_object*  find_zone( const std::string& name )const;
         int calculate_moving_days_to_zone( const zone_object& zone );
+        /** 从from沿连接到to的最短路径，不含起点，含终点，不可达时为空。weighted为真时按移动天数，否则按经过的区域数 */
+        std::vector<zone_id_type> find_zone_route( const zone_object& from, const zone_object& to, bool weighted )const;
         void process_tiandao();
         
         //************ database_cultivation.cpp ************//
@@ -398,6 +428,69 @@ namespace taiyi { namespace chain {
 
         void set_flush_interval( uint32_t flush_blocks );
 
+        /**
+         * 收到区块后在串行应用交易之前，用多个线程预先恢复块内所有交易的签名公钥。
+         * threads 不大于1时保持原来的串行恢复。工作线程第一次使用时创建，各块之间复用，close 时停止。
+         */
+        void set_signature_recovery_threads( uint32_t threads );
+
+        struct flush_stats
+        {
+            uint32_t            flush_count = 0;
+            uint32_t            blocking_flushes = 0;   ///< scheduled flushes the writer ran itself: the previous one was still pending, or pending transactions deferred it to a block boundary
+            uint32_t            last_block_num = 0;
+            fc::microseconds    last_duration;
+            fc::microseconds    max_duration;
+            fc::microseconds    total_duration;
+            uint64_t            last_flushed_bytes = 0;     ///< bytes the process wrote to storage during the last flush (0 where /proc/self/io is unavailable)
+            uint64_t            total_flushed_bytes = 0;
+        };
+
+        /**
+         * Moves the periodic state flush out of block application: the writer only records the block number and a
+         * background thread runs the flush once it holds the write lock. The flush itself still runs under the write
+         * lock, so writers queued behind it wait for the whole flush; only the block being applied no longer pays for it.
+         * The background thread flushes only when no pending transactions are applied, so the state on disk is always
+         * at a block boundary (revision equals the head block). Otherwise it hands the flush back to the writer, which
+         * runs it at the end of the next block, before pending transactions are re-applied. If the previous flush is
+         * still pending when the next one is due, the writer flushes directly.
+         *
+         * Must only be enabled once every state write goes through with_write_lock (after replay, before the write
+         * queue starts).
+         */
+        void set_async_flush( bool async );
+        flush_stats get_flush_stats()const;
+
+        struct snapshot_section
+        {
+            std::string         index_name;
+            uint64_t            object_count = 0;
+            uint64_t            size = 0;
+            fc::sha256          checksum;
+        };
+
+        struct snapshot_manifest
+        {
+            uint32_t                        format_version = 0;
+            protocol::version               blockchain_version;
+            chain_id_type                   chain_id;
+            uint32_t                        head_block_num = 0;
+            block_id_type                   head_block_id;
+            std::vector< snapshot_section > sections;
+        };
+
+        /**
+         * 把所有索引写成快照目录：每个索引一个段文件（多线程并行写出），外加记录校验和的 manifest.json。
+         * 只应在没有可逆状态时调用（刚打开或重放结束后），此时状态对应不可逆的头块。
+         */
+        snapshot_manifest export_snapshot( const fc::path& dir )const;
+
+        /**
+         * 校验快照后直接批量载入各索引，不经过评估器，并把版本号设为快照头块号。
+         * 之后的 open 流程仍然要求区块日志里包含快照的头块。
+         */
+        snapshot_manifest import_snapshot( const fc::path& dir );
+
         void apply_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
 
         optional< chainbase::database::session >& pending_transaction_session();
@@ -423,6 +516,7 @@ namespace taiyi { namespace chain {
         size_t create_nfa_symbol_object(const account_object& creator, const string& symbol, const string& describe, const string& default_contract);
         void modify_nfa_children_owner(const nfa_object& nfa, const account_object& new_owner, std::set<nfa_id_type>& recursion_loop_check);
         int get_nfa_five_phase(const nfa_object& nfa) const;
+        void schedule_nfa_tick(const nfa_object& nfa, const time_point_sec& tick_time);
 
     protected:
         //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
@@ -432,20 +526,25 @@ namespace taiyi { namespace chain {
         void process_nfa_tick();
         void process_actor_tick();
 
+        //心跳时间轮：按到期时刻分桶追加实体id，到期时按(心跳时间, id)顺序取出仍有效的实体
+        void push_tick_schedule( E_TICK_SCHEDULE_TYPE type, const time_point_sec& tick_time, const std::vector<int64_t>& entities );
+        std::vector<int64_t> pop_due_ticks( E_TICK_SCHEDULE_TYPE type, const time_point_sec& now, size_t max_count, const std::function<bool(int64_t, const time_point_sec&)>& is_scheduled );
+
     private:
         bool _is_producing = false;
         bool _log_hardforks = true;
         optional< chainbase::database::session > _pending_tx_session;
 
-        void apply_block( const signed_block& next_block, uint32_t skip = skip_nothing );
-        void _apply_block( const signed_block& next_block );
+        void apply_block( const block_state& next_block, uint32_t skip = skip_nothing );
+        void _apply_block( const block_state& next_block );
         void _apply_transaction( const signed_transaction& trx );
+        void _apply_transaction( const signed_transaction& trx, const transaction_id_type& trx_id );
         operation_result apply_operation( const operation& op );
 
         ///Steps involved in applying a new block
         ///@{
 
-        const siming_object& validate_block_header( uint32_t skip, const signed_block& next_block )const;
+        const siming_object& validate_block_header( uint32_t skip, const block_state& next_block )const;
         void create_block_summary(const signed_block& next_block);
 
         void update_global_dynamic_data( const signed_block& b );
@@ -484,6 +583,18 @@ namespace taiyi { namespace chain {
 
         const transaction_id_type& get_current_trx() const { return _current_trx_id; }
         const signed_transaction* get_current_trx_ptr() const { return _current_trx; }
+        
+        /**
+         * Keys recovered from the signatures of trx, memoized per transaction id and canonical type
+         * in a bounded LRU cache until the transaction expires. Mempool pushes, pending transactions
+         * re-applied by the block producer and after each block, and the final block apply all share
+         * one public key recovery.
+         */
+        const flat_set<public_key_type>& get_signature_keys( const signed_transaction& trx, const transaction_id_type& trx_id, fc::ecc::canonical_signature_type canon_type );
+        /** keys already cached for trx, or nullptr; never recovers and does not touch the LRU order */
+        const flat_set<public_key_type>* find_cached_signature_keys( const signed_transaction& trx, const transaction_id_type& trx_id, fc::ecc::canonical_signature_type canon_type )const;
+        /** signing keys of the transaction being applied, as used by contract evaluators */
+        const flat_set<public_key_type>& get_current_trx_signature_keys();
         uint16_t get_current_op_in_trx() const { return _current_op_in_trx; }
 
         util::advanced_benchmark_dumper& get_benchmark_dumper() { return _benchmark_dumper; }
@@ -504,6 +615,51 @@ namespace taiyi { namespace chain {
 
         transaction_id_type           _current_trx_id;
         const signed_transaction*     _current_trx = 0;
+        
+        struct recovered_signature_keys
+        {
+            transaction_id_type                 trx_id;
+            fc::ecc::canonical_signature_type   canon_type;
+            vector<signature_type>              signatures;
+            flat_set<public_key_type>           keys;
+            fc::time_point_sec                  expiration;
+        };
+        
+        struct by_recency;
+        struct by_trx_canon;
+        struct by_trx_expiration;
+        typedef boost::multi_index_container<
+            recovered_signature_keys,
+            boost::multi_index::indexed_by<
+                boost::multi_index::sequenced< boost::multi_index::tag< by_recency > >,
+                boost::multi_index::ordered_unique< boost::multi_index::tag< by_trx_canon >,
+                    boost::multi_index::composite_key< recovered_signature_keys,
+                        boost::multi_index::member< recovered_signature_keys, transaction_id_type, &recovered_signature_keys::trx_id >,
+                        boost::multi_index::member< recovered_signature_keys, fc::ecc::canonical_signature_type, &recovered_signature_keys::canon_type >
+                    >
+                >,
+                boost::multi_index::ordered_non_unique< boost::multi_index::tag< by_trx_expiration >,
+                    boost::multi_index::member< recovered_signature_keys, fc::time_point_sec, &recovered_signature_keys::expiration >
+                >
+            >
+        > signature_keys_cache_type;
+        
+        //交易id不含签名，命中时还要核对签名本身；最久未用的条目在超出容量时先被淘汰
+        signature_keys_cache_type     _trx_signature_keys;
+        
+        const flat_set<public_key_type>& cache_signature_keys( const signed_transaction& trx, const transaction_id_type& trx_id, fc::ecc::canonical_signature_type canon_type, flat_set<public_key_type>&& keys );
+        void prerecover_signature_keys( const block_state& next_block );
+        void start_signature_recovery_pool();
+        void stop_signature_recovery_pool();
+        
+        //区域寻路的邻接表快照和路径缓存，按区域索引的变更计数自行失效
+        mutable zone_router           _zone_router;
+        
+        void schedule_flush( uint32_t block_num );
+        void run_deferred_flush( uint32_t block_num );
+        void flush_state( uint32_t block_num, bool blocking );
+        void stop_async_flush();
+        
         uint32_t                      _current_block_num    = 0;
         int32_t                       _current_trx_in_block = 0;
         uint16_t                      _current_op_in_trx    = 0;
@@ -516,6 +672,7 @@ namespace taiyi { namespace chain {
         node_property_object          _node_property_object;
 
         uint32_t                      _flush_blocks = 0;
+        uint32_t                      _signature_recovery_threads = 1;
         uint32_t                      _next_flush_block = 0;
 
         flat_map< custom_id_type, std::shared_ptr< custom_operation_interpreter > >   _custom_operation_interpreters;
@@ -599,3 +756,7 @@ namespace taiyi { namespace chain {
     };
 
 } } //taiyi::chain
+
+FC_REFLECT( taiyi::chain::database::flush_stats, (flush_count)(blocking_flushes)(last_block_num)(last_duration)(max_duration)(total_duration)(last_flushed_bytes)(total_flushed_bytes) )
+FC_REFLECT( taiyi::chain::database::snapshot_section, (index_name)(object_count)(size)(checksum) )
+FC_REFLECT( taiyi::chain::database::snapshot_manifest, (format_version)(blockchain_version)(chain_id)(head_block_num)(head_block_id)(sections) )
@@ -17,8 +17,10 @@
 #include <chain/actor_objects.hpp>
 #include <chain/zone_objects.hpp>
 #include <chain/contract_objects.hpp>
+#include <chain/tick_schedule_object.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/contract_worker.hpp>
 
 #include <chain/util/uint256.hpp>
@@ -32,6 +34,7 @@
 
 #include <iostream>
 
+#include <algorithm>
 #include <cstdint>
 #include <deque>
 #include <fstream>
@@ -51,7 +54,8 @@ namespace taiyi { namespace chain {
     //=============================================================================
     void database::initialize_actor_talent_rule_object(const account_object& creator, actor_talent_rule_object& rule)
     {
-        LuaContext context;
+        pooled_lua_context pooled_context;
+        LuaContext& context = pooled_context.single_call();
         initialize_VM_baseENV(context);
         flat_set<public_key_type> sigkeys;
         contract_worker worker;
@@ -72,6 +76,47 @@ namespace taiyi { namespace chain {
         auto it_amodifier = result_table.v.find(lua_types(lua_string("init_attribute_amount_modifier")));
         if(it_amodifier != result_table.v.end())
             rule.init_attribute_amount_modifier = it_amodifier->second.get<lua_int>().v;
+        
+        //可选的触发条件，触发前按条件过滤，只有可能触发的天赋才会运行 trigger 函数
+        if(!has_hardfork(TAIYI_HARDFORK_0_1))
+            return;
+        
+        auto read_int = [](const lua_types& v, const char* field) -> int64_t {
+            FC_ASSERT(v.which() == nlua_int, "talent contract init data invalid, \"${f}\" must be an integer", ("f", field));
+            return v.get<lua_int>().v;
+        };
+        auto read_age = [&](const lua_types& v, const char* field) -> uint16_t {
+            return (uint16_t)std::min<int64_t>(std::max<int64_t>(read_int(v, field), 0), std::numeric_limits<uint16_t>::max());
+        };
+        
+        auto it_max_triggers = result_table.v.find(lua_types(lua_string("max_triggers")));
+        if(it_max_triggers != result_table.v.end()) {
+            int64_t max_triggers = read_int(it_max_triggers->second, "max_triggers");
+            FC_ASSERT(max_triggers > 0 && max_triggers <= std::numeric_limits<int>::max(), "talent contract init data invalid, \"max_triggers\" must be positive");
+            rule.max_triggers = (int)max_triggers;
+        }
+        
+        auto it_min_age = result_table.v.find(lua_types(lua_string("min_age")));
+        if(it_min_age != result_table.v.end())
+            rule.min_trigger_age = read_age(it_min_age->second, "min_age");
+        auto it_max_age = result_table.v.find(lua_types(lua_string("max_age")));
+        if(it_max_age != result_table.v.end())
+            rule.max_trigger_age = read_age(it_max_age->second, "max_age");
+        FC_ASSERT(rule.min_trigger_age <= rule.max_trigger_age, "talent contract init data invalid, \"min_age\" is greater than \"max_age\"");
+        
+        auto it_min_attributes = result_table.v.find(lua_types(lua_string("min_attributes")));
+        if(it_min_attributes != result_table.v.end()) {
+            FC_ASSERT(it_min_attributes->second.which() == nlua_table, "talent contract init data invalid, \"min_attributes\" must be a table");
+            const auto& names = actor_core_attributes_object::attribute_names();
+            for(const auto& p : it_min_attributes->second.get<lua_table>().v) {
+                FC_ASSERT(p.first.key.which() == nlua_string, "talent contract init data invalid, keys of \"min_attributes\" must be attribute names");
+                const auto& name = p.first.key.get<lua_string>().v;
+                auto itn = std::find(names.begin(), names.end(), name);
+                FC_ASSERT(itn != names.end(), "talent contract init data invalid, unknown attribute \"${n}\" in \"min_attributes\"", ("n", name));
+                int64_t min_value = read_int(p.second, "min_attributes");
+                rule.min_attributes[(uint8_t)(itn - names.begin())] = (int16_t)std::min<int64_t>(std::max<int64_t>(min_value, std::numeric_limits<int16_t>::min()), std::numeric_limits<int16_t>::max());
+            }
+        }
     }
     //=============================================================================
     void database::initialize_actor_talents( const actor_object& act )
@@ -166,6 +211,7 @@ namespace taiyi { namespace chain {
         const auto& tiandao = get_tiandao_properties();
         
         //update actor
+        adjust_population_stats(act, -1);
         modify( act, [&]( actor_object& a ) {
             a.age = 0;
             
@@ -185,8 +231,9 @@ namespace taiyi { namespace chain {
             a.standpoint = (hasher::hash( seed + a.id + 1619) % 1000);
 
             a.last_update = now;
-            a.next_tick_time = now; //will active actor tick
         });
+        adjust_population_stats(act, 1);
+        schedule_actor_tick(act, now); //will active actor tick
                         
         //grow as first birthday
         try_trigger_actor_talents(act, 0);
@@ -207,29 +254,28 @@ namespace taiyi { namespace chain {
         auto now = head_block_time();
 
         //list Actors this tick will sim
-        const auto& actor_idx = get_index< actor_index, by_tick_time >();
+        const auto& actor_idx = get_index< actor_index, by_id >();
         auto run_num = actor_idx.size() / TAIYI_ACTOR_TICK_PERIOD_MAX_BLOCK_NUM + 1;
-        auto itactor = actor_idx.begin();
-        auto endactor = actor_idx.end();
+        auto due_ids = pop_due_ticks(ACTOR_TICK, now, run_num, [&](int64_t id, const time_point_sec& tick_time) {
+            const auto* actor = find< actor_object, by_id >( actor_id_type(id) );
+            return actor != nullptr && actor->next_tick_time == tick_time;
+        });
         std::vector<const actor_object*> tick_actors;
-        tick_actors.reserve(run_num);
-        while( itactor != endactor && run_num > 0  )
-        {
-            if(itactor->next_tick_time > now)
-                break;
-            
-            tick_actors.push_back(&(*itactor));
-            run_num--;
-            
-            ++itactor;
-        }
+        tick_actors.reserve(due_ids.size());
+        for(auto id : due_ids)
+            tick_actors.push_back(&get< actor_object, by_id >( actor_id_type(id) ));
+        
+        auto next_tick_time = now + TAIYI_ACTOR_TICK_PERIOD_MAX_BLOCK_NUM * TAIYI_BLOCK_INTERVAL;
+        std::vector<int64_t> rescheduled;
+        rescheduled.reserve(tick_actors.size());
         
         for(const auto* a : tick_actors) {
             const auto& actor = *a;
             
             modify(actor, [&]( actor_object& obj ) {
-                obj.next_tick_time = now + TAIYI_ACTOR_TICK_PERIOD_MAX_BLOCK_NUM * TAIYI_BLOCK_INTERVAL;
+                obj.next_tick_time = next_tick_time;
             });
+            rescheduled.push_back(actor.id._id);
             
             if(actor.health <= 0) {
                 //dead
@@ -244,6 +290,7 @@ namespace taiyi { namespace chain {
                         //process talents
                         try_trigger_actor_talents(actor, age);
                                             
+                        adjust_population_stats(actor, -1);
                         modify( actor, [&]( actor_object& act ) {
                             act.age = age; //note age may be changed in event processing
                             
@@ -255,6 +302,7 @@ namespace taiyi { namespace chain {
                             
                             act.last_update = now;
                         });
+                        adjust_population_stats(actor, 1);
 
                         //trigger actor grow
                         try_trigger_actor_contract_grow(actor);
@@ -268,6 +316,16 @@ namespace taiyi { namespace chain {
                 //try_procreate(npc, actor, *this);
             }
         }
+        
+        //本次心跳的角色都改期到同一个时刻，一次追加到时间轮的桶中
+        push_tick_schedule(ACTOR_TICK, next_tick_time, rescheduled);
+    }
+    //=============================================================================
+    void database::schedule_actor_tick( const actor_object& act, const time_point_sec& tick_time )
+    {
+        if(act.next_tick_time != tick_time)
+            modify(act, [&]( actor_object& obj ) { obj.next_tick_time = tick_time; });
+        push_tick_schedule(ACTOR_TICK, tick_time, { act.id._id });
     }
     //=============================================================================
     void database::try_trigger_actor_talents( const actor_object& act, uint16_t age )
@@ -297,12 +355,14 @@ namespace taiyi { namespace chain {
 
         //process talents
         const actor_talents_object& actor_talents = get< actor_talents_object, by_actor >( act.id );
+        const auto* core_attrs = find< actor_core_attributes_object, by_actor >( act.id );
         
         std::map<int64_t, int> talent_trgger_numbers;
         for(auto itlt = actor_talents.talents.begin(); itlt != actor_talents.talents.end(); itlt++) {
             const actor_talent_rule_object& tobj = get< actor_talent_rule_object, by_id >(itlt->first);
             
-            if(itlt->second >= tobj.max_triggers)
+            //按天赋声明的触发次数、年龄和属性条件过滤，不满足的不进入虚拟机
+            if(has_hardfork(TAIYI_HARDFORK_0_1) ? !tobj.can_trigger(age, itlt->second, core_attrs) : itlt->second >= tobj.max_triggers)
                 continue;
             
             const auto* contract_ptr = find<contract_object, by_id>(tobj.main_contract);
@@ -317,7 +377,8 @@ namespace taiyi { namespace chain {
                 vector<lua_types> value_list; //no params.
                 contract_worker worker;
 
-                LuaContext context;
+                pooled_lua_context pooled_context;
+                LuaContext& context = pooled_context.single_call();
                 initialize_VM_baseENV(context);
                 flat_set<public_key_type> sigkeys;
 
@@ -437,7 +498,8 @@ namespace taiyi { namespace chain {
             vector<lua_types> value_list; //no params.
             contract_worker worker;
 
-            LuaContext context;
+            pooled_lua_context pooled_context;
+            LuaContext& context = pooled_context.single_call();
             initialize_VM_baseENV(context);
             flat_set<public_key_type> sigkeys;
 
@@ -105,7 +105,7 @@ namespace taiyi { namespace chain {
         if (lua_isnil(context.mState, -1))
         {
             lua_pop(context.mState, 1);
-            luaL_loadbuffer(context.mState, contract_base_code.lua_code_b.data(), contract_base_code.lua_code_b.size(), contract_base.name.data());
+            context.load_cached_chunk(contract_base_code.id._id, contract_base_code.lua_code_b.data(), contract_base_code.lua_code_b.size(), contract_base.name.data());
             lua_setglobal(context.mState, "baseENV");
         }
     }
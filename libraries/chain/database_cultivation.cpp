@@ -170,10 +170,12 @@ namespace taiyi { namespace chain {
                     if( test_actor != nullptr &&
                        (test_actor->health_max <= 0 || (hbn > 1601345 && test_actor->health_max <= 10) )
                        ) {
+                        adjust_population_stats(*test_actor, -1);
                         modify(*test_actor, [&](actor_object& obj) {
                             obj.health_max = 100;
                             obj.health = obj.health_max;
                         });
+                        adjust_population_stats(*test_actor, 1);
                     }
 #endif
 
@@ -10,9 +10,11 @@
 #include <chain/account_object.hpp>
 #include <chain/contract_objects.hpp>
 #include <chain/nfa_objects.hpp>
+#include <chain/tick_schedule_object.hpp>
 #include <chain/asset_objects/nfa_balance_object.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/contract_worker.hpp>
 
 #include <chain/util/uint256.hpp>
@@ -26,6 +28,7 @@
 
 #include <iostream>
 
+#include <algorithm>
 #include <cstdint>
 #include <deque>
 #include <fstream>
@@ -143,22 +146,21 @@ namespace taiyi { namespace chain {
         auto now = head_block_time();
 
         //list NFAs this tick will sim
-        const auto& nfa_idx = get_index< nfa_index, by_tick_time >();
+        const auto& nfa_idx = get_index< nfa_index, by_id >();
         auto run_num = nfa_idx.size() / TAIYI_NFA_TICK_PERIOD_MAX_BLOCK_NUM + 1;
-        auto itnfa = nfa_idx.begin();
-        auto endnfa = nfa_idx.end();
+        auto due_ids = pop_due_ticks(NFA_TICK, now, run_num, [&](int64_t id, const time_point_sec& tick_time) {
+            const auto* nfa = find< nfa_object, by_id >( nfa_id_type(id) );
+            return nfa != nullptr && nfa->next_tick_time == tick_time;
+        });
         std::vector<const nfa_object*> tick_nfas;
-        tick_nfas.reserve(run_num);
-        while( itnfa != endnfa && run_num > 0  )
-        {
-            if(itnfa->next_tick_time > now)
-                break;
-            
-            tick_nfas.push_back(&(*itnfa));
-            run_num--;
-            
-            ++itnfa;
-        }
+        tick_nfas.reserve(due_ids.size());
+        for(auto id : due_ids)
+            tick_nfas.push_back(&get< nfa_object, by_id >( nfa_id_type(id) ));
+        
+        //本次心跳的NFA都改期到同一个时刻，最后一次追加到时间轮的桶中
+        auto next_tick_time = now + TAIYI_NFA_TICK_PERIOD_MAX_BLOCK_NUM * TAIYI_BLOCK_INTERVAL;
+        std::vector<int64_t> rescheduled;
+        rescheduled.reserve(tick_nfas.size());
         
         for(const auto* n : tick_nfas) {
             const auto& nfa = *n;
@@ -185,8 +187,9 @@ namespace taiyi { namespace chain {
             }
             
             modify(nfa, [&]( nfa_object& obj ) {
-                obj.next_tick_time = now + TAIYI_NFA_TICK_PERIOD_MAX_BLOCK_NUM * TAIYI_BLOCK_INTERVAL;
+                obj.next_tick_time = next_tick_time;
             });
+            rescheduled.push_back(nfa.id._id);
 
             const auto* contract_ptr = find<contract_object, by_id>(nfa.is_miraged?nfa.mirage_contract:nfa.main_contract);
             if(contract_ptr == nullptr)
@@ -198,7 +201,8 @@ namespace taiyi { namespace chain {
             vector<lua_types> value_list; //no params.
             contract_worker worker;
 
-            LuaContext context;
+            pooled_lua_context pooled_context;
+            LuaContext& context = pooled_context.single_call();
             initialize_VM_baseENV(context);
             flat_set<public_key_type> sigkeys;
 
@@ -254,6 +258,68 @@ namespace taiyi { namespace chain {
                 });
             }
         }
+        
+        //心跳中被关闭或者改期的NFA留在桶里也没关系，到期取出时会按失效丢弃
+        push_tick_schedule(NFA_TICK, next_tick_time, rescheduled);
+    }
+    //=============================================================================
+    void database::schedule_nfa_tick(const nfa_object& nfa, const time_point_sec& tick_time)
+    {
+        if(nfa.next_tick_time != tick_time)
+            modify(nfa, [&]( nfa_object& obj ) { obj.next_tick_time = tick_time; });
+        push_tick_schedule(NFA_TICK, tick_time, { nfa.id._id });
+    }
+    //=============================================================================
+    void database::push_tick_schedule( E_TICK_SCHEDULE_TYPE type, const time_point_sec& tick_time, const std::vector<int64_t>& entities )
+    {
+        if(entities.empty() || tick_time == time_point_sec::maximum())
+            return; //关闭心跳不需要登记
+        
+        const auto* bucket = find< tick_schedule_object, by_tick_time >( boost::make_tuple(type, tick_time) );
+        if(bucket == nullptr) {
+            create< tick_schedule_object >( [&]( tick_schedule_object& b ) {
+                b.type = type;
+                b.tick_time = tick_time;
+                b.entities = entities;
+            });
+        }
+        else {
+            modify( *bucket, [&]( tick_schedule_object& b ) {
+                b.entities.insert(b.entities.end(), entities.begin(), entities.end());
+            });
+        }
+    }
+    //=============================================================================
+    std::vector<int64_t> database::pop_due_ticks( E_TICK_SCHEDULE_TYPE type, const time_point_sec& now, size_t max_count, const std::function<bool(int64_t, const time_point_sec&)>& is_scheduled )
+    {
+        std::vector<int64_t> due;
+        const auto& bucket_idx = get_index< tick_schedule_index, by_tick_time >();
+        while(due.size() < max_count)
+        {
+            //每次取最早的桶，取完的桶已被删除
+            auto itb = bucket_idx.lower_bound( boost::make_tuple(type, time_point_sec::min()) );
+            if(itb == bucket_idx.end() || itb->type != type || itb->tick_time > now)
+                break;
+            const auto& bucket = *itb;
+            
+            //桶内按id排序去重，与按(心跳时间, id)排序的顺序一致
+            std::vector<int64_t> candidates(bucket.entities);
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+            
+            size_t taken = 0;
+            for(; taken < candidates.size() && due.size() < max_count; ++taken) {
+                if(is_scheduled(candidates[taken], bucket.tick_time))
+                    due.push_back(candidates[taken]);
+            }
+            
+            //本块没轮到的实体留在桶里，下个块优先处理
+            if(taken == candidates.size())
+                remove(bucket);
+            else
+                modify(bucket, [&]( tick_schedule_object& b ) { b.entities.assign(candidates.begin() + taken, candidates.end()); });
+        }
+        return due;
     }
     //=========================================================================
     asset database::get_nfa_balance( const nfa_object& nfa, asset_symbol_type symbol ) const
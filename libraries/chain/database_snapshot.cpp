@@ -0,0 +1,170 @@
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/database.hpp>
+#include <chain/database_exceptions.hpp>
+#include <chain/global_property_object.hpp>
+#include <chain/siming_objects.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/filesystem.hpp>
+
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <thread>
+
+#define TAIYI_SNAPSHOT_FORMAT_VERSION 1
+
+namespace taiyi { namespace chain {
+
+    namespace {
+
+        const char* snapshot_manifest_file = "manifest.json";
+
+        fc::path section_file( const fc::path& dir, const std::string& index_name )
+        {
+            return dir / ( index_name + ".bin" );
+        }
+
+        //在最多 hardware_concurrency 个线程上处理 count 项，出错时把第一个异常抛回调用线程
+        template< typename Func >
+        void run_in_parallel( size_t count, Func&& f )
+        {
+            size_t thread_count = std::min< size_t >( count, std::max( 1u, std::thread::hardware_concurrency() ) );
+            std::atomic< size_t > next( 0 );
+            std::vector< std::exception_ptr > errors( count );
+            std::vector< std::thread > workers;
+
+            for( size_t t = 0; t < thread_count; ++t )
+            {
+                workers.emplace_back( [&]() {
+                    for( size_t i = next++; i < count; i = next++ )
+                    {
+                        try { f( i ); }
+                        catch( ... ) { errors[i] = std::current_exception(); }
+                    }
+                } );
+            }
+
+            for( auto& w : workers )
+                w.join();
+
+            for( auto& e : errors )
+                if( e ) std::rethrow_exception( e );
+        }
+
+    } // anonymous
+
+    database::snapshot_manifest database::export_snapshot( const fc::path& dir )const
+    { try {
+        fc::create_directories( dir );
+
+        snapshot_manifest manifest;
+        manifest.format_version = TAIYI_SNAPSHOT_FORMAT_VERSION;
+        manifest.blockchain_version = TAIYI_BLOCKCHAIN_VERSION;
+        manifest.chain_id = get_chain_id();
+        manifest.head_block_num = head_block_num();
+        manifest.head_block_id = head_block_id();
+
+        std::vector< const index_delegate_map::value_type* > delegates;
+        for( const auto& d : _index_delegate_map )
+        {
+            FC_ASSERT( d.second.write_snapshot, "Index ${n} does not support snapshots", ("n", d.first) );
+            delegates.push_back( &d );
+            snapshot_section section;
+            section.index_name = d.first;
+            manifest.sections.push_back( section );
+        }
+
+        auto start = fc::time_point::now();
+        //每个索引写到各自的段文件，互不依赖，可以并行
+        run_in_parallel( delegates.size(), [&]( size_t i ) {
+            auto& section = manifest.sections[i];
+            std::ofstream out( section_file( dir, section.index_name ).string(), std::ios::binary | std::ios::trunc );
+            FC_ASSERT( out.good(), "Unable to open snapshot section ${n} for writing", ("n", section.index_name) );
+
+            fc::sha256::encoder enc;
+            section.object_count = delegates[i]->second.write_snapshot( *this, [&]( const char* data, size_t size ) {
+                out.write( data, size );
+                enc.write( data, size );
+                section.size += size;
+            } );
+
+            out.flush();
+            FC_ASSERT( out.good(), "Error writing snapshot section ${n}", ("n", section.index_name) );
+            section.checksum = enc.result();
+        } );
+
+        fc::json::save_to_file( manifest, dir / snapshot_manifest_file );
+
+        ilog( "Wrote snapshot of ${n} indices at block ${b} to ${d} in ${t} ms",
+             ("n", manifest.sections.size())("b", manifest.head_block_num)("d", dir)("t", (fc::time_point::now() - start).count() / 1000) );
+        return manifest;
+    } FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+    database::snapshot_manifest database::import_snapshot( const fc::path& dir )
+    { try {
+        auto manifest = fc::json::from_file( dir / snapshot_manifest_file ).as< snapshot_manifest >();
+        FC_ASSERT( manifest.format_version == TAIYI_SNAPSHOT_FORMAT_VERSION, "Unsupported snapshot format version",
+                  ("snapshot", manifest.format_version)("expected", TAIYI_SNAPSHOT_FORMAT_VERSION) );
+        FC_ASSERT( manifest.blockchain_version == TAIYI_BLOCKCHAIN_VERSION, "Snapshot was written by a different blockchain version",
+                  ("snapshot", manifest.blockchain_version)("expected", TAIYI_BLOCKCHAIN_VERSION) );
+        FC_ASSERT( manifest.chain_id == get_chain_id(), "Snapshot belongs to a different chain", ("snapshot", manifest.chain_id)("expected", get_chain_id()) );
+
+        std::vector< const index_delegate* > delegates;
+        for( const auto& section : manifest.sections )
+        {
+            auto itr = _index_delegate_map.find( section.index_name );
+            FC_ASSERT( itr != _index_delegate_map.end(), "Snapshot contains unknown index ${n}", ("n", section.index_name) );
+            FC_ASSERT( itr->second.read_snapshot, "Index ${n} does not support snapshots", ("n", section.index_name) );
+            delegates.push_back( &itr->second );
+        }
+        FC_ASSERT( delegates.size() == _index_delegate_map.size(), "Snapshot does not cover every index",
+                  ("sections", delegates.size())("indices", _index_delegate_map.size()) );
+
+        auto start = fc::time_point::now();
+
+        //先校验全部段文件再载入，避免校验失败时状态只载入一半
+        run_in_parallel( manifest.sections.size(), [&]( size_t i ) {
+            const auto& section = manifest.sections[i];
+            auto path = section_file( dir, section.index_name );
+            FC_ASSERT( fc::exists( path ) && fc::file_size( path ) == section.size, "Snapshot section ${n} is missing or truncated", ("n", section.index_name) );
+
+            std::ifstream in( path.string(), std::ios::binary );
+            fc::sha256::encoder enc;
+            std::vector< char > buffer( 1 << 20 );
+            while( in )
+            {
+                in.read( buffer.data(), buffer.size() );
+                enc.write( buffer.data(), in.gcount() );
+            }
+            FC_ASSERT( enc.result() == section.checksum, "Checksum mismatch in snapshot section ${n}", ("n", section.index_name) );
+        } );
+
+        for( size_t i = 0; i < manifest.sections.size(); ++i )
+        {
+            const auto& section = manifest.sections[i];
+            std::ifstream in( section_file( dir, section.index_name ).string(), std::ios::binary );
+            uint64_t remaining = section.size;
+
+            uint64_t count = delegates[i]->read_snapshot( *this, [&]( char* data, size_t size ) {
+                FC_ASSERT( size <= remaining, "Snapshot section ${n} is malformed", ("n", section.index_name) );
+                in.read( data, size );
+                FC_ASSERT( in.good(), "Error reading snapshot section ${n}", ("n", section.index_name) );
+                remaining -= size;
+            } );
+
+            FC_ASSERT( count == section.object_count && remaining == 0, "Snapshot section ${n} is malformed", ("n", section.index_name) );
+            ilog( "Loaded ${c} objects into ${n}", ("c", count)("n", section.index_name) );
+        }
+
+        set_revision( manifest.head_block_num );
+        FC_ASSERT( head_block_num() == manifest.head_block_num && head_block_id() == manifest.head_block_id, "Snapshot state does not match its manifest" );
+
+        ilog( "Loaded snapshot at block ${b} from ${d} in ${t} ms",
+             ("b", manifest.head_block_num)("d", dir)("t", (fc::time_point::now() - start).count() / 1000) );
+        return manifest;
+    } FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+} } //taiyi::chain
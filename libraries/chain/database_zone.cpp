@@ -15,6 +15,7 @@
 #include <chain/actor_objects.hpp>
 #include <chain/tiandao_property_object.hpp>
 #include <chain/zone_objects.hpp>
+#include <chain/population_stats_object.hpp>
 #include <chain/contract_objects.hpp>
 
 #include <chain/contract_worker.hpp>
@@ -159,12 +160,77 @@ namespace taiyi { namespace chain {
         return get< tiandao_property_object >();
     } FC_CAPTURE_AND_RETHROW() }
     //=============================================================================
+    const population_stats_object& database::get_population_stats() const
+    { try {
+        return get< population_stats_object, by_zone >( zone_id_type::max() );
+    } FC_CAPTURE_AND_RETHROW() }
+    //=============================================================================
+    const population_stats_object* database::find_population_stats( const zone_id_type& zone ) const
+    {
+        return find< population_stats_object, by_zone >( zone );
+    }
+    //=============================================================================
+    void database::adjust_population_stats( const actor_object& act, int32_t delta )
+    {
+        //修改角色的健康、年龄或者位置时，先按旧状态减去，修改后再按新状态加上
+        bool living = act.health > 0;
+        const zone_object* zone = act.location == zone_id_type::max() ? nullptr : find< zone_object, by_id >( act.location );
+        
+        modify( get_population_stats(), [&]( population_stats_object& s ) {
+            if(living) {
+                s.living += delta;
+                s.living_by_age[population_stats_object::age_bucket(act.age)] += delta;
+                if(zone != nullptr)
+                    s.living_by_zone_type[(int)zone->type] += delta;
+            }
+            else
+                s.dead += delta;
+        });
+        
+        if(zone == nullptr)
+            return;
+        
+        const auto* zone_stats = find_population_stats( zone->id );
+        if(zone_stats == nullptr) {
+            zone_stats = &create< population_stats_object >( [&]( population_stats_object& s ) {
+                s.zone = zone->id;
+            });
+        }
+        modify( *zone_stats, [&]( population_stats_object& s ) {
+            if(living)
+                s.living += delta;
+            else
+                s.dead += delta;
+        });
+    }
+    //=============================================================================
+    void database::change_zone_type( const zone_object& zone, E_ZONE_TYPE type )
+    {
+        //区域里的活人随区域一起换到新的区域类型统计中
+        const auto* zone_stats = find_population_stats( zone.id );
+        if(zone_stats != nullptr && zone_stats->living > 0) {
+            modify( get_population_stats(), [&]( population_stats_object& s ) {
+                s.living_by_zone_type[(int)zone.type] -= zone_stats->living;
+                s.living_by_zone_type[(int)type] += zone_stats->living;
+            });
+        }
+        
+        modify( zone, [&]( zone_object& obj ) {
+            obj.type = type;
+        });
+    }
+    //=============================================================================
     int database::calculate_moving_days_to_zone( const zone_object& zone )
     {
         const auto& tiandao = get_tiandao_properties();
         return tiandao.zone_moving_difficulty_map[(int)zone.type];
     }
     //=============================================================================
+    std::vector<zone_id_type> database::find_zone_route( const zone_object& from, const zone_object& to, bool weighted )const
+    {
+        return _zone_router.find_route( *this, from.id, to.id, weighted );
+    }
+    //=============================================================================
     void database::process_tiandao()
     {
         uint32_t bn = head_block_num();
@@ -183,19 +249,10 @@ namespace taiyi { namespace chain {
             //next year
             FC_ASSERT(mn == 0 && tn == 0, "both virtual month number (${mn}) and time number (${tn}) must be zero!", ("mn", mn)("tn", tn));
             
-            //统计活人
-            uint32_t live_num = 0;
-            const auto& actor_by_health_idx = get_index< actor_index, by_health >();
-            auto itr = actor_by_health_idx.lower_bound( std::numeric_limits<int16_t>::max() );
-            auto end = actor_by_health_idx.end();
-            while( itr != end )
-            {
-                if(itr->health <= 0)
-                    break;
-                ++live_num;
-                ++itr;
-            }
-            uint32_t amount_actor = (uint32_t)actor_by_health_idx.size();
+            //统计活人，人口统计在角色变化时已经增量维护
+            const auto& population = get_population_stats();
+            uint32_t live_num = population.living;
+            uint32_t amount_actor = (uint32_t)get_index< actor_index, by_id >().size();
             uint32_t dead_num = amount_actor - live_num;
             
             uint32_t born_this_year = amount_actor - tiandao.amount_actor_last_vyear;
@@ -24,7 +24,7 @@ namespace taiyi { namespace chain {
     
     void fork_database::start_block(signed_block b)
     {
-        auto item = std::make_shared<fork_item>(std::move(b));
+        auto item = std::make_shared<fork_item>(block_state::create(std::move(b)));
         _index.insert(item);
         _head = item;
     }
@@ -34,6 +34,11 @@ namespace taiyi { namespace chain {
      *
      */
     shared_ptr<fork_item>  fork_database::push_block(const signed_block& b)
+    {
+        return push_block(block_state::create(b));
+    }
+
+    shared_ptr<fork_item>  fork_database::push_block(const block_state_ptr& b)
     {
         auto item = std::make_shared<fork_item>(b);
         try {
@@ -41,8 +46,8 @@ namespace taiyi { namespace chain {
         }
         catch ( const unlinkable_block_exception& e )
         {
-            wlog( "Pushing block to fork database that failed to link: ${id}, ${num}", ("id",b.id())("num",b.block_num()) );
-            wlog( "Head: ${num}, ${id}", ("num",_head->data.block_num())("id",_head->data.id()) );
+            wlog( "Pushing block to fork database that failed to link: ${id}, ${num}", ("id",item->id)("num",item->num) );
+            wlog( "Head: ${num}, ${id}", ("num",_head->num)("id",_head->id) );
             throw;
             _unlinked_index.insert( item );
         }
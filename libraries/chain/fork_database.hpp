@@ -1,5 +1,5 @@
 #pragma once
-#include <protocol/block.hpp>
+#include <protocol/block_state.hpp>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
@@ -11,14 +11,13 @@ namespace taiyi { namespace chain {
 
     using taiyi::protocol::signed_block;
     using taiyi::protocol::block_id_type;
+    using taiyi::protocol::block_state;
+    using taiyi::protocol::block_state_ptr;
 
     struct fork_item
     {
-    private:
-        fork_item(){}
-    public:
-        fork_item( signed_block d )
-        :num(d.block_num()),id(d.id()),data( std::move(d) ){}
+        fork_item( block_state_ptr s )
+        :num(s->get_block_num()),id(s->get_id()),state( std::move(s) ),data( state->get_block() ){}
         
         block_id_type previous_id()const { return data.previous; }
         
@@ -30,7 +29,8 @@ namespace taiyi { namespace chain {
          */
         bool                  invalid = false;
         block_id_type         id;
-        signed_block          data;
+        block_state_ptr       state;
+        const signed_block&   data;   // refers into state
     };
     typedef shared_ptr<fork_item> item_ptr;
 
@@ -66,6 +66,7 @@ namespace taiyi { namespace chain {
          *  @return the new head block ( the longest fork )
          */
         shared_ptr<fork_item>            push_block(const signed_block& b);
+        shared_ptr<fork_item>            push_block(const block_state_ptr& b);
         shared_ptr<fork_item>            head()const { return _head; }
         void                             pop_block();
         
@@ -6,6 +6,7 @@
 #include <chain/account_object.hpp>
 #include <chain/transaction_object.hpp>
 #include <chain/siming_objects.hpp>
+#include <chain/tick_schedule_object.hpp>
 
 namespace taiyi { namespace chain {
 
@@ -34,6 +35,7 @@ namespace taiyi { namespace chain {
         TAIYI_ADD_CORE_INDEX(db, reward_fund_index);
         TAIYI_ADD_CORE_INDEX(db, qi_delegation_index);
         TAIYI_ADD_CORE_INDEX(db, qi_delegation_expiration_index);
+        TAIYI_ADD_CORE_INDEX(db, tick_schedule_index);
 
         initialize_asset_indexes(db);
         initialize_contract_indexes(db);
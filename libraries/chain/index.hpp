@@ -8,6 +8,8 @@
 
 #include <chain/database.hpp>
 
+#include <fc/io/raw.hpp>
+
 namespace taiyi { namespace chain {
 
     using taiyi::schema::abstract_schema;
@@ -52,6 +54,57 @@ namespace taiyi { namespace chain {
         db._plugin_index_signal.connect( [&db](){ _add_index_impl< MultiIndexType >(db); } );
     }
 
+    //快照段格式：next_id, 对象数, 然后每个对象为 长度 + fc::raw 打包内容
+    template< typename MultiIndexType >
+    uint64_t write_index_snapshot( const database& db, const snapshot_sink& sink )
+    {
+        const auto& idx = db.get_index< MultiIndexType >();
+        int64_t next_id = idx.next_id()._id;
+        uint64_t count = idx.indices().size();
+        sink( (const char*)&next_id, sizeof(next_id) );
+        sink( (const char*)&count, sizeof(count) );
+
+        uint64_t written = 0;
+        std::vector< char > packed;
+        for( const auto& obj : idx.indices() )
+        {
+            packed = fc::raw::pack_to_vector( obj );
+            uint32_t size = packed.size();
+            sink( (const char*)&size, sizeof(size) );
+            sink( packed.data(), packed.size() );
+            ++written;
+        }
+        FC_ASSERT( written == count, "Index changed while writing snapshot", ("written", written)("count", count) );
+        return count;
+    }
+
+    template< typename MultiIndexType >
+    uint64_t read_index_snapshot( database& db, const snapshot_source& source )
+    {
+        typedef typename MultiIndexType::value_type value_type;
+        auto& idx = db.get_mutable_index< MultiIndexType >();
+        int64_t next_id = 0;
+        uint64_t count = 0;
+        source( (char*)&next_id, sizeof(next_id) );
+        source( (char*)&count, sizeof(count) );
+
+        idx.clear();
+        std::vector< char > packed;
+        for( uint64_t i = 0; i < count; ++i )
+        {
+            uint32_t size = 0;
+            source( (char*)&size, sizeof(size) );
+            packed.resize( size );
+            source( packed.data(), size );
+            idx.load( [&]( value_type& v ) {
+                fc::datastream< const char* > ds( packed.data(), packed.size() );
+                fc::raw::unpack( ds, v );
+            } );
+        }
+        idx.set_next_id( next_id );
+        return count;
+    }
+
 } } //taiyi::chain
 
 #define TAIYI_ADD_CORE_INDEX(db, index_name)                                                                 \
@@ -61,6 +114,8 @@ namespace taiyi { namespace chain {
       delegate.set_index_type =                                                                              \
          []( database& _db, mira::index_type type, const boost::filesystem::path& p, const boost::any& cfg ) \
             { _db.get_mutable_index< index_name >().mutable_indices().set_index_type( type, p, cfg ); };     \
+      delegate.write_snapshot = &taiyi::chain::write_index_snapshot< index_name >;                           \
+      delegate.read_snapshot = &taiyi::chain::read_index_snapshot< index_name >;                             \
       db.set_index_delegate( #index_name, std::move( delegate ) );                                           \
    } while( false )
 
@@ -71,5 +126,7 @@ namespace taiyi { namespace chain {
       delegate.set_index_type =                                                                              \
          []( database& _db, mira::index_type type, const boost::filesystem::path& p, const boost::any& cfg ) \
             { _db.get_mutable_index< index_name >().mutable_indices().set_index_type( type, p, cfg ); };     \
+      delegate.write_snapshot = &taiyi::chain::write_index_snapshot< index_name >;                           \
+      delegate.read_snapshot = &taiyi::chain::read_index_snapshot< index_name >;                             \
       db.set_index_delegate( #index_name, std::move( delegate ) );                                           \
    } while( false )
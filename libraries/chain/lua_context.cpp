@@ -102,7 +102,7 @@ namespace taiyi { namespace chain {
                 
                 const auto &contract_code = cbi.db.get<contract_bin_code_object, by_id>(contract->lua_code_b_id);
                 //lua加载脚本之后会返回一个函数(即此时栈顶的chunk块)，lua_pcall将默认调用此块
-                luaL_loadbuffer(context.mState, contract_code.lua_code_b.data(), contract_code.lua_code_b.size(), contract->name.data());
+                context.load_cached_chunk(contract_code.id._id, contract_code.lua_code_b.data(), contract_code.lua_code_b.size(), contract->name.data());
                 lua_getglobal(context.mState, current_contract_name.c_str());
                 lua_getfield(context.mState, -1, contract->name.c_str());
                 //将栈顶变量赋值给距栈顶二格的函数的第一个upvalue(这个函数为load返回的函数，第一个upvalue为_ENV)
@@ -249,6 +249,7 @@ namespace taiyi { namespace chain {
         registerFunction("is_zone_valid", &contract_handler::is_zone_valid);        
         registerFunction("is_zone_valid_by_name", &contract_handler::is_zone_valid_by_name);
         registerFunction("connect_zones", &contract_handler::connect_zones);
+        registerFunction("find_way_to_zone", &contract_handler::find_way_to_zone);
         registerFunction("list_actors_on_zone", &contract_handler::list_actors_on_zone);        
         registerFunction("is_actor_valid", &contract_handler::is_actor_valid);
         registerFunction("is_actor_valid_by_name", &contract_handler::is_actor_valid_by_name);
@@ -378,7 +379,8 @@ namespace taiyi { namespace chain {
         if (lua_isnil(mState, -1))
         {
             lua_pop(mState, 1);
-            luaL_loadbuffer(mState, condition, condition_size, (spacename + " baseENV").data());
+            //baseENV合约代码固定为0号
+            load_cached_chunk(0, condition, condition_size, (spacename + " baseENV").data());
             lua_setglobal(mState, "baseENV");
             lua_getglobal(mState, "baseENV");
         }
@@ -402,6 +404,11 @@ namespace taiyi { namespace chain {
         return false;
     }
     //=============================================================================
+    static size_t heap_size(lua_State *L)
+    {
+        return ((size_t)lua_gc(L, LUA_GCCOUNT, 0) << 10) + lua_gc(L, LUA_GCCOUNTB, 0);
+    }
+    //=============================================================================
     bool LuaContext::close_sandbox(string spacename)
     {
         lua_getglobal(mState, "_G"); /* table for ns list */
@@ -411,14 +418,39 @@ namespace taiyi { namespace chain {
         lua_pop(mState, 1);
         lua_pushnil(mState);
         lua_setfield(mState, -2, spacename.data());
-        lua_gc(mState, LUA_GCCOLLECT, 0);
+        
+        //合约创建的对象还有没执行的终结器时，必须在这里完整回收，终结器的执行时机和drops才是确定的
+        bool full = mSandboxGCMode == sandbox_gc_full || lua_gc(mState, LUA_GCMETEREDFIN, 0);
+        if (!full && mSandboxGCMode == sandbox_gc_threshold)
+            full = heap_size(mState) > mSandboxGCBaseline + mSandboxGCThreshold;
+        
+        if (full)
+        {
+            lua_gc(mState, LUA_GCCOLLECT, 0);
+            mSandboxGCBaseline = heap_size(mState);
+        }
+        else if (mSandboxGCMode == sandbox_gc_threshold && mSandboxGCStepKB > 0)
+            lua_gc(mState, LUA_GCSTEP, mSandboxGCStepKB);
         return true;
     }
     //=============================================================================
+    void LuaContext::set_sandbox_gc_policy(sandbox_gc_mode mode, size_t threshold, int step_kb)
+    {
+        mSandboxGCMode = mode;
+        mSandboxGCThreshold = threshold;
+        mSandboxGCStepKB = step_kb;
+        mSandboxGCBaseline = heap_size(mState);
+    }
+    //=============================================================================
     bool LuaContext::load_script_to_sandbox(string spacename, const char *script, size_t script_size)
+    {
+        return load_script_to_sandbox(spacename, -1, script, script_size);
+    }
+    //=============================================================================
+    bool LuaContext::load_script_to_sandbox(string spacename, int64_t code_id, const char *script, size_t script_size)
     {
         //lua加载脚本之后会返回一个函数(即此时栈顶的chunk块)，lua_pcall将默认调用此块
-        int sta = luaL_loadbuffer(mState, script, script_size, spacename.data());
+        int sta = load_cached_chunk(code_id, script, script_size, spacename.data());
         lua_getglobal(mState, spacename.data()); //想要使用的_ENV备用空间
         //将栈顶变量赋值给栈顶第二个函数的第一个upvalue(当前第二个函数为load返回的函数，第一个upvalue为_ENV)
         //注：upvalue:函数的外部引用变量在赋值成功以后，栈顶自动回弹一层
@@ -433,6 +465,176 @@ namespace taiyi { namespace chain {
         return sta ? false : true;
     }
     //=============================================================================
+    namespace {
+        
+        struct chunk_reader_data
+        {
+            const char *code;
+            size_t      size;
+        };
+        
+        const char* read_chunk(lua_State *L, void *ud, size_t *size)
+        {
+            chunk_reader_data *data = (chunk_reader_data *)ud;
+            if (data->size == 0)
+                return nullptr;
+            *size = data->size;
+            data->size = 0;
+            return data->code;
+        }
+        
+        //缓存的簿记不计入合约的drops，期间也不能触发回收，否则终结器会在不计量的情况下运行
+        struct unmetered_scope
+        {
+            lua_State  *L;
+            int         enable_drops;
+            size_t      mem_used;
+            lu_byte     gc_running;
+            
+            unmetered_scope(lua_State *state) : L(state), enable_drops(state->enable_drops), mem_used(state->memUsed), gc_running(G(state)->gcrunning)
+            {
+                L->enable_drops = 0;
+                G(L)->gcrunning = 0;
+            }
+            ~unmetered_scope()
+            {
+                L->enable_drops = enable_drops;
+                L->memUsed = mem_used;
+                G(L)->gcrunning = gc_running;
+            }
+        };
+        
+    }
+    //=============================================================================
+    LuaContext::PrototypeCache* LuaContext::prototype_cache()
+    {
+        //缓存的原型会保留常量字符串，影响之后合约的drops，所以只有池化的虚拟机（硬分叉0.1之后）才缓存
+        if (!G(mState)->pooled)
+            return nullptr;
+        
+        //注册表缓存表的0号位置记录拥有这个lua_State的context的缓存簿记，导入合约等临时context通过它共享缓存
+        PrototypeCache *cache = nullptr;
+        if (lua_getfield(mState, LUA_REGISTRYINDEX, LUACONTEXT_PROTOTYPE_CACHE) == LUA_TTABLE)
+        {
+            lua_rawgeti(mState, -1, 0);
+            cache = (PrototypeCache *)lua_touserdata(mState, -1);
+            lua_pop(mState, 1);
+        }
+        lua_pop(mState, 1);
+        
+        if (cache == nullptr && !mNotCloseAtDestruct)
+        {
+            if (!mPrototypeCache)
+                mPrototypeCache.reset(new PrototypeCache());
+            cache = mPrototypeCache.get();
+            
+            unmetered_scope scope(mState);
+            lua_newtable(mState);
+            lua_pushlightuserdata(mState, cache);
+            lua_rawseti(mState, -2, 0);
+            lua_setfield(mState, LUA_REGISTRYINDEX, LUACONTEXT_PROTOTYPE_CACHE);
+        }
+        return cache;
+    }
+    //=============================================================================
+    void LuaContext::evict_prototype(PrototypeCache& cache, std::map<std::pair<int64_t, std::string>, PrototypeCacheEntry>::iterator itr)
+    {
+        unmetered_scope scope(mState);
+        lua_getfield(mState, LUA_REGISTRYINDEX, LUACONTEXT_PROTOTYPE_CACHE);
+        lua_pushnil(mState);
+        lua_rawseti(mState, -2, itr->second.slot);
+        lua_pop(mState, 1);
+        
+        cache.free_slots.push_back(itr->second.slot);
+        cache.size -= itr->second.memused;
+        cache.lru.erase(itr->second.lru);
+        cache.entries.erase(itr);
+    }
+    //=============================================================================
+    int LuaContext::load_cached_chunk(int64_t code_id, const char *code, size_t code_size, const char *chunkname)
+    {
+        PrototypeCache *cache = code_id < 0 ? nullptr : prototype_cache();
+        if (cache == nullptr)
+            return luaL_loadbuffer(mState, code, code_size, chunkname);
+        
+        auto key = std::make_pair(code_id, std::string(chunkname));
+        auto digest = fc::sha256::hash(code, code_size);
+        auto itr = cache->entries.find(key);
+        if (itr != cache->entries.end())
+        {
+            //合约修订或者回滚以后同一个id的字节码会变化，缓存的原型随之失效
+            if (itr->second.code_size == code_size && itr->second.digest == digest)
+            {
+                cache->lru.splice(cache->lru.begin(), cache->lru, itr->second.lru);
+                lua_getfield(mState, LUA_REGISTRYINDEX, LUACONTEXT_PROTOTYPE_CACHE);
+                lua_rawgeti(mState, -1, itr->second.slot);
+                int status = lua_clonefunction(mState, -1, itr->second.memused);
+                lua_replace(mState, -3);
+                lua_pop(mState, 1);
+                return status;
+            }
+            evict_prototype(*cache, itr);
+        }
+        
+        size_t memused = 0;
+        chunk_reader_data reader_data = { code, code_size };
+        int status = lua_loadunmetered(mState, read_chunk, &reader_data, chunkname, nullptr, &memused);
+        if (status != LUA_OK)
+        {
+            //解码失败的不缓存，按正常方式重新载入一次，drops和错误信息都和没有缓存时一样
+            lua_pop(mState, 1);
+            return luaL_loadbuffer(mState, code, code_size, chunkname);
+        }
+        
+        if (memused <= cache->limit)
+        {
+            while (cache->size + memused > cache->limit)
+                evict_prototype(*cache, cache->entries.find(cache->lru.back()));
+            
+            int slot = cache->next_slot;
+            if (cache->free_slots.empty())
+                cache->next_slot++;
+            else {
+                slot = cache->free_slots.back();
+                cache->free_slots.pop_back();
+            }
+            
+            unmetered_scope scope(mState);
+            //缓存的原型不持有载入时的全局表，每次生成的闭包会重新设置_ENV
+            lua_pushnil(mState);
+            lua_setupvalue(mState, -2, 1);
+            lua_getfield(mState, LUA_REGISTRYINDEX, LUACONTEXT_PROTOTYPE_CACHE);
+            lua_pushvalue(mState, -2);
+            lua_rawseti(mState, -2, slot);
+            lua_pop(mState, 1);
+            
+            cache->lru.push_front(key);
+            cache->entries[key] = PrototypeCacheEntry{ digest, code_size, memused, slot, cache->lru.begin() };
+            cache->size += memused;
+        }
+        
+        status = lua_clonefunction(mState, -1, memused);
+        lua_replace(mState, -2);
+        return status;
+    }
+    //=============================================================================
+    void LuaContext::set_prototype_cache_limit(size_t limit)
+    {
+        PrototypeCache *cache = prototype_cache();
+        if (cache == nullptr)
+            return;
+        
+        cache->limit = limit;
+        while (cache->size > cache->limit)
+            evict_prototype(*cache, cache->entries.find(cache->lru.back()));
+    }
+    //=============================================================================
+    size_t LuaContext::prototype_cache_size()
+    {
+        PrototypeCache *cache = prototype_cache();
+        return cache ? cache->size : 0;
+    }
+    //=============================================================================
     bool LuaContext::get_function(string spacename, string func)
     {
         lua_getglobal(mState, spacename.data());
@@ -447,6 +649,60 @@ namespace taiyi { namespace chain {
         return false;
     }
     //=============================================================================
+    void LuaContext::snapshot_sandbox_state()
+    {
+        //记录预热完成后（标准库、链函数绑定都已就绪）的全局表内容
+        lua_settop(mState, 0);
+        lua_newtable(mState);
+        lua_pushglobaltable(mState);
+        int count = 0;
+        lua_pushnil(mState);
+        while (lua_next(mState, 2) != 0)
+        {
+            lua_pushvalue(mState, -2);
+            lua_insert(mState, -2);
+            lua_rawset(mState, 1);
+            count++;
+        }
+        lua_pop(mState, 1);
+        lua_setfield(mState, LUA_REGISTRYINDEX, LUACONTEXT_SANDBOX_SNAPSHOT);
+        
+        mSnapshotGlobalsCount = count;
+        lua_getstatesizes(mState, &mSnapshotStackSize, &mSnapshotStrtSize);
+    }
+    //=============================================================================
+    bool LuaContext::recycle_sandbox_state()
+    {
+        //还在执行中或者已经崩溃的虚拟机不能回收
+        if (mNotCloseAtDestruct || mState->ci != &mState->base_ci || mState->status != LUA_OK)
+            return false;
+        
+        lua_settop(mState, 0);
+        if (lua_getfield(mState, LUA_REGISTRYINDEX, LUACONTEXT_SANDBOX_SNAPSHOT) != LUA_TTABLE)
+        {
+            lua_pop(mState, 1);
+            return false;
+        }
+        
+        //用快照重建一个全新的全局表，而不是在旧表上删改，避免旧表哈希部分的历史影响后续的内存drops计量
+        lua_createtable(mState, 0, mSnapshotGlobalsCount);
+        lua_pushnil(mState);
+        while (lua_next(mState, 1) != 0)
+        {
+            lua_pushvalue(mState, -2);
+            lua_insert(mState, -2);
+            lua_rawset(mState, 2);
+        }
+        lua_pushvalue(mState, 2);
+        lua_setfield(mState, 2, "_G");
+        lua_rawseti(mState, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+        lua_settop(mState, 0);
+        
+        //清栈、完整回收、恢复栈和字符串表尺寸，drops计量关闭并清零
+        lua_recyclestate(mState, mSnapshotStackSize, mSnapshotStrtSize);
+        return true;
+    }
+    //=============================================================================
     boost::optional<FunctionSummary> LuaContext::Reader<FunctionSummary>::read(lua_State *state, int index, int depth)
     {
         Closure *pt = (Closure *)lua_topointer(state, index);
@@ -72,11 +72,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #define LUACONTEXT_GLOBAL_EQ "e5ddced079fc405aa4937b386ca387d2"
+#define LUACONTEXT_SANDBOX_SNAPSHOT "taiyi.sandbox.snapshot"
+#define LUACONTEXT_PROTOTYPE_CACHE "taiyi.prototype.cache"
+#define LUACONTEXT_PROTOTYPE_CACHE_LIMIT (8 * 1024 * 1024)
+#define LUACONTEXT_SANDBOX_GC_THRESHOLD (1024 * 1024)
 #define EQ_FUNCTION_NAME "__eq"
 #define TOSTRING_FUNCTION_NAME "__tostring"
 #define MAX_READER_READ_DEPTH 10
 
 #include <protocol/lua_types.hpp>
+#include <fc/crypto/sha256.hpp>
 
 //debug memory
 struct Tracker { size_t m_usage; };
@@ -175,17 +180,40 @@ public:
     bool new_sandbox(string spacename, const char *condition, size_t condition_size);
     bool get_sandbox(string spacename);
     bool close_sandbox(string spacename);
+    
+    //close_sandbox时的回收策略。有合约对象等待终结时总是完整回收，所以策略不影响合约可见的行为。
+    //非池化的虚拟机回收时缩栈和缩字符串表的内存也计入drops，只有池化的虚拟机才能不用完整回收
+    enum sandbox_gc_mode {
+        sandbox_gc_full,        //每次完整回收
+        sandbox_gc_threshold,   //堆比上次回收后增长超过阈值才完整回收，否则只做一步增量回收
+        sandbox_gc_skip         //不回收，用于马上会被回收或者销毁的context
+    };
+    void set_sandbox_gc_policy(sandbox_gc_mode mode, size_t threshold = LUACONTEXT_SANDBOX_GC_THRESHOLD, int step_kb = 0);
     bool get_function(string spacename, string func);
     bool load_script_to_sandbox(string spacename, const char *script, size_t script_size);
+    bool load_script_to_sandbox(string spacename, int64_t code_id, const char *script, size_t script_size);
+    
+    //合约字节码解码缓存：同一份字节码只undump一次，之后用缓存的函数原型直接生成闭包，按解码的内存开销计量drops
+    int load_cached_chunk(int64_t code_id, const char *code, size_t code_size, const char *chunkname);
+    void set_prototype_cache_limit(size_t limit);
+    size_t prototype_cache_size();
+
+    //池化复用虚拟机：预热后记录全局表和状态尺寸，回收时恢复到这个干净状态
+    void snapshot_sandbox_state();
+    bool recycle_sandbox_state();
     
     /**
      * Move constructor
      */
     LuaContext(LuaContext&& s) :
-        mState(s.mState), mNotCloseAtDestruct(s.mNotCloseAtDestruct)
+        mState(s.mState), mNotCloseAtDestruct(s.mNotCloseAtDestruct),
+        mSnapshotGlobalsCount(s.mSnapshotGlobalsCount), mSnapshotStackSize(s.mSnapshotStackSize), mSnapshotStrtSize(s.mSnapshotStrtSize),
+        mPrototypeCache(std::move(s.mPrototypeCache)),
+        mSandboxGCMode(s.mSandboxGCMode), mSandboxGCThreshold(s.mSandboxGCThreshold), mSandboxGCStepKB(s.mSandboxGCStepKB), mSandboxGCBaseline(s.mSandboxGCBaseline)
     {
         s.mState = luaL_newstate();
         s.mNotCloseAtDestruct = false;
+        s.mSnapshotGlobalsCount = s.mSnapshotStackSize = s.mSnapshotStrtSize = 0;
     }
     
     LuaContext(lua_State *L) : mState(L)
@@ -200,6 +228,14 @@ public:
     {
         std::swap(mState, s.mState);
         std::swap(mNotCloseAtDestruct, s.mNotCloseAtDestruct);
+        std::swap(mSnapshotGlobalsCount, s.mSnapshotGlobalsCount);
+        std::swap(mSnapshotStackSize, s.mSnapshotStackSize);
+        std::swap(mSnapshotStrtSize, s.mSnapshotStrtSize);
+        std::swap(mPrototypeCache, s.mPrototypeCache);
+        std::swap(mSandboxGCMode, s.mSandboxGCMode);
+        std::swap(mSandboxGCThreshold, s.mSandboxGCThreshold);
+        std::swap(mSandboxGCStepKB, s.mSandboxGCStepKB);
+        std::swap(mSandboxGCBaseline, s.mSandboxGCBaseline);
         return *this;
     }
 
@@ -950,6 +986,34 @@ public:
     //    offset 3 is unused, setter members at offset 4, default setter at offset 5
     lua_State*                  mState;
     bool                        mNotCloseAtDestruct = false; //对于直接设置或者通过拷贝构造的外部lua_State，在context析构时不能close
+    int                         mSnapshotGlobalsCount = 0;
+    int                         mSnapshotStackSize = 0;
+    int                         mSnapshotStrtSize = 0;
+    
+    struct PrototypeCacheEntry {
+        fc::sha256              digest;     //解码来源字节码的摘要，用于校验合约修订和回滚
+        size_t                  code_size;
+        size_t                  memused;    //解码一次的内存开销
+        int                     slot;       //函数原型在注册表缓存表中的位置
+        std::list<std::pair<int64_t, std::string>>::iterator lru;
+    };
+    struct PrototypeCache {
+        std::map<std::pair<int64_t, std::string>, PrototypeCacheEntry> entries; //(代码id, chunkname)
+        std::list<std::pair<int64_t, std::string>> lru; //最近使用的在前
+        size_t                  size = 0;
+        size_t                  limit = LUACONTEXT_PROTOTYPE_CACHE_LIMIT;
+        int                     next_slot = 1;
+        std::vector<int>        free_slots; //淘汰后空出的位置，优先复用
+    };
+    std::unique_ptr<PrototypeCache> mPrototypeCache; //只有拥有lua_State的context才持有，其他context通过注册表找到它
+    
+    PrototypeCache* prototype_cache();
+    void evict_prototype(PrototypeCache& cache, std::map<std::pair<int64_t, std::string>, PrototypeCacheEntry>::iterator itr);
+    
+    sandbox_gc_mode             mSandboxGCMode = sandbox_gc_full;
+    size_t                      mSandboxGCThreshold = LUACONTEXT_SANDBOX_GC_THRESHOLD;
+    int                         mSandboxGCStepKB = 0;
+    size_t                      mSandboxGCBaseline = 0; //上次完整回收后的堆大小
 
     
     /**************************************************/
@@ -2412,32 +2476,33 @@ private:
     struct lua_types_push_visiter
     {
         typedef void result_type;
+        //按引用访问，嵌套表逐层推送时不再整棵拷贝子表
         template <typename TType>
-        void operator()(TType value) noexcept
+        void operator()(const TType& value) noexcept
         {
-            obj = Pusher<typename std::decay<TType>::type>::push(state, std::move(value));
+            obj = Pusher<typename std::decay<TType>::type>::push(state, value);
         }
-        void operator()(lua_int value) noexcept
+        void operator()(const lua_int& value) noexcept
         {
-            obj = Pusher<int64_t>::push(state, std::move(value.v));
+            obj = Pusher<int64_t>::push(state, value.v);
         }
-        void operator()(lua_number value) noexcept
+        void operator()(const lua_number& value) noexcept
         {
-            obj = Pusher<double>::push(state, std::move(value.v));
+            obj = Pusher<double>::push(state, value.v);
         }
-        void operator()(lua_bool value) noexcept
+        void operator()(const lua_bool& value) noexcept
         {
-            obj = Pusher<typename std::decay<bool>::type>::push(state, std::move(value.v));
+            obj = Pusher<typename std::decay<bool>::type>::push(state, value.v);
         }
-        void operator()(lua_string value) noexcept
+        void operator()(const lua_string& value) noexcept
         {
-            obj = Pusher<typename std::decay<string>::type>::push(state, std::move(value.v));
+            obj = Pusher<typename std::decay<string>::type>::push(state, value.v);
         }
-        void operator()(lua_table value) noexcept
+        void operator()(const lua_table& value) noexcept
         {
-            obj = Pusher<lua_map>::push(state, std::move(value.v));
+            obj = Pusher<lua_map>::push(state, value.v);
         }
-        void operator()(FunctionSummary value) noexcept
+        void operator()(const FunctionSummary& value) noexcept
         {
             wdump(("FunctionSummary")(value)); //不推送函数摘要
         }
@@ -3112,11 +3177,11 @@ private:
             -> boost::optional<ReturnType>
         {
             // note: using SubReader::read triggers a compilation error when used with a reference
-            if (const auto val = SubReader::read(state, index, depth))
+            if (auto val = SubReader::read(state, index, depth))
             {
                 //if(std::is_same<SubReader,FunctionSummary>::value) //拒绝记录合约函数
                 //   return boost::none;
-                return ReturnType(*val);
+                return ReturnType(std::move(*val));
             }
             return VariantReader<typename boost::mpl::next<TIterBegin>::type, TIterEnd>::read(state, index, depth);
         }
@@ -3153,7 +3218,7 @@ struct LuaContext::Reader<lua_key>
         -> boost::optional<lua_key>
     {
         lua_key result;
-        const auto val = LuaContext::Reader<lua_key_variant>::read(state, index, depth);
+        auto val = LuaContext::Reader<lua_key_variant>::read(state, index, depth);
         if (!val.is_initialized())
             return boost::none;
         /*if (val->which() == lua_key_variant::tag<lua_string>::value)
@@ -3162,7 +3227,7 @@ struct LuaContext::Reader<lua_key>
             if (val->get<lua_string>().v == "__index")
                 return boost::none;
         }*/
-        result.key = *val;
+        result.key = std::move(*val);
         return result;
     }
 };
@@ -3281,7 +3346,7 @@ struct LuaContext::Reader<std::map<TKey,TValue>>
                     return {};
                 }
 
-                result.insert({ key.get(), value.get() });
+                result.emplace(std::move(key.get()), std::move(value.get()));
                 lua_pop(state, 1);      // we remove the value but keep the key for the next iteration
 
             } catch(...) {
@@ -3302,10 +3367,10 @@ struct LuaContext::Reader<lua_table>
     {
         if (!lua_istable(state, index))
             return boost::none;
-        const auto val = LuaContext::Reader<lua_map>::read(state, index, depth);
+        auto val = LuaContext::Reader<lua_map>::read(state, index, depth);
         if (!val)
             return boost::none;
-        return lua_table(*val);
+        return lua_table(std::move(*val));
     }
 };
 
@@ -3336,7 +3401,7 @@ struct LuaContext::Reader<std::unordered_map<TKey,TValue>>
                     return {};
                 }
 
-                result.insert({ key.get(), value.get() });
+                result.emplace(std::move(key.get()), std::move(value.get()));
                 lua_pop(state, 1);      // we remove the value but keep the key for the next iteration
 
             } catch(...) {
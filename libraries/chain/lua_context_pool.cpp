@@ -0,0 +1,71 @@
+#include <chain/lua_context_pool.hpp>
+
+#include <fc/log/logger.hpp>
+
+namespace taiyi { namespace chain {
+
+    lua_context_pool& lua_context_pool::instance()
+    {
+        static thread_local lua_context_pool pool;
+        return pool;
+    }
+    //=============================================================================
+    std::unique_ptr<LuaContext> lua_context_pool::acquire()
+    {
+        if(!_reuse_contexts)
+        {
+            std::unique_ptr<LuaContext> context(new LuaContext());
+            _created_contexts++;
+            return context;
+        }
+
+        if(!_idle.empty())
+        {
+            auto context = std::move(_idle.back());
+            _idle.pop_back();
+            context->set_prototype_cache_limit(_prototype_cache_limit);
+            context->set_sandbox_gc_policy(_sandbox_gc_mode, _sandbox_gc_threshold, _sandbox_gc_step_kb);
+            _reused_contexts++;
+            return context;
+        }
+
+        std::unique_ptr<LuaContext> context(new LuaContext());
+        lua_setpooled(context->mState, 1);
+        context->snapshot_sandbox_state();
+        //新建的虚拟机也先回收一次，使每次借出的虚拟机都处于同样的状态
+        FC_ASSERT(context->recycle_sandbox_state(), "can not initialize pooled lua context");
+        context->set_prototype_cache_limit(_prototype_cache_limit);
+        context->set_sandbox_gc_policy(_sandbox_gc_mode, _sandbox_gc_threshold, _sandbox_gc_step_kb);
+        _created_contexts++;
+        return context;
+    }
+    //=============================================================================
+    void lua_context_pool::release(std::unique_ptr<LuaContext> context) noexcept
+    {
+        if(!context || !_reuse_contexts)
+            return;
+
+        try
+        {
+            if(_idle.size() < _max_idle_contexts && context->recycle_sandbox_state())
+                _idle.push_back(std::move(context));
+        }
+        catch(const fc::exception& e)
+        {
+            wlog("discard pooled lua context: ${e}", ("e", e.to_string()));
+        }
+        catch(...)
+        {
+            wlog("discard pooled lua context");
+        }
+        //不能回收的虚拟机随context析构关闭
+    }
+    //=============================================================================
+    void lua_context_pool::set_reuse_contexts(bool reuse)
+    {
+        _reuse_contexts = reuse;
+        if(!reuse)
+            _idle.clear();
+    }
+
+} } // taiyi::chain
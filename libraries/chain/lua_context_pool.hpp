@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chain/lua_context.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    /**
+     * Per-thread pool of warmed up LuaContext.
+     *
+     * A new context pays luaL_newstate, luaL_openlibs and chain_function_bind once. Its globals are
+     * snapshotted right after that, and every time the context comes back to the pool it is recycled
+     * to exactly that state (fresh global table, empty stack, full collection, drops disabled and zeroed)
+     * before the next contract uses it. Decoded contract prototypes are kept across recycles.
+     *
+     * Pooled contexts are marked with lua_setpooled, which makes drop accounting independent of what earlier
+     * leases left behind. That accounting differs from a fresh lua_State, so the chain only reuses contexts
+     * once TAIYI_HARDFORK_0_1 is active. With reuse disabled every lease is a fresh, unpooled context.
+     */
+    class lua_context_pool
+    {
+    public:
+        /** pool of the calling thread */
+        static lua_context_pool& instance();
+
+        std::unique_ptr<LuaContext> acquire();
+        void release(std::unique_ptr<LuaContext> context) noexcept;
+
+        /** disabling reuse drops the idle contexts, see the class comment */
+        void set_reuse_contexts(bool reuse);
+        bool reuse_contexts() const { return _reuse_contexts; }
+        void set_max_idle_contexts(size_t max_idle) { _max_idle_contexts = max_idle; }
+        /** memory cap of the decoded-prototype cache of every context, see LuaContext::load_cached_chunk */
+        void set_prototype_cache_limit(size_t limit) { _prototype_cache_limit = limit; }
+        /** close_sandbox collection policy of leased contexts, see LuaContext::set_sandbox_gc_policy */
+        void set_sandbox_gc_policy(LuaContext::sandbox_gc_mode mode, size_t threshold = LUACONTEXT_SANDBOX_GC_THRESHOLD, int step_kb = 0)
+        {
+            _sandbox_gc_mode = mode;
+            _sandbox_gc_threshold = threshold;
+            _sandbox_gc_step_kb = step_kb;
+        }
+        size_t idle_contexts() const { return _idle.size(); }
+        uint64_t created_contexts() const { return _created_contexts; }
+        uint64_t reused_contexts() const { return _reused_contexts; }
+
+    private:
+        std::vector<std::unique_ptr<LuaContext>> _idle;
+        bool _reuse_contexts = true;
+        size_t _max_idle_contexts = 16;
+        size_t _prototype_cache_limit = LUACONTEXT_PROTOTYPE_CACHE_LIMIT;
+        //借出的虚拟机归还时会完整回收，所以中途的close_sandbox只在堆增长较多时才完整回收
+        LuaContext::sandbox_gc_mode _sandbox_gc_mode = LuaContext::sandbox_gc_threshold;
+        size_t _sandbox_gc_threshold = LUACONTEXT_SANDBOX_GC_THRESHOLD;
+        int _sandbox_gc_step_kb = 0;
+        uint64_t _created_contexts = 0;
+        uint64_t _reused_contexts = 0;
+    };
+
+    /**
+     * RAII lease of a pooled LuaContext, returned to the pool of the current thread on destruction.
+     */
+    class pooled_lua_context
+    {
+    public:
+        pooled_lua_context() : _context(lua_context_pool::instance().acquire()) {}
+        ~pooled_lua_context() { lua_context_pool::instance().release(std::move(_context)); }
+
+        pooled_lua_context(const pooled_lua_context&) = delete;
+        pooled_lua_context& operator=(const pooled_lua_context&) = delete;
+
+        LuaContext& operator*() const { return *_context; }
+        LuaContext* operator->() const { return _context.get(); }
+
+        /**
+         * Lease used for a single contract function. A pooled context is fully collected when it is recycled, so
+         * its close_sandbox collection is skipped. A fresh unpooled context (before TAIYI_HARDFORK_0_1) keeps the
+         * full collection, whose reallocations are charged as drops exactly as before pooling.
+         */
+        LuaContext& single_call() const
+        {
+            if(lua_getpooled(_context->mState))
+                _context->set_sandbox_gc_policy(LuaContext::sandbox_gc_skip);
+            return *_context;
+        }
+
+    private:
+        std::unique_ptr<LuaContext> _context;
+    };
+
+} } // taiyi::chain
@@ -9,6 +9,7 @@
 #include <chain/contract_objects.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/contract_worker.hpp>
 
 #include <fc/macros.hpp>
@@ -41,11 +42,10 @@ namespace taiyi { namespace chain {
         const auto* nfa_symbol = _db.find<nfa_symbol_object, by_symbol>(o.symbol);
         FC_ASSERT(nfa_symbol != nullptr, "NFA symbol named \"${n}\" is not exist.", ("n", o.symbol));
         
-        const auto* current_trx = _db.get_current_trx_ptr();
-        FC_ASSERT(current_trx);
-        const flat_set<public_key_type>& sigkeys = current_trx->get_signature_keys(_db.get_chain_id(), fc::ecc::fc_canonical);
+        const flat_set<public_key_type>& sigkeys = _db.get_current_trx_signature_keys();
         
-        LuaContext context;
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
         _db.initialize_VM_baseENV(context);
         
         const auto& nfa = _db.create_nfa(creator, *nfa_symbol, sigkeys, true, context);
@@ -153,7 +153,8 @@ namespace taiyi { namespace chain {
         
         contract_worker worker;
 
-        LuaContext context;
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
         _db.initialize_VM_baseENV(context);
         
         //qi可能在执行合约中被进一步使用，所以这里记录当前的qi来计算虚拟机的执行消耗
@@ -82,14 +82,13 @@ namespace taiyi { namespace chain {
         contract_id_type    mirage_contract = contract_id_type::max(); //幻觉状态下所处的合约剧情节点
 
         time_point_sec      created_time;
-        time_point_sec      next_tick_time = time_point_sec::maximum();
+        time_point_sec      next_tick_time = time_point_sec::maximum(); //开启心跳要通过 database::schedule_nfa_tick 登记到心跳时间轮
     };
 
     struct by_symbol;
     struct by_owner;
     struct by_creator;
     struct by_parent;
-    struct by_tick_time;
     //struct by_cultivation_value;
     typedef multi_index_container<
         nfa_object,
@@ -118,20 +117,14 @@ namespace taiyi { namespace chain {
                     member< nfa_object, nfa_id_type, &nfa_object::parent >,
                     member< nfa_object, nfa_id_type, &nfa_object::id >
                 >
-            >,
+            >
 //            ordered_unique< tag< by_cultivation_value >,
 //                composite_key< nfa_object,
 //                    member< nfa_object, uint64_t, &nfa_object::cultivation_value >,
 //                    member< nfa_object, nfa_id_type, &nfa_object::id >
 //                >,
 //                composite_key_compare< std::greater< uint64_t >, std::less< nfa_id_type > >
-//            >,
-            ordered_unique< tag< by_tick_time >,
-                composite_key< nfa_object,
-                    member< nfa_object, time_point_sec, &nfa_object::next_tick_time >,
-                    member< nfa_object, nfa_id_type, &nfa_object::id >
-                >
-            >
+//            >
         >,
         allocator< nfa_object >
     > nfa_index;
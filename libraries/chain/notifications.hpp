@@ -1,20 +1,19 @@
 #pragma once
 
-#include <protocol/block.hpp>
+#include <protocol/block_state.hpp>
 
 namespace taiyi { namespace chain {
 
+    using taiyi::protocol::block_state;
+
     struct block_notification
     {
-        block_notification( const taiyi::protocol::signed_block& b ) : block(b)
-        {
-            block_id = b.id();
-            block_num = taiyi::protocol::block_header::num_from_id( block_id );
-        }
+        block_notification( const block_state& s ) : block_id(s.get_id()), block_num(s.get_block_num()), block(s.get_block()), state(s) {}
         
         taiyi::protocol::block_id_type          block_id;
         uint32_t                                block_num = 0;
         const taiyi::protocol::signed_block&    block;
+        const block_state&                      state;   // 缓存的交易id、打包字节等，观察者不必重算
     };
 
     struct transaction_notification
@@ -23,6 +22,7 @@ namespace taiyi { namespace chain {
         {
             transaction_id = tx.id();
         }
+        transaction_notification( const taiyi::protocol::signed_transaction& tx, const taiyi::protocol::transaction_id_type& id ) : transaction_id(id), transaction(tx) {}
         
         taiyi::protocol::transaction_id_type          transaction_id;
         const taiyi::protocol::signed_transaction&    transaction;
@@ -0,0 +1,55 @@
+#pragma once
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/taiyi_object_types.hpp>
+
+#include <algorithm>
+
+namespace taiyi { namespace chain {
+
+    /**
+     *  人口统计，在角色创建、出生、成长、死亡和移动时增量维护，天道年度统计和查询接口直接读取，不再遍历角色索引
+     *
+     *  zone 为 zone_id_type::max() 的对象是全世界的统计，包括还没出生的角色；其他对象是各区域内角色的统计。
+     *  活人按健康值大于0判定，与年度统计一致。
+     */
+    class population_stats_object : public object < population_stats_object_type, population_stats_object >
+    {
+        TAIYI_STD_ALLOCATOR_CONSTRUCTOR(population_stats_object)
+
+    public:
+        template< typename Constructor, typename Allocator >
+        population_stats_object(Constructor&& c, allocator< Allocator > a)
+        {
+            c(*this);
+        }
+
+        enum { age_bucket_years = 10, age_bucket_num = 11 };
+
+        id_type                 id;
+
+        zone_id_type            zone = zone_id_type::max(); ///统计的区域，max表示全世界
+
+        uint32_t                living = 0;     ///活着的角色数
+        uint32_t                dead = 0;       ///死亡的角色数
+
+        std::vector<uint32_t>   living_by_zone_type;    ///各类型区域中的活人数，下标为 E_ZONE_TYPE，只在全世界的统计中维护
+        std::vector<uint32_t>   living_by_age;          ///活人的年龄分布，每 age_bucket_years 岁一档，最后一档包括更高的年龄，只在全世界的统计中维护
+
+        static size_t age_bucket(uint16_t age) { return std::min<size_t>(age / age_bucket_years, age_bucket_num - 1); }
+    };
+
+    struct by_zone;
+    typedef multi_index_container<
+        population_stats_object,
+        indexed_by<
+            ordered_unique< tag< by_id >, member< population_stats_object, population_stats_id_type, &population_stats_object::id > >,
+            ordered_unique< tag< by_zone >, member< population_stats_object, zone_id_type, &population_stats_object::zone > >
+        >,
+        allocator< population_stats_object >
+    > population_stats_index;
+
+} } // taiyi::chain
+
+FC_REFLECT( taiyi::chain::population_stats_object, (id)(zone)(living)(dead)(living_by_zone_type)(living_by_age) )
+CHAINBASE_SET_INDEX_TYPE( taiyi::chain::population_stats_object, taiyi::chain::population_stats_index )
@@ -106,7 +106,16 @@ namespace taiyi {
             cultivation_object_type,
             
             //tiandao
-            tiandao_property_object_type
+            tiandao_property_object_type,
+            
+            //tick schedule
+            tick_schedule_object_type,
+            
+            //population statistics
+            population_stats_object_type,
+            
+            //contract data, split out of contract_object
+            contract_data_object_type
         };
         
         class dynamic_global_property_object;
@@ -138,6 +147,7 @@ namespace taiyi {
         class contract_object;
         class account_contract_data_object;
         class contract_bin_code_object;
+        class contract_data_object;
 
         class nfa_symbol_object;
         class nfa_object;
@@ -156,6 +166,10 @@ namespace taiyi {
         class cultivation_object;
         
         class tiandao_property_object;
+        
+        class tick_schedule_object;
+        
+        class population_stats_object;
 
         typedef oid< dynamic_global_property_object         > dynamic_global_property_id_type;
         typedef oid< account_object                         > account_id_type;
@@ -186,6 +200,7 @@ namespace taiyi {
         typedef oid< contract_object                        > contract_id_type;
         typedef oid< account_contract_data_object           > account_contract_data_id_type;
         typedef oid< contract_bin_code_object               > contract_bin_code_id_type;
+        typedef oid< contract_data_object                   > contract_data_id_type;
 
         typedef oid< nfa_symbol_object                      > nfa_symbol_id_type;
         typedef oid< nfa_object                             > nfa_id_type;
@@ -204,6 +219,10 @@ namespace taiyi {
         typedef oid< cultivation_object                     > cultivation_id_type;
         
         typedef oid< tiandao_property_object                > tiandao_property_id_type;
+        
+        typedef oid< tick_schedule_object                   > tick_schedule_id_type;
+        
+        typedef oid< population_stats_object                > population_stats_id_type;
 
         enum E_ZONE_TYPE
         {
@@ -245,6 +264,12 @@ namespace taiyi {
             _ZONE_INVALID_TYPE
         };
         
+        enum E_TICK_SCHEDULE_TYPE
+        {
+            NFA_TICK = 0,   //NFA心跳
+            ACTOR_TICK      //角色心跳
+        };
+        
     } //chain
     
 } //taiyi
@@ -409,6 +434,16 @@ FC_REFLECT_ENUM( taiyi::chain::object_type,
     
     //tiandao
     (tiandao_property_object_type)
+    
+    //tick schedule
+    (tick_schedule_object_type)
+    
+    //population statistics
+    (population_stats_object_type)
+    
+    //contract data, split out of contract_object
+    (contract_data_object_type)
 )
 
 FC_REFLECT_ENUM( taiyi::chain::E_ZONE_TYPE, (XUKONG)(YUANYE)(HUPO)(NONGTIAN)(LINDI)(MILIN)(YUANLIN)(SHANYUE)(DONGXUE)(SHILIN)(QIULIN)(TAOYUAN)(SANGYUAN)(XIAGU)(ZAOZE)(YAOYUAN)(HAIYANG)(SHAMO)(HUANGYE)(ANYUAN)(DUHUI)(MENPAI)(SHIZHEN)(GUANSAI)(CUNZHUANG))
+FC_REFLECT_ENUM( taiyi::chain::E_TICK_SCHEDULE_TYPE, (NFA_TICK)(ACTOR_TICK) )
@@ -0,0 +1,50 @@
+#pragma once
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/taiyi_object_types.hpp>
+
+namespace taiyi { namespace chain {
+
+    /**
+     *  心跳时间轮中的一个桶，记录在同一个出块时刻到期的一类实体（NFA或者角色）
+     *
+     *  实体上的 next_tick_time 仍是权威值，桶中的条目只是候选。实体改期或者关闭心跳后不用修改旧桶，
+     *  旧条目在桶到期取出时按失效丢弃。这样安排一次心跳只需要在桶尾追加id，不再重排实体对象的索引。
+     */
+    class tick_schedule_object : public object < tick_schedule_object_type, tick_schedule_object >
+    {
+        TAIYI_STD_ALLOCATOR_CONSTRUCTOR(tick_schedule_object)
+
+    public:
+        template< typename Constructor, typename Allocator >
+        tick_schedule_object(Constructor&& c, allocator< Allocator > a)
+        {
+            c(*this);
+        }
+
+        id_type                 id;
+
+        E_TICK_SCHEDULE_TYPE    type = NFA_TICK;
+        time_point_sec          tick_time;
+        std::vector<int64_t>    entities; ///到期实体的id，按安排的先后追加，可能含重复或者失效的条目
+    };
+
+    struct by_tick_time;
+    typedef multi_index_container<
+        tick_schedule_object,
+        indexed_by<
+            ordered_unique< tag< by_id >, member< tick_schedule_object, tick_schedule_id_type, &tick_schedule_object::id > >,
+            ordered_unique< tag< by_tick_time >,
+                composite_key< tick_schedule_object,
+                    member< tick_schedule_object, E_TICK_SCHEDULE_TYPE, &tick_schedule_object::type >,
+                    member< tick_schedule_object, time_point_sec, &tick_schedule_object::tick_time >
+                >
+            >
+        >,
+        allocator< tick_schedule_object >
+    > tick_schedule_index;
+
+} } // taiyi::chain
+
+FC_REFLECT( taiyi::chain::tick_schedule_object, (id)(type)(tick_time)(entities) )
+CHAINBASE_SET_INDEX_TYPE( taiyi::chain::tick_schedule_object, taiyi::chain::tick_schedule_index )
@@ -11,6 +11,7 @@
 #include <chain/zone_objects.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/contract_worker.hpp>
 
 #include <fc/macros.hpp>
@@ -99,11 +100,10 @@ namespace taiyi { namespace chain {
         const auto* nfa_symbol = _db.find<nfa_symbol_object, by_symbol>(nfa_symbol_name);
         FC_ASSERT(nfa_symbol != nullptr, "NFA symbol named \"${n}\" is not exist.", ("n", nfa_symbol_name));
         
-        const auto* current_trx = _db.get_current_trx_ptr();
-        FC_ASSERT(current_trx);
-        const flat_set<public_key_type>& sigkeys = current_trx->get_signature_keys(_db.get_chain_id(), fc::ecc::fc_canonical);
+        const flat_set<public_key_type>& sigkeys = _db.get_current_trx_signature_keys();
         
-        LuaContext context;
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
         _db.initialize_VM_baseENV(context);
         
         const auto& nfa = _db.create_nfa(creator, *nfa_symbol, sigkeys, true, context);
@@ -8,12 +8,14 @@
 #include <chain/nfa_objects.hpp>
 #include <chain/actor_objects.hpp>
 #include <chain/zone_objects.hpp>
+#include <chain/population_stats_object.hpp>
 
 namespace taiyi { namespace chain {
 
     void initialize_zone_indexes( database& db )
     {
         TAIYI_ADD_CORE_INDEX(db, tiandao_property_index);
+        TAIYI_ADD_CORE_INDEX(db, population_stats_index);
 
         TAIYI_ADD_CORE_INDEX(db, zone_index);
         TAIYI_ADD_CORE_INDEX(db, zone_connect_index);
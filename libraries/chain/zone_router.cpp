@@ -0,0 +1,156 @@
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/zone_router.hpp>
+#include <chain/database.hpp>
+#include <chain/zone_objects.hpp>
+#include <chain/tiandao_property_object.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace taiyi { namespace chain {
+
+    std::vector<zone_id_type> zone_router::find_route( const database& db, zone_id_type from, zone_id_type to, bool weighted )
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        refresh( db );
+
+        auto& route_by_key = _routes.get< by_route_key >();
+        auto itr = route_by_key.find( boost::make_tuple( from, to, weighted ) );
+        if( itr != route_by_key.end() ) {
+            _routes.relocate( _routes.begin(), _routes.project< by_recency >( itr ) );
+            _cache_hits++;
+            return itr->route;
+        }
+
+        cached_route entry;
+        entry.from = from;
+        entry.to = to;
+        entry.weighted = weighted;
+        size_t zone_num = _adjacency.size();
+        if( from != to && size_t(from._id) < zone_num && size_t(to._id) < zone_num )
+            entry.route = weighted ? search_fewest_days( from._id, to._id ) : search_fewest_zones( from._id, to._id );
+
+        _routes.push_front( entry );
+        while( _routes.size() > _cache_size )
+            _routes.pop_back();
+        return entry.route;
+    }
+    //=============================================================================
+    void zone_router::set_cache_size( size_t size )
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _cache_size = size;
+        while( _routes.size() > _cache_size )
+            _routes.pop_back();
+    }
+    //=============================================================================
+    void zone_router::refresh( const database& db )
+    {
+        const auto& connect_idx = db.get_index< zone_connect_index >();
+        const auto& zone_idx = db.get_index< zone_index >();
+        const auto& moving_days = db.get_tiandao_properties().zone_moving_difficulty_map;
+
+        bool graph_changed = !_built || connect_idx.change_count() != _connect_changes || zone_idx.change_count() != _zone_changes;
+        bool days_changed = !std::equal( moving_days.begin(), moving_days.end(), _moving_days.begin(), _moving_days.end() );
+        if( !graph_changed && !days_changed )
+            return;
+
+        if( graph_changed ) {
+            _zone_types.clear();
+            for( const auto& zone : zone_idx.indices() ) {
+                size_t i = zone.id._id;
+                if( i >= _zone_types.size() )
+                    _zone_types.resize( i + 1, XUKONG );
+                _zone_types[i] = zone.type;
+            }
+
+            //按起点和终点排列的索引使邻接表有确定的顺序
+            _adjacency.assign( _zone_types.size(), std::vector<uint32_t>() );
+            for( const auto& connect : connect_idx.indices().get< by_zone_from >() ) {
+                if( size_t(connect.from._id) < _adjacency.size() && size_t(connect.to._id) < _adjacency.size() )
+                    _adjacency[connect.from._id].push_back( connect.to._id );
+            }
+
+            _built = true;
+            _connect_changes = connect_idx.change_count();
+            _zone_changes = zone_idx.change_count();
+            _snapshot_builds++;
+        }
+
+        _moving_days.assign( moving_days.begin(), moving_days.end() );
+        _zone_days.resize( _zone_types.size() );
+        for( size_t i = 0; i < _zone_types.size(); i++ ) {
+            size_t type = _zone_types[i];
+            _zone_days[i] = type < _moving_days.size() ? std::max( _moving_days[type], 0 ) : 0;
+        }
+
+        _routes.clear();
+    }
+    //=============================================================================
+    std::vector<zone_id_type> zone_router::search_fewest_zones( uint32_t from, uint32_t to )const
+    {
+        std::vector<int64_t> prev( _adjacency.size(), -1 );
+        std::deque<uint32_t> open;
+        prev[from] = from;
+        open.push_back( from );
+        while( !open.empty() ) {
+            uint32_t u = open.front();
+            open.pop_front();
+            if( u == to )
+                break;
+            for( auto v : _adjacency[u] ) {
+                if( prev[v] >= 0 )
+                    continue;
+                prev[v] = u;
+                open.push_back( v );
+            }
+        }
+        return make_route( prev, from, to );
+    }
+    //=============================================================================
+    std::vector<zone_id_type> zone_router::search_fewest_days( uint32_t from, uint32_t to )const
+    {
+        //区域没有坐标，A*没有比零更好的启发值，所以直接用Dijkstra；天数相同时先展开id小的区域，保证结果确定
+        typedef std::pair<int64_t, uint32_t> open_node;
+        std::vector<int64_t> days( _adjacency.size(), std::numeric_limits<int64_t>::max() );
+        std::vector<int64_t> prev( _adjacency.size(), -1 );
+        std::priority_queue< open_node, std::vector<open_node>, std::greater<open_node> > open;
+        days[from] = 0;
+        prev[from] = from;
+        open.push( open_node( 0, from ) );
+        while( !open.empty() ) {
+            auto node = open.top();
+            open.pop();
+            uint32_t u = node.second;
+            if( node.first > days[u] )
+                continue;
+            if( u == to )
+                break;
+            for( auto v : _adjacency[u] ) {
+                int64_t d = node.first + _zone_days[v];
+                if( d >= days[v] )
+                    continue;
+                days[v] = d;
+                prev[v] = u;
+                open.push( open_node( d, v ) );
+            }
+        }
+        return make_route( prev, from, to );
+    }
+    //=============================================================================
+    std::vector<zone_id_type> zone_router::make_route( const std::vector<int64_t>& prev, uint32_t from, uint32_t to )const
+    {
+        std::vector<zone_id_type> route;
+        if( prev[to] < 0 )
+            return route;
+        for( uint32_t z = to; z != from; z = prev[z] )
+            route.push_back( zone_id_type( z ) );
+        std::reverse( route.begin(), route.end() );
+        return route;
+    }
+
+} } // taiyi::chain
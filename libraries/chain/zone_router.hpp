@@ -0,0 +1,89 @@
+#pragma once
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/taiyi_object_types.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <mutex>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    class database;
+
+    /**
+     *  区域寻路，在内存中保存区域连接的邻接表快照，按经过的区域数（广度优先）或者按移动天数（Dijkstra）求最短路径，
+     *  最近的查询结果保存在有容量上限的LRU缓存中。
+     *
+     *  快照记下构建时区域连接索引和区域索引的变更计数，计数变化（包括撤销和回滚造成的变化）时重建快照并清空缓存，
+     *  天道的移动天数表变化时也清空缓存。同样的链状态下结果是确定的，合约中也可以使用。
+     *  内部状态由互斥量保护，持有数据库读锁的多个API线程可以同时查询。
+     */
+    class zone_router
+    {
+    public:
+        /**
+         *  从from到to沿连接方向的最短路径，不含起点，含终点；不可达或者起点就是终点时为空。
+         *  weighted为假时经过的区域最少，为真时移动天数最少，进入每个区域的天数同 database::calculate_moving_days_to_zone
+         */
+        std::vector<zone_id_type> find_route( const database& db, zone_id_type from, zone_id_type to, bool weighted );
+
+        void set_cache_size( size_t size );
+
+        uint64_t cache_hits()const { std::lock_guard<std::mutex> lock(_mtx); return _cache_hits; }
+        uint64_t snapshot_builds()const { std::lock_guard<std::mutex> lock(_mtx); return _snapshot_builds; }
+
+    private:
+        void refresh( const database& db );
+        std::vector<zone_id_type> search_fewest_zones( uint32_t from, uint32_t to )const;
+        std::vector<zone_id_type> search_fewest_days( uint32_t from, uint32_t to )const;
+        std::vector<zone_id_type> make_route( const std::vector<int64_t>& prev, uint32_t from, uint32_t to )const;
+
+        struct cached_route
+        {
+            zone_id_type                from;
+            zone_id_type                to;
+            bool                        weighted = false;
+            std::vector<zone_id_type>   route;
+        };
+
+        struct by_recency;
+        struct by_route_key;
+        typedef boost::multi_index_container<
+            cached_route,
+            boost::multi_index::indexed_by<
+                boost::multi_index::sequenced< boost::multi_index::tag< by_recency > >,
+                boost::multi_index::ordered_unique< boost::multi_index::tag< by_route_key >,
+                    boost::multi_index::composite_key< cached_route,
+                        boost::multi_index::member< cached_route, zone_id_type, &cached_route::from >,
+                        boost::multi_index::member< cached_route, zone_id_type, &cached_route::to >,
+                        boost::multi_index::member< cached_route, bool, &cached_route::weighted >
+                    >
+                >
+            >
+        > route_cache_type;
+
+        mutable std::mutex                  _mtx;
+
+        //快照，下标为区域id，邻接表按终点id排列
+        bool                                _built = false;
+        uint64_t                            _connect_changes = 0;
+        uint64_t                            _zone_changes = 0;
+        std::vector<std::vector<uint32_t>>  _adjacency;
+        std::vector<int>                    _zone_days;     ///进入各区域的移动天数
+        std::vector<int>                    _moving_days;   ///构建快照时天道的移动天数表，下标为 E_ZONE_TYPE
+        std::vector<E_ZONE_TYPE>            _zone_types;
+
+        //最近用过的路径在前，超出容量时淘汰最后的条目
+        route_cache_type                    _routes;
+        size_t                              _cache_size = 4096;
+        uint64_t                            _cache_hits = 0;
+        uint64_t                            _snapshot_builds = 0;
+    };
+
+} } // taiyi::chain
@@ -58,13 +58,18 @@ namespace chainbase {
         
         for( auto& item : _index_list )
             item->open( _data_dir, _database_cfg );
+        if( _index_list.size() )
+            _undo_frames.revision = _index_list[0]->revision();
         
         _is_open = true;
     }
     
     void database::flush() {
         for( auto& item : _index_list )
+        {
+            item->set_revision( _undo_frames.revision );
             item->flush();
+        }
     }
     
     size_t database::get_cache_usage() const
@@ -102,7 +107,10 @@ namespace chainbase {
             undo_all();
             
             for( auto& item : _index_list )
+            {
+                item->set_revision( _undo_frames.revision );
                 item->close();
+            }
             
             _is_open = false;
         }
@@ -137,44 +145,59 @@ namespace chainbase {
     
     void database::undo()
     {
-        for( auto& item : _index_list )
+        if( !_undo_frames.enabled() ) return;
+        
+        for( auto& item : _undo_frames.touched.back() )
         {
             item->undo();
         }
+        
+        _undo_frames.touched.pop_back();
+        --_undo_frames.revision;
     }
     
     void database::squash()
     {
-        for( auto& item : _index_list )
+        if( !_undo_frames.enabled() ) return;
+        
+        // Indices moving their state down register themselves in the previous frame
+        auto head = std::move( _undo_frames.touched.back() );
+        for( auto& item : head )
         {
             item->squash();
         }
+        
+        // Squashing the only session discards it and keeps the revision, as commit would
+        _undo_frames.touched.pop_back();
+        if( _undo_frames.enabled() )
+            --_undo_frames.revision;
     }
     
     void database::commit( int64_t revision )
     {
-        for( auto& item : _index_list )
+        int64_t oldest = _undo_frames.revision - int64_t( _undo_frames.touched.size() ) + 1;
+        while( _undo_frames.enabled() && oldest <= revision )
         {
-            item->commit( revision );
+            for( auto& item : _undo_frames.touched.front() )
+            {
+                item->commit( revision );
+            }
+            _undo_frames.touched.pop_front();
+            ++oldest;
         }
     }
     
     void database::undo_all()
     {
-        for( auto& item : _index_list )
-        {
-            item->undo_all();
-        }
+        while( _undo_frames.enabled() )
+            undo();
     }
     
     database::session database::start_undo_session()
     {
-        vector< std::unique_ptr<abstract_session> > _sub_sessions;
-        _sub_sessions.reserve( _index_list.size() );
-        for( auto& item : _index_list ) {
-            _sub_sessions.push_back( item->start_undo_session() );
-        }
-        return session( std::move( _sub_sessions ), _undo_session_count );
+        ++_undo_frames.revision;
+        _undo_frames.touched.emplace_back();
+        return session( *this, _undo_frames.revision, _undo_session_count );
     }
     
 }  // namespace chainbase
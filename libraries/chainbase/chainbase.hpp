@@ -29,6 +29,7 @@
 #include <stdexcept>
 #include <typeindex>
 #include <typeinfo>
+#include <vector>
 
 #ifndef CHAINBASE_NUM_RW_LOCKS
     #define CHAINBASE_NUM_RW_LOCKS 10
@@ -128,30 +129,199 @@ namespace chainbase {
     template<typename Constructor, typename Allocator>  \
     OBJECT_TYPE( Constructor&& c, Allocator&&  ) { c(*this); }
     
+    /**
+     *  Open addressing (linear probing) table from object id to the position of its entry in an undo journal.
+     *  Entries are never erased: an id is captured at most once per session, the journal entry changes
+     *  kind instead.
+     */
+    template< typename id_type >
+    class undo_capture_table
+    {
+    public:
+        static const int32_t npos = -1;
+        
+        int32_t find( const id_type& id )const
+        {
+            if( _size == 0 ) return npos;
+            for( size_t i = slot_of( id ); ; i = ( i + 1 ) & ( _slots.size() - 1 ) )
+            {
+                const auto& s = _slots[i];
+                if( s.entry == npos ) return npos;
+                if( s.id == id ) return s.entry;
+            }
+        }
+        
+        void insert( const id_type& id, int32_t entry )
+        {
+            if( ( _size + 1 ) * 4 > _slots.size() * 3 )
+                grow();
+            place( id, entry );
+            ++_size;
+        }
+        
+    private:
+        struct slot
+        {
+            id_type     id;
+            int32_t     entry = npos;
+        };
+        
+        size_t slot_of( const id_type& id )const
+        {
+            return size_t( ( uint64_t( id._id ) * 0x9E3779B97F4A7C15ULL ) >> 32 ) & ( _slots.size() - 1 );
+        }
+        
+        void place( const id_type& id, int32_t entry )
+        {
+            size_t i = slot_of( id );
+            while( _slots[i].entry != npos )
+                i = ( i + 1 ) & ( _slots.size() - 1 );
+            _slots[i].id = id;
+            _slots[i].entry = entry;
+        }
+        
+        void grow()
+        {
+            std::vector< slot > old_slots( _slots.size() ? _slots.size() * 2 : 16 );
+            old_slots.swap( _slots );
+            for( const auto& s : old_slots )
+                if( s.entry != npos )
+                    place( s.id, s.entry );
+        }
+        
+        std::vector< slot >  _slots;
+        size_t               _size = 0;
+    };
+    
+    /**
+     *  The undo state of one session is an append-only journal. The first create, modify or remove of an
+     *  object in the session appends one entry; modify and remove also keep a copy of the object as it was
+     *  before the session touched it. Later changes to an object already in the journal only change the
+     *  kind of its entry, so the common case costs one hash probe and no node allocation.
+     */
     template< typename value_type >
     class undo_state
     {
     public:
         typedef typename value_type::id_type                      id_type;
-        typedef allocator< std::pair<const id_type, value_type> > id_value_allocator_type;
-        typedef allocator< id_type >                              id_allocator_type;
+        
+        enum entry_kind : uint8_t
+        {
+            created,
+            modified,
+            removed,
+            cancelled ///< created and removed again in the same session
+        };
+        
+        struct entry
+        {
+            id_type      id;
+            entry_kind   kind;
+            int32_t      old_value; ///< index into old_values, -1 for created entries
+        };
         
         template<typename T>
-        undo_state( allocator<T> al )
-        :old_values( id_value_allocator_type( al ) ),
-        removed_values( id_value_allocator_type( al ) ),
-        new_ids( id_allocator_type( al ) ){}
-        
-        typedef boost::interprocess::map< id_type, value_type, std::less<id_type>, id_value_allocator_type >  id_value_type_map;
-        typedef boost::interprocess::set< id_type, std::less<id_type>, id_allocator_type >                    id_type_set;
-        
-        id_value_type_map            old_values;
-        id_value_type_map            removed_values;
-        id_type_set                  new_ids;
-        id_type                      old_next_id = 0;
-        int64_t                      revision = 0;
+        undo_state( allocator<T> al ) {}
+        
+        void on_create( const id_type& id )
+        {
+            captured.insert( id, int32_t( journal.size() ) );
+            journal.push_back( entry{ id, created, -1 } );
+        }
+        
+        void on_modify( const value_type& v )
+        {
+            if( captured.find( v.id ) != captured.npos )
+                return;
+            append( v.id, modified, value_type( v ) );
+        }
+        
+        void on_remove( const value_type& v )
+        {
+            int32_t pos = captured.find( v.id );
+            if( pos == captured.npos )
+            {
+                append( v.id, removed, value_type( v ) );
+                return;
+            }
+            
+            auto& e = journal[pos];
+            if( e.kind == created )
+                e.kind = cancelled;
+            else if( e.kind == modified )
+                e.kind = removed;
+        }
+        
+        /**
+         *  Folds the later session `state` into this one, see generic_index::squash for the merge rules.
+         */
+        void merge( undo_state& state )
+        {
+            for( const auto& e : state.journal )
+            {
+                switch( e.kind )
+                {
+                    case created:
+                        // nop+new -> new, type B
+                        on_create( e.id );
+                        break;
+                    case modified:
+                        // new+upd -> new and upd(was=X)+upd(was=Y) -> upd(was=X) are type A
+                        if( captured.find( e.id ) == captured.npos )
+                            append( e.id, modified, std::move( state.old_values[e.old_value] ) );
+                        break;
+                    case removed:
+                    {
+                        int32_t pos = captured.find( e.id );
+                        if( pos == captured.npos )
+                        {
+                            // nop + del(was=Y) -> del(was=Y)
+                            append( e.id, removed, std::move( state.old_values[e.old_value] ) );
+                            break;
+                        }
+                        
+                        // new + del -> nop and upd(was=X) + del(was=Y) -> del(was=X), type C
+                        auto& prev = journal[pos];
+                        assert( prev.kind == created || prev.kind == modified );
+                        prev.kind = prev.kind == created ? cancelled : removed;
+                        break;
+                    }
+                    case cancelled:
+                        break;
+                }
+            }
+        }
+        
+        std::vector< entry >                  journal;
+        std::vector< value_type >             old_values;
+        undo_capture_table< id_type >         captured;
+        id_type                               old_next_id = 0;
+        int64_t                               revision = 0;
+        
+    private:
+        void append( const id_type& id, entry_kind kind, value_type&& old_value )
+        {
+            captured.insert( id, int32_t( journal.size() ) );
+            journal.push_back( entry{ id, kind, int32_t( old_values.size() ) } );
+            old_values.emplace_back( std::move( old_value ) );
+        }
     };
 
+    class abstract_index;
+    
+    /**
+     *  Undo revisions of a database. Starting a session only opens a new frame here; an index creates its
+     *  undo_state for the head revision on its first write and records itself in that frame, so undo, squash
+     *  and commit only visit the indices that were actually changed.
+     */
+    struct undo_frames
+    {
+        int64_t                                        revision = 0;
+        std::deque< std::vector< abstract_index* > >   touched; ///< one frame per open revision, back() is the head
+        
+        bool enabled()const { return !touched.empty(); }
+    };
+    
     /**
      * The code we want to implement is this:
      *
@@ -235,6 +405,22 @@ namespace chainbase {
             return *insert_result.first;
         }
 
+        /**
+         * Insert an element whose id is assigned by the constructor, as done when bulk loading a snapshot.
+         * No undo state is recorded, so this must only be used while no undo session is open.
+         */
+        template<typename Constructor>
+        const value_type& load( Constructor&& c ) {
+            auto insert_result = _indices.emplace( c, _indices.get_allocator() );
+
+            if( !insert_result.second ) {
+                BOOST_THROW_EXCEPTION( std::logic_error("could not load object, most likely a uniqueness constraint was violated") );
+            }
+
+            ++_change_count;
+            return *insert_result.first;
+        }
+
         template<typename Modifier>
         void modify( const value_type& obj, Modifier&& m ) {
             on_modify( obj );
@@ -271,7 +457,14 @@ namespace chainbase {
         
         const index_type& indices()const { return _indices; }
         
-        void clear() { _indices.clear(); }
+        void clear() { _indices.clear(); ++_change_count; }
+
+        typename value_type::id_type next_id()const { return _next_id; }
+
+        void set_next_id( typename value_type::id_type id ) {
+            _next_id = id;
+            _indices.set_next_id( _next_id );
+        }
         
         void open( const bfs::path& p, const boost::any& o )
         {
@@ -302,105 +495,73 @@ namespace chainbase {
         
         void trim_cache() { _indices.trim_cache(); }
         
-        class session
-        {
-        public:
-            session( session&& mv )
-            :_index(mv._index),_apply(mv._apply){ mv._apply = false; }
-            
-            ~session() {
-                if( _apply ) {
-                    _index.undo();
-                }
-            }
-            
-            /** leaves the UNDO state on the stack when session goes out of scope */
-            void push()   { _apply = false; }
-            /** combines this session with the prior session */
-            void squash() { if( _apply ) _index.squash(); _apply = false; }
-            void undo()   { if( _apply ) _index.undo();  _apply = false; }
-            
-            session& operator = ( session&& mv ) {
-                if( this == &mv ) return *this;
-                if( _apply ) _index.undo();
-                _apply = mv._apply;
-                mv._apply = false;
-                return *this;
-            }
-            
-            int64_t revision()const { return _revision; }
-            
-        private:
-            friend class generic_index;
-            
-            session( generic_index& idx, int64_t revision )
-            :_index(idx),_revision(revision) {
-                if( revision == -1 )
-                    _apply = false;
-            }
-            
-            generic_index& _index;
-            bool           _apply = true;
-            int64_t        _revision = 0;
-        };
-        
-        // TODO: This function needs some work to make it consistent on failure.
-        session start_undo_session()
+        void set_undo_frames( undo_frames* frames, abstract_index* self )
         {
-            ++_revision;
-            _indices.set_revision( _revision );
-            assert( _indices.revision() == _revision );
-            _stack.emplace_back( _indices.get_allocator() );
-            _stack.back().old_next_id = _next_id;
-            _stack.back().revision = _revision;
-            return session( *this, _revision );
+            _frames = frames;
+            _self = self;
         }
         
         const index_type& indicies()const { return _indices; }
         int64_t revision()const { return _revision; }
 
+        /**
+         *  Counts every create, modify, remove, load, clear and undo applied to the index. It never goes
+         *  back, so an in-memory cache derived from the index can compare the count it was built at to
+         *  detect changes, including those reverted by undo.
+         */
+        uint64_t change_count()const { return _change_count; }
+
         /**
          *  Restores the state to how it was prior to the current session discarding all changes
          *  made between the last revision and the current revision.
          */
         void undo() {
-            if( !enabled() ) return;
+            if( _stack.empty() ) return;
             
-            const auto& head = _stack.back();
+            ++_change_count;
+            auto& head = _stack.back();
+            
+            // New objects go first so that restored values cannot collide with their unique keys
+            for( const auto& e : head.journal )
+            {
+                if( e.kind == undo_state_type::created )
+                    _indices.erase( _indices.find( e.id ) );
+            }
+            _next_id = head.old_next_id;
+            _indices.set_next_id( _next_id );
             
-            for( auto& item : head.old_values ) {
+            for( const auto& e : head.journal )
+            {
+                if( e.kind != undo_state_type::modified )
+                    continue;
+                
+                auto& old_value = head.old_values[e.old_value];
                 bool ok = false;
-                auto itr = _indices.find( item.second.id );
+                auto itr = _indices.find( e.id );
                 if( itr != _indices.end() )
                 {
                     ok = _indices.modify( itr, [&]( value_type& v ) {
-                        v = std::move( item.second );
+                        v = std::move( old_value );
                     });
                 }
                 else
                 {
-                    ok = _indices.emplace( std::move( item.second ) ).second;
+                    ok = _indices.emplace( std::move( old_value ) ).second;
                 }
                 
                 if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
             }
             
-            for( const auto& id : head.new_ids )
+            for( const auto& e : head.journal )
             {
-                _indices.erase( _indices.find( id ) );
-            }
-            _next_id = head.old_next_id;
-            _indices.set_next_id( _next_id );
-            
-            for( auto& item : head.removed_values ) {
-                bool ok = _indices.emplace( std::move( item.second ) ).second;
+                if( e.kind != undo_state_type::removed )
+                    continue;
+                
+                bool ok = _indices.emplace( std::move( head.old_values[e.old_value] ) ).second;
                 if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not restore object, most likely a uniqueness constraint was violated" ) );
             }
             
             _stack.pop_back();
-            --_revision;
-            _indices.set_revision( _revision );
-            assert( _indices.revision() == _revision );
         }
 
         /**
@@ -408,16 +569,25 @@ namespace chainbase {
          *  recent revision numbers into one revision number (reducing the head revision number)
          *
          *  This method does not change the state of the index, only the state of the undo buffer.
+         *  It is called by the database only for indices that have state at the head revision.
          */
         void squash()
         {
-            if( !enabled() ) return;
-            if( _stack.size() == 1 ) {
-                _stack.pop_front();
+            if( _stack.empty() ) return;
+            if( !_frames || _frames->touched.size() < 2 ) {
+                _stack.pop_back();
                 return;
             }
             
             auto& state = _stack.back();
+            int64_t prev_revision = state.revision - 1;
+            if( _stack.size() == 1 || _stack[_stack.size()-2].revision != prev_revision ) {
+                // This index was not written at the previous revision, its change set simply moves down
+                state.revision = prev_revision;
+                _frames->touched[ _frames->touched.size() - 2 ].push_back( _self );
+                return;
+            }
+            
             auto& prev_state = _stack[_stack.size()-2];
             
             // An object's relationship to a state can be:
@@ -460,57 +630,10 @@ namespace chainbase {
             // (a serious logic error which should never happen).
             //
             
-            // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's three containers.
-            
-            for( const auto& item : state.old_values )
-            {
-                if( prev_state.new_ids.find( item.second.id ) != prev_state.new_ids.end() )
-                {
-                    // new+upd -> new, type A
-                    continue;
-                }
-                if( prev_state.old_values.find( item.second.id ) != prev_state.old_values.end() )
-                {
-                    // upd(was=X) + upd(was=Y) -> upd(was=X), type A
-                    continue;
-                }
-                // del+upd -> N/A
-                assert( prev_state.removed_values.find(item.second.id) == prev_state.removed_values.end() );
-                // nop+upd(was=Y) -> upd(was=Y), type B
-                prev_state.old_values.emplace( std::move(item) );
-            }
-
-            // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
-            for( const auto& id : state.new_ids )
-                prev_state.new_ids.insert(id);
-            
-            // *+del
-            for( auto& obj : state.removed_values )
-            {
-                if( prev_state.new_ids.find(obj.second.id) != prev_state.new_ids.end() )
-                {
-                    // new + del -> nop (type C)
-                    prev_state.new_ids.erase(obj.second.id);
-                    continue;
-                }
-                auto it = prev_state.old_values.find(obj.second.id);
-                if( it != prev_state.old_values.end() )
-                {
-                    // upd(was=X) + del(was=Y) -> del(was=X)
-                    prev_state.removed_values.emplace( std::move(*it) );
-                    prev_state.old_values.erase(obj.second.id);
-                    continue;
-                }
-                // del + del -> N/A
-                assert( prev_state.removed_values.find( obj.second.id ) == prev_state.removed_values.end() );
-                // nop + del(was=Y) -> del(was=Y)
-                prev_state.removed_values.emplace( std::move(obj) ); //[obj.second->id] = std::move(obj.second);
-            }
+            // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to walk B's journal.
+            prev_state.merge( state );
             
             _stack.pop_back();
-            --_revision;
-            _indices.set_revision( _revision );
-            assert( _indices.revision() == _revision );
         }
 
         /**
@@ -525,108 +648,67 @@ namespace chainbase {
         }
         
         /**
-         * Unwinds all undo states
+         * Records the database revision with the index. The undo stack is owned by the database, which
+         * checks that no session is open before changing the revision itself.
          */
-        void undo_all()
-        {
-            while( enabled() )
-                undo();
-        }
-
         void set_revision( int64_t revision )
         {
-            if( _stack.size() != 0 ) BOOST_THROW_EXCEPTION( std::logic_error("cannot set revision while there is an existing undo stack") );
             _revision = revision;
             _indices.set_revision( _revision );
             assert( _indices.revision() == _revision );
         }
         
     private:
-        bool enabled()const { return _stack.size(); }
+        /**
+         *  Returns the undo state of the head revision, creating it on the first write at that revision.
+         */
+        undo_state_type* head_state( typename value_type::id_type old_next_id ) {
+            if( !_frames || !_frames->enabled() ) return nullptr;
+            
+            if( _stack.empty() || _stack.back().revision != _frames->revision ) {
+                _stack.emplace_back( _indices.get_allocator() );
+                _stack.back().old_next_id = old_next_id;
+                _stack.back().revision = _frames->revision;
+                _frames->touched.back().push_back( _self );
+            }
+            return &_stack.back();
+        }
         
         void on_modify( const value_type& v ) {
-            if( !enabled() ) return;
-            
-            auto& head = _stack.back();
-            
-            if( head.new_ids.find( v.id ) != head.new_ids.end() )
-                return;
-            
-            auto itr = head.old_values.find( v.id );
-            if( itr != head.old_values.end() )
-                return;
-            
-            head.old_values.emplace( std::pair< typename value_type::id_type, const value_type& >( v.id, v ) );
+            ++_change_count;
+            if( auto head = head_state( _next_id ) )
+                head->on_modify( v );
         }
         
         void on_remove( const value_type& v ) {
-            if( !enabled() ) return;
-            
-            auto& head = _stack.back();
-            if( head.new_ids.count(v.id) ) {
-                head.new_ids.erase( v.id );
-                return;
-            }
-            
-            auto itr = head.old_values.find( v.id );
-            if( itr != head.old_values.end() ) {
-                head.removed_values.emplace( std::move( *itr ) );
-                head.old_values.erase( v.id );
-                return;
-            }
-            
-            if( head.removed_values.count( v.id ) )
-                return;
-            
-            head.removed_values.emplace( std::pair< typename value_type::id_type, const value_type& >( v.id, v ) );
+            ++_change_count;
+            if( auto head = head_state( _next_id ) )
+                head->on_remove( v );
         }
         
+        // Called after _next_id has moved past the new object
         void on_create( const value_type& v ) {
-            if( !enabled() ) return;
-            auto& head = _stack.back();
-            
-            head.new_ids.insert( v.id );
+            ++_change_count;
+            if( auto head = head_state( v.id ) )
+                head->on_create( v.id );
         }
         
         boost::interprocess::deque< undo_state_type, allocator<undo_state_type> > _stack;
         
         /**
-         *  Each new session increments the revision, a squash will decrement the revision by combining
-         *  the two most recent revisions into one revision.
-         *
-         *  Commit will discard all revisions prior to the committed revision.
+         *  The revision last recorded with the index. The live revision and the session frames are kept in
+         *  the database's undo_frames.
          */
+        undo_frames*                    _frames = nullptr;
+        abstract_index*                 _self = nullptr;
         int64_t                         _revision = 0;
+        uint64_t                        _change_count = 0;
         typename value_type::id_type    _next_id = 0;
         index_type                      _indices;
         uint32_t                        _size_of_value_type = 0;
         uint32_t                        _size_of_this = 0;
     };
     
-    class abstract_session
-    {
-    public:
-        virtual ~abstract_session(){};
-        virtual void push()             = 0;
-        virtual void squash()           = 0;
-        virtual void undo()             = 0;
-        virtual int64_t revision()const  = 0;
-    };
-
-    template<typename SessionType>
-    class session_impl : public abstract_session
-    {
-    public:
-        session_impl( SessionType&& s ):_session( std::move( s ) ){}
-        
-        virtual void push() override  { _session.push();  }
-        virtual void squash() override{ _session.squash(); }
-        virtual void undo() override  { _session.undo();  }
-        virtual int64_t revision()const override  { return _session.revision();  }
-    private:
-        SessionType _session;
-    };
-    
     class index_extension
     {
     public:
@@ -644,13 +726,11 @@ namespace chainbase {
         abstract_index( void* i ):_idx_ptr(i){}
         virtual ~abstract_index(){}
         virtual void     set_revision( int64_t revision ) = 0;
-        virtual unique_ptr<abstract_session> start_undo_session() = 0;
         
         virtual int64_t revision()const = 0;
         virtual void    undo()const = 0;
         virtual void    squash()const = 0;
         virtual void    commit( int64_t revision )const = 0;
-        virtual void    undo_all()const = 0;
         virtual uint32_t type_id()const  = 0;
         
         virtual statistic_info get_statistics(bool onlyStaticInfo) const = 0;
@@ -688,16 +768,11 @@ namespace chainbase {
             delete (BaseIndex*) abstract_index::_idx_ptr;
         }
         
-        virtual unique_ptr<abstract_session> start_undo_session() override {
-            return unique_ptr<abstract_session>(new session_impl<typename BaseIndex::session>( _base.start_undo_session() ) );
-        }
-        
         virtual void     set_revision( int64_t revision ) override { _base.set_revision( revision ); }
         virtual int64_t  revision()const  override { return _base.revision(); }
         virtual void     undo()const  override { _base.undo(); }
         virtual void     squash()const  override { _base.squash(); }
         virtual void     commit( int64_t revision )const  override { _base.commit(revision); }
-        virtual void     undo_all() const override {_base.undo_all(); }
         virtual uint32_t type_id()const override { return BaseIndex::value_type::type_id; }
         
         virtual statistic_info get_statistics(bool onlyStaticInfo) const override final
@@ -863,38 +938,43 @@ namespace chainbase {
         }
 #endif
         
+        /**
+         *  A session only opens a new undo revision. Per-index undo state is created lazily on the first
+         *  write to an index, so opening and closing a session that touches a few objects costs the same
+         *  regardless of how many indices are registered.
+         */
         struct session
         {
         public:
-            session( session&& s ) : _index_sessions( std::move(s._index_sessions) ), _revision( s._revision ), _session_incrementer( s._session_incrementer )
-            {}
-            
-            session( vector<std::unique_ptr<abstract_session>>&& s, int32_t& session_count ) : _index_sessions( std::move(s) ), _session_incrementer( session_count )
+            session( session&& s ) : _db( s._db ), _apply( s._apply ), _revision( s._revision ), _session_incrementer( s._session_incrementer )
             {
-                if( _index_sessions.size() )
-                    _revision = _index_sessions[0]->revision();
+                s._apply = false;
             }
+            
+            session( database& db, int64_t revision, int32_t& session_count ) : _db( db ), _revision( revision ), _session_incrementer( session_count )
+            {}
 
             ~session() {
                 undo();
             }
             
+            /** leaves the UNDO state on the stack when session goes out of scope */
             void push()
             {
-                for( auto& i : _index_sessions ) i->push();
-                _index_sessions.clear();
+                _apply = false;
             }
             
+            /** combines this session with the prior session */
             void squash()
             {
-                for( auto& i : _index_sessions ) i->squash();
-                _index_sessions.clear();
+                if( _apply ) _db.squash();
+                _apply = false;
             }
             
             void undo()
             {
-                for( auto& i : _index_sessions ) i->undo();
-                _index_sessions.clear();
+                if( _apply ) _db.undo();
+                _apply = false;
             }
             
             int64_t revision()const { return _revision; }
@@ -902,7 +982,8 @@ namespace chainbase {
         private:
             friend class database;
             
-            vector< std::unique_ptr<abstract_session> > _index_sessions;
+            database& _db;
+            bool _apply = true;
             int64_t _revision = -1;
             int_incrementer _session_incrementer;
         };
@@ -911,7 +992,7 @@ namespace chainbase {
         
         int64_t revision()const {
             if( _index_list.size() == 0 ) return -1;
-            return _index_list[0]->revision();
+            return _undo_frames.revision;
         }
         
         void undo();
@@ -923,6 +1004,8 @@ namespace chainbase {
         void set_revision( int64_t revision )
         {
             CHAINBASE_REQUIRE_WRITE_LOCK( "set_revision", int64_t );
+            if( _undo_frames.enabled() ) BOOST_THROW_EXCEPTION( std::logic_error("cannot set revision while there is an existing undo stack") );
+            _undo_frames.revision = revision;
             for( const auto& i : _index_list ) i->set_revision( revision );
         }
         
@@ -1151,9 +1234,25 @@ namespace chainbase {
                 lock.lock();
             }
             
+            // Runs before the lock is released, so a reader that gets the lock next sees the new generation
+            struct generation_bump
+            {
+                std::atomic< uint64_t >& generation;
+                ~generation_bump() { generation.store( next_write_generation(), std::memory_order_release ); }
+            } bump{ _write_generation };
+            
             return callback();
         }
         
+        /**
+         *  Changes after every completed with_write_lock call. Values come from a process wide counter, so two
+         *  database instances never report the same generation. Writes made without with_write_lock do not change it.
+         */
+        uint64_t write_generation()const
+        {
+            return _write_generation.load( std::memory_order_acquire );
+        }
+        
         template< typename IndexExtensionType, typename Lambda >
         void for_each_index_extension( Lambda&& callback )const
         {
@@ -1194,11 +1293,17 @@ namespace chainbase {
                 _index_map.resize( type_id + 1 );
             
             auto new_index = new index<index_type>( *idx_ptr );
+            idx_ptr->set_undo_frames( &_undo_frames, new_index );
             
             _index_map[ type_id ].reset( new_index );
             _index_list.push_back( new_index );
             
-            if( _is_open ) new_index->open( _data_dir, _database_cfg );
+            if( _is_open )
+            {
+                new_index->open( _data_dir, _database_cfg );
+                if( _index_list.size() == 1 )
+                    _undo_frames.revision = new_index->revision();
+            }
         }
         
         read_write_mutex_manager                                    _rw_manager;
@@ -1223,9 +1328,17 @@ namespace chainbase {
         
         bool                                                        _is_open = false;
         
+        undo_frames                                                 _undo_frames;
+        std::atomic< uint64_t >                                     _write_generation{ next_write_generation() };
         int32_t                                                     _undo_session_count = 0;
         size_t                                                      _file_size = 0;
         boost::any                                                  _database_cfg = nullptr;
+        
+        static uint64_t next_write_generation()
+        {
+            static std::atomic< uint64_t > counter( 0 );
+            return counter.fetch_add( 1, std::memory_order_relaxed ) + 1;
+        }
     };
     
 }  // namepsace chainbase
@@ -838,4 +838,93 @@ BOOST_AUTO_TEST_CASE( misc_tests3 )
     misc_test3< test_object3_index, test_object3, ordered_idx3, composite_ordered_idx3a, composite_ordered_idx3b >( { 0, 1, 2 }, db );
 }
 
+BOOST_AUTO_TEST_CASE( undo_journal_tests )
+{
+    try
+    {
+        db.add_index< book_index >();
+        
+        for( int i = 1; i <= 3; ++i )
+            db.create<book>( [&]( book& b ) { b.a = i; b.b = i; } );
+        
+        BOOST_TEST_MESSAGE( "Changing books in two nested sessions" );
+        auto session = db.start_undo_session();
+        
+        db.modify( db.get<book>( book::id_type( 0 ) ), []( book& b ) { b.a = 10; } );
+        db.modify( db.get<book>( book::id_type( 0 ) ), []( book& b ) { b.a = 11; } );
+        db.remove( db.get<book>( book::id_type( 1 ) ) );
+        // Takes the unique key book 0 gets back on undo
+        db.create<book>( []( book& b ) { b.a = 1; b.b = 100; } );
+        
+        {
+            auto nested = db.start_undo_session();
+            db.modify( db.get<book>( book::id_type( 2 ) ), []( book& b ) { b.a = 30; } );
+            const auto& temp = db.create<book>( []( book& b ) { b.a = 4; b.b = 4; } );
+            db.remove( temp );
+            db.remove( db.get<book>( book::id_type( 0 ) ) );
+            nested.squash();
+        }
+        
+        BOOST_REQUIRE( db.find<book>( book::id_type( 0 ) ) == nullptr );
+        BOOST_REQUIRE( db.get<book>( book::id_type( 2 ) ).a == 30 );
+        BOOST_REQUIRE( db.get<book>( book::id_type( 3 ) ).a == 1 );
+        
+        BOOST_TEST_MESSAGE( "Undoing the squashed session" );
+        session.undo();
+        
+        for( int i = 1; i <= 3; ++i )
+        {
+            const auto& b = db.get<book>( book::id_type( i - 1 ) );
+            BOOST_REQUIRE( b.a == i );
+            BOOST_REQUIRE( b.b == i );
+        }
+        BOOST_REQUIRE( db.find<book>( book::id_type( 3 ) ) == nullptr );
+        BOOST_REQUIRE( db.find<book>( book::id_type( 4 ) ) == nullptr );
+        
+        const auto& next = db.create<book>( []( book& b ) { b.a = 5; b.b = 5; } );
+        BOOST_REQUIRE( next.id._id == 3 );
+    }
+    FC_LOG_AND_RETHROW();
+}
+
+BOOST_AUTO_TEST_CASE( lazy_undo_session_tests )
+{
+    try
+    {
+        db.add_index< book_index >();
+        db.add_index< test_object_index >();
+        
+        const auto& first = db.create<book>( []( book& b ) { b.a = 1; b.b = 1; } );
+        int64_t base_revision = db.revision();
+        
+        BOOST_TEST_MESSAGE( "Writing only books in the outer session and only test objects in the inner one" );
+        auto outer = db.start_undo_session();
+        db.modify( first, []( book& b ) { b.a = 2; } );
+        
+        {
+            auto inner = db.start_undo_session();
+            BOOST_REQUIRE( db.revision() == base_revision + 2 );
+            db.create<test_object>( []( test_object& o ) { o.val = 7; o.name = "seven"; } );
+            inner.squash();
+        }
+        
+        BOOST_REQUIRE( db.revision() == base_revision + 1 );
+        
+        {
+            BOOST_TEST_MESSAGE( "An empty session changes nothing when undone" );
+            auto empty = db.start_undo_session();
+            empty.undo();
+            BOOST_REQUIRE( db.get<book>( book::id_type( 0 ) ).a == 2 );
+            BOOST_REQUIRE( db.count<test_object>() == 1 );
+        }
+        
+        BOOST_TEST_MESSAGE( "Undoing the outer session also removes the squashed test object" );
+        outer.undo();
+        BOOST_REQUIRE( db.revision() == base_revision );
+        BOOST_REQUIRE( db.get<book>( book::id_type( 0 ) ).a == 1 );
+        BOOST_REQUIRE( db.count<test_object>() == 0 );
+    }
+    FC_LOG_AND_RETHROW();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -733,6 +733,7 @@ LUA_API int lua_getuservalue (lua_State *L, int idx) {
 }
 
 LUA_API long long lua_getdrops (lua_State *L) {
+  luaV_settledrops(L, NULL, L->enable_drops);
   return L->drops;
 }
 
@@ -901,6 +902,7 @@ LUA_API void lua_setuservalue (lua_State *L, int idx) {
 
 LUA_API int lua_setdrops (lua_State *L, long long drops) {
   lua_lock(L);
+  luaV_settledrops(L, NULL, 0);
   L->drops = drops;
   lua_unlock(L);
   return L->drops < 0 ? 0 : 1;
@@ -909,6 +911,7 @@ LUA_API int lua_setdrops (lua_State *L, long long drops) {
 LUA_API int lua_enabledrops (lua_State *L, int enable, int reset_memused) {
     int pre_enable = L->enable_drops;
     lua_lock(L);
+    luaV_settledrops(L, NULL, pre_enable);
     L->enable_drops = enable;
     if(reset_memused)
         L->memUsed = 0;
@@ -920,6 +923,58 @@ LUA_API int lua_getdropsenabled (lua_State *L) {
     return L->enable_drops;
 }
 
+/*
+** sizes of the structures a contract VM keeps between runs (stack and
+** string table); see 'lua_recyclestate'
+*/
+LUA_API void lua_getstatesizes (lua_State *L, int *stacksize, int *strtsize) {
+  lua_lock(L);
+  if (stacksize) *stacksize = L->stacksize;
+  if (strtsize) *strtsize = G(L)->strt.size;
+  lua_unlock(L);
+}
+
+/*
+** mark a state that is reused across contracts. Only such states keep drop
+** accounting independent of their history (string table resizes, stack
+** shrinking and finalizers of metered threads); a fresh state charges
+** exactly as before pooling
+*/
+LUA_API void lua_setpooled (lua_State *L, int pooled) {
+  lua_lock(L);
+  G(L)->pooled = cast_byte(pooled != 0);
+  lua_unlock(L);
+}
+
+LUA_API int lua_getpooled (lua_State *L) {
+  return G(L)->pooled;
+}
+
+/*
+** bring an idle state back to a canonical footprint before it is reused
+** for another contract: empty stack, full collection, no spare CallInfo,
+** stack and string table back to the given sizes. Drop metering is left
+** disabled with no drops; pending finalizers run with an empty budget.
+*/
+LUA_API void lua_recyclestate (lua_State *L, int stacksize, int strtsize) {
+  lua_lock(L);
+  api_check(L, L->ci == &L->base_ci, "cannot recycle a running state");
+  L->top = L->ci->func + 1;
+  L->enable_drops = 1;  /* leftover finalizers get no drops to run with */
+  L->drops = 0;
+  L->memUsed = 0;
+  luaC_fullgc(L, 0);
+  L->enable_drops = 0;
+  luaE_freeCI(L);
+  if (stacksize > 0 && stacksize != L->stacksize)
+    luaD_reallocstack(L, stacksize);
+  if (strtsize > 0 && strtsize != G(L)->strt.size)
+    luaS_resize(L, strtsize);
+  L->drops = 0;
+  L->memUsed = 0;
+  lua_unlock(L);
+}
+
 /*
 ** 'load' and 'call' functions (run Lua code)
 */
@@ -1037,6 +1092,90 @@ LUA_API int lua_load (lua_State *L, lua_Reader reader, void *data,
 }
 
 
+/*
+** load a chunk without charging it to the running contract; '*memused'
+** receives what decoding it allocated, so that a cached copy of the
+** function can later be charged exactly as a fresh load would be (see
+** 'lua_clonefunction')
+*/
+LUA_API int lua_loadunmetered (lua_State *L, lua_Reader reader, void *data,
+                               const char *chunkname, const char *mode,
+                               size_t *memused) {
+  int status;
+  int old_enable_drops = L->enable_drops;
+  size_t old_memUsed = L->memUsed;
+  L->enable_drops = 0;
+  L->memUsed = 0;
+  status = lua_load(L, reader, data, chunkname, mode);
+  if (memused)
+    *memused = L->memUsed;
+  L->enable_drops = old_enable_drops;
+  L->memUsed = old_memUsed;
+  return status;
+}
+
+
+/*
+** a freshly loaded prototype tree has no cached closures; forget the ones
+** left by earlier runs so that nested closures are allocated (and charged)
+** exactly as after a fresh load
+*/
+static void clearclosurecaches (Proto *p) {
+  int i;
+  p->cache = NULL;
+  for (i = 0; i < p->sizep; i++)
+    clearclosurecaches(p->p[i]);
+}
+
+
+static void chargeclone (lua_State *L, void *ud) {
+  luaM_chargedrops(L, *cast(size_t *, ud));
+}
+
+
+/*
+** push a new function sharing the prototype of the Lua function at 'idx',
+** with fresh upvalues (the first one set to the global table, as 'lua_load'
+** does), and charge 'memused' bytes to the running contract; when the
+** contract cannot pay for it, the error is pushed and returned as
+** 'lua_load' would
+*/
+LUA_API int lua_clonefunction (lua_State *L, int idx, size_t memused) {
+  LClosure *src, *cl;
+  int status;
+  int old_enable_drops;
+  size_t old_memUsed;
+  lua_lock(L);
+  api_check(L, ttisLclosure(index2addr(L, idx)), "Lua function expected");
+  status = luaD_pcall(L, chargeclone, &memused, savestack(L, L->top), 0);
+  if (status != LUA_OK) {
+    lua_unlock(L);
+    return status;
+  }
+  src = clLvalue(index2addr(L, idx));
+  old_enable_drops = L->enable_drops;
+  old_memUsed = L->memUsed;
+  L->enable_drops = 0;
+  cl = luaF_newLclosure(L, src->nupvalues);
+  setclLvalue(L, L->top, cl);
+  api_incr_top(L);
+  cl->p = src->p;
+  luaC_objbarrier(L, cl, cl->p);
+  clearclosurecaches(cl->p);
+  luaF_initupvals(L, cl);
+  if (cl->nupvalues >= 1) {  /* same as 'lua_load' */
+    Table *reg = hvalue(&G(L)->l_registry);
+    const TValue *gt = luaH_getint(reg, LUA_RIDX_GLOBALS);
+    setobj(L, cl->upvals[0]->v, gt);
+    luaC_upvalbarrier(L, cl->upvals[0]);
+  }
+  L->enable_drops = old_enable_drops;
+  L->memUsed = old_memUsed;
+  lua_unlock(L);
+  return LUA_OK;
+}
+
+
 LUA_API int lua_dump (lua_State *L, lua_Writer writer, void *data, int strip) {
   int status;
   TValue *o;
@@ -1122,6 +1261,13 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
       res = g->gcrunning;
       break;
     }
+    case LUA_GCMETEREDFIN: {
+      /* objects marked for finalization by metered code and not finalized
+         yet; while there are none, a full collection cannot run anything a
+         contract could observe */
+      res = (g->meteredfinobjs > 0);
+      break;
+    }
     default: res = -1;  /* invalid option */
   }
   lua_unlock(L);
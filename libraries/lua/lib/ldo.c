@@ -135,6 +135,7 @@ l_noret luaD_throw (lua_State *L, int errcode) {
 
 int luaD_rawrunprotected (lua_State *L, Pfunc f, void *ud) {
   unsigned short oldnCcalls = L->nCcalls;
+  CallInfo *oldci = L->ci;
   struct lua_longjmp lj;
   lj.status = LUA_OK;
   lj.previous = L->errorJmp;  /* chain new error handler */
@@ -144,6 +145,8 @@ int luaD_rawrunprotected (lua_State *L, Pfunc f, void *ud) {
   );
   L->errorJmp = lj.previous;  /* restore old error handler */
   L->nCcalls = oldnCcalls;
+  if (lj.status != LUA_OK)  /* unwound calls give back their prepaid drops */
+    luaV_settledrops(L, oldci, L->enable_drops);
   return lj.status;
 }
 
@@ -457,6 +460,7 @@ int luaD_precall (lua_State *L, StkId func, int nresults) {
       L->top = ci->top = base + fsize;
       lua_assert(ci->top <= L->stack_last);
       ci->u.l.savedpc = p->code;  /* starting point */
+      ci->u.l.paidend = p->code;  /* nothing charged yet */
       ci->callstatus = CIST_LUA;
       if (L->hookmask & LUA_MASKCALL)
         callhook(L, ci);
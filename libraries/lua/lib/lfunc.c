@@ -14,10 +14,12 @@
 
 #include "lua.h"
 
+#include "ldo.h"
 #include "lfunc.h"
 #include "lgc.h"
 #include "lmem.h"
 #include "lobject.h"
+#include "lopcodes.h"
 #include "lstate.h"
 
 
@@ -97,8 +99,19 @@ void luaF_close (lua_State *L, StkId level) {
 
 
 Proto *luaF_newproto (lua_State *L) {
-  GCObject *o = luaC_newobj(L, LUA_TPROTO, sizeof(Proto));
-  Proto *f = gco2p(o);
+  GCObject *o;
+  Proto *f;
+  int old_enable_drops = L->enable_drops;
+  size_t old_memUsed;
+  /* contracts and the collector see a prototype without its metering fields */
+  luaM_chargedrops(L, sizeProto);
+  old_memUsed = L->memUsed;
+  L->enable_drops = 0;
+  o = luaC_newobj(L, LUA_TPROTO, sizeof(Proto));
+  L->enable_drops = old_enable_drops;
+  L->memUsed = old_memUsed;
+  G(L)->GCdebt -= sizeof(Proto) - sizeProto;
+  f = gco2p(o);
   f->k = NULL;
   f->sizek = 0;
   f->p = NULL;
@@ -118,10 +131,87 @@ Proto *luaF_newproto (lua_State *L) {
   f->linedefined = 0;
   f->lastlinedefined = 0;
   f->source = NULL;
+  f->dropinfo = NULL;
   return f;
 }
 
 
+/*
+** mark instruction 'pc' as the first one of a basic block
+*/
+#define markleader(di,n,pc)	{ if ((pc) >= 0 && (pc) < (n)) (di)[pc].end = 1; }
+
+
+/*
+** precompute the drops of the basic blocks of 'f' (straight-line runs of
+** instructions ending at a branch), so that the interpreter can charge a
+** whole block when it enters it instead of charging every instruction.
+** The metering data is derived from the code. It is allocated directly,
+** so it is neither charged nor counted in the collector's debt: drops and
+** collection timing stay those of per-instruction metering.
+** Only pooled states (see 'lua_setpooled') meter by block; prototypes of
+** other states get no metering data and are metered per instruction.
+*/
+void luaF_meterproto (lua_State *L, Proto *f) {
+  global_State *g = G(L);
+  int n = f->sizecode;
+  int pc;
+  int end;
+  long long cost;
+  DropInfo *di;
+  if (!g->pooled)
+    return;
+  if (cast(size_t, n) + 1 > MAX_SIZET / sizeof(DropInfo))
+    luaM_toobig(L);
+  di = cast(DropInfo *, (*g->frealloc)(g->ud, NULL, 0, n * sizeof(DropInfo)));
+  if (di == NULL && n > 0)
+    luaD_throw(L, LUA_ERRMEM);
+  f->dropinfo = di;
+  for (pc = 0; pc < n; pc++)
+    di[pc].end = 0;  /* 'end' marks the first instruction of each block */
+  markleader(di, n, 0);
+  for (pc = 0; pc < n; pc++) {
+    Instruction i = f->code[pc];
+    switch (GET_OPCODE(i)) {
+      case OP_JMP: case OP_FORLOOP: case OP_FORPREP: case OP_TFORLOOP: {
+        markleader(di, n, pc + 1 + GETARG_sBx(i));
+        markleader(di, n, pc + 1);
+        break;
+      }
+      case OP_LOADBOOL: {
+        if (GETARG_C(i) == 0)
+          break;
+        /* else skips next instruction */
+      }  /* FALLTHROUGH */
+      case OP_EQ: case OP_LT: case OP_LE: case OP_TEST: case OP_TESTSET: {
+        markleader(di, n, pc + 1);
+        markleader(di, n, pc + 2);
+        break;
+      }
+      case OP_TFORCALL: case OP_TAILCALL: case OP_RETURN: {
+        markleader(di, n, pc + 1);
+        break;
+      }
+      default: break;
+    }
+  }
+  end = n;
+  cost = 0;
+  for (pc = n - 1; pc >= 0; pc--) {  /* accumulate costs backwards */
+    OpCode op = GET_OPCODE(f->code[pc]);
+    int leader = di[pc].end;
+    /* 'OP_EXTRAARG' is consumed by the previous instruction, never fetched */
+    cost += (op == OP_EXTRAARG) ? 0 : OP_DROPS[op];
+    di[pc].cost = cost;
+    di[pc].end = end;
+    if (leader) {
+      end = pc;
+      cost = 0;
+    }
+  }
+}
+
+
 void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->code, f->sizecode);
   luaM_freearray(L, f->p, f->sizep);
@@ -129,6 +219,9 @@ void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->lineinfo, f->sizelineinfo);
   luaM_freearray(L, f->locvars, f->sizelocvars);
   luaM_freearray(L, f->upvalues, f->sizeupvalues);
+  if (f->dropinfo)  /* see 'luaF_meterproto' */
+    (*G(L)->frealloc)(G(L)->ud, f->dropinfo, f->sizecode * sizeof(DropInfo), 0);
+  G(L)->GCdebt += sizeof(Proto) - sizeProto;  /* see 'luaF_newproto' */
   luaM_free(L, f);
 }
 
@@ -17,6 +17,12 @@
 #define sizeLclosure(n)	(cast(int, sizeof(LClosure)) + \
                          cast(int, sizeof(TValue *)*((n)-1)))
 
+/*
+** size a prototype is accounted for, in drops and in the collector's debt:
+** its metering fields are left out, so neither changes with block metering
+*/
+#define sizeProto	offsetof(Proto, dropinfo)
+
 
 /* test whether thread is in 'twups' list */
 #define isintwups(L)	(L->twups != L)
@@ -48,6 +54,7 @@ struct UpVal {
 
 
 LUAI_FUNC Proto *luaF_newproto (lua_State *L);
+LUAI_FUNC void luaF_meterproto (lua_State *L, Proto *f);
 LUAI_FUNC CClosure *luaF_newCclosure (lua_State *L, int nelems);
 LUAI_FUNC LClosure *luaF_newLclosure (lua_State *L, int nelems);
 LUAI_FUNC void luaF_initupvals (lua_State *L, LClosure *cl);
@@ -448,11 +448,19 @@ static void traversestrongtable (global_State *g, Table *h) {
 }
 
 
+/*
+** while a contract is metered in a pooled state, weak tables are traversed
+** as strong ones: what they lose would depend on when the collector runs,
+** which is not the same on every node once VMs are pooled and cache
+** prototypes
+*/
+#define weaknessignored(g)	((g)->pooled && (g)->mainthread->enable_drops != 0)
+
 static lu_mem traversetable (global_State *g, Table *h) {
   const char *weakkey, *weakvalue;
   const TValue *mode = gfasttm(g, h->metatable, TM_MODE);
   markobjectN(g, h->metatable);
-  if (mode && ttisstring(mode) &&  /* is there a weak mode? */
+  if (mode && ttisstring(mode) && !weaknessignored(g) &&  /* is there a weak mode? */
       ((weakkey = strchr(svalue(mode), 'k')),
        (weakvalue = strchr(svalue(mode), 'v')),
        (weakkey || weakvalue))) {  /* is really weak? */
@@ -489,7 +497,7 @@ static int traverseproto (global_State *g, Proto *f) {
     markobjectN(g, f->p[i]);
   for (i = 0; i < f->sizelocvars; i++)  /* mark local-variable names */
     markobjectN(g, f->locvars[i].varname);
-  return sizeof(Proto) + sizeof(Instruction) * f->sizecode +
+  return sizeProto + sizeof(Instruction) * f->sizecode +
                          sizeof(Proto *) * f->sizep +
                          sizeof(TValue) * f->sizek +
                          sizeof(int) * f->sizelineinfo +
@@ -545,8 +553,8 @@ static lu_mem traversethread (global_State *g, lua_State *th) {
       g->twups = th;
     }
   }
-  else if (g->gckind != KGC_EMERGENCY)
-    luaD_shrinkstack(th); /* do not change stack in emergency cycle */
+  else if (g->gckind != KGC_EMERGENCY && !(g->pooled && th->enable_drops))
+    luaD_shrinkstack(th); /* do not change stack in emergency cycle or while a pooled state meters drops */
   return (sizeof(lua_State) + sizeof(TValue) * th->stacksize +
           sizeof(CallInfo) * th->nci);
 }
@@ -792,6 +800,10 @@ static GCObject *udata2finalize (global_State *g) {
   o->next = g->allgc;  /* return it to 'allgc' list */
   g->allgc = o;
   resetbit(o->marked, FINALIZEDBIT);  /* object is "normal" again */
+  if (testbit(o->marked, METEREDFINBIT)) {
+    resetbit(o->marked, METEREDFINBIT);
+    g->meteredfinobjs--;
+  }
   if (issweepphase(g))
     makewhite(g, o);  /* "sweep" object */
   return o;
@@ -838,6 +850,14 @@ static void GCTM (lua_State *L, int propagateerrors) {
 }
 
 
+/*
+** finalizers of a thread that is metering drops wait for an explicit full
+** collection, so what they cost does not depend on when the incremental
+** collector happens to reach them (added for pooled contract VMs)
+*/
+#define finalizersdeferred(L)	(G(L)->pooled && (L)->enable_drops != 0)
+
+
 /*
 ** call a few (up to 'g->gcfinnum') finalizers
 */
@@ -917,6 +937,10 @@ void luaC_checkfinalizer (lua_State *L, GCObject *o, Table *mt) {
     o->next = g->finobj;  /* link it in 'finobj' list */
     g->finobj = o;
     l_setbit(o->marked, FINALIZEDBIT);  /* mark it as such */
+    if (L->enable_drops) {  /* a contract will expect it to be finalized */
+      l_setbit(o->marked, METEREDFINBIT);
+      g->meteredfinobjs++;
+    }
   }
 }
 
@@ -979,6 +1003,28 @@ void luaC_freeallobjects (lua_State *L) {
 }
 
 
+/*
+** traverse as strong the weak tables that were listed before metering
+** started (see 'weaknessignored')
+*/
+static void strengthenweaktables (global_State *g) {
+  GCObject *lists[3];
+  int i;
+  lists[0] = g->weak; lists[1] = g->ephemeron; lists[2] = g->allweak;
+  g->weak = g->ephemeron = g->allweak = NULL;
+  for (i = 0; i < 3; i++) {
+    GCObject *w = lists[i];
+    while (w) {
+      Table *h = gco2t(w);
+      w = h->gclist;
+      gray2black(h);
+      traversestrongtable(g, h);
+    }
+  }
+  propagateall(g);
+}
+
+
 static l_mem atomic (lua_State *L) {
   global_State *g = G(L);
   l_mem work;
@@ -1000,6 +1046,8 @@ static l_mem atomic (lua_State *L) {
   propagateall(g);  /* traverse 'grayagain' list */
   g->GCmemtrav = 0;  /* restart counting */
   convergeephemerons(g);
+  if (weaknessignored(g))
+    strengthenweaktables(g);
   /* at this point, all strongly accessible objects are marked. */
   /* Clear values from weak tables, before checking finalizers */
   clearvalues(g, g->weak, NULL);
@@ -1083,7 +1131,7 @@ static lu_mem singlestep (lua_State *L) {
       return 0;
     }
     case GCScallfin: {  /* call remaining finalizers */
-      if (g->tobefnz && g->gckind != KGC_EMERGENCY) {
+      if (g->tobefnz && g->gckind != KGC_EMERGENCY && !finalizersdeferred(L)) {
         int n = runafewfinalizers(L);
         return (n * GCFINALIZECOST);
       }
@@ -1142,7 +1190,8 @@ void luaC_step (lua_State *L) {
   else {
     debt = (debt / g->gcstepmul) * STEPMULADJ;  /* convert 'work units' to Kb */
     luaE_setdebt(g, debt);
-    runafewfinalizers(L);
+    if (!finalizersdeferred(L))
+      runafewfinalizers(L);
   }
 }
 
@@ -1172,6 +1221,10 @@ void luaC_fullgc (lua_State *L, int isemergency) {
   luaC_runtilstate(L, bitmask(GCSpause));  /* finish collection */
   g->gckind = KGC_NORMAL;
   setpause(g);
+  if (!isemergency && g->pooled) {
+    while (g->tobefnz)  /* finalizers deferred by a metered thread */
+      GCTM(L, 1);
+  }
 }
 
 /* }====================================================== */
@@ -20,6 +20,7 @@
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
+#include "lvm.h"
 
 
 
@@ -71,6 +72,24 @@ l_noret luaM_toobig (lua_State *L) {
 
 
 
+/*
+** check memory used in smart contact, memUsed record
+** the left unrecorded memory size.
+*/
+void luaM_chargedrops (lua_State *L, size_t nsize) {
+  L->memUsed += nsize;
+  if(L->enable_drops != 0) {
+    L->drops -= (L->memUsed / CONTRACT_MEM_UNIT_SIZE) * CONTRACT_MEN_UNIT_DROP_COST;
+    L->memUsed = L->memUsed % CONTRACT_MEM_UNIT_SIZE;
+    if (L->drops < 0) {
+      luaV_settledrops(L, NULL, 1);  /* count drops prepaid for basic blocks */
+      if (L->drops < 0)
+        luaD_throw(L, LUA_ERRMEM);
+    }
+  }
+}
+
+
 /*
 ** generic allocation routine.
 */
@@ -83,18 +102,7 @@ void *luaM_realloc_ (lua_State *L, void *block, size_t osize, size_t nsize) {
   if (nsize > realosize && g->gcrunning)
     luaC_fullgc(L, 1);  /* force a GC whenever possible */
 #endif
-  /**
-   * check memory used in smart contact, memUsed record
-   * the left unrecorded memory size.
-   */
-  L->memUsed += nsize;
-  if(L->enable_drops != 0) {
-    L->drops -= (L->memUsed / CONTRACT_MEM_UNIT_SIZE) * CONTRACT_MEN_UNIT_DROP_COST;
-    L->memUsed = L->memUsed % CONTRACT_MEM_UNIT_SIZE;
-    if (L->drops < 0) {
-      luaD_throw(L, LUA_ERRMEM);
-    }
-  }
+  luaM_chargedrops(L, nsize);
 
   newblock = (*g->frealloc)(g->ud, block, osize, nsize);
   if (newblock == NULL && nsize > 0) {
@@ -65,6 +65,9 @@
 
 LUAI_FUNC l_noret luaM_toobig (lua_State *L);
 
+/* charge 'nsize' bytes of memory to the running contract */
+LUAI_FUNC void luaM_chargedrops (lua_State *L, size_t nsize);
+
 /* not to be called directly */
 LUAI_FUNC void *luaM_realloc_ (lua_State *L, void *block, size_t oldsize,
                                                           size_t size);
@@ -401,6 +401,15 @@ typedef struct LocVar {
 } LocVar;
 
 
+/*
+** Drops metering of an instruction (see 'luaF_meterproto')
+*/
+typedef struct DropInfo {
+  long long cost;  /* drops from this instruction to the end of its block */
+  int end;  /* first instruction after its basic block */
+} DropInfo;
+
+
 /*
 ** Function Prototypes
 */
@@ -426,6 +435,7 @@ typedef struct Proto {
   struct LClosure *cache;  /* last-created closure with this prototype */
   TString  *source;  /* used for debug information */
   GCObject *gclist;
+  DropInfo *dropinfo;  /* drops metering of each instruction */
 } Proto;
 
 
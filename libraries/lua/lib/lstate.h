@@ -97,6 +97,7 @@ typedef struct CallInfo {
     struct {  /* only for Lua functions */
       StkId base;  /* base for this function */
       const Instruction *savedpc;
+      const Instruction *paidend;  /* end of the drops already charged */
     } l;
     struct {  /* only for C functions */
       lua_KFunction k;  /* continuation in case of yields */
@@ -160,6 +161,8 @@ typedef struct global_State {
   GCObject *fixedgc;  /* list of objects not to be collected */
   struct lua_State *twups;  /* list of threads with open upvalues */
   unsigned int gcfinnum;  /* number of finalizers to call in each GC step */
+  lu_mem meteredfinobjs;  /* objects marked for finalization by metered code */
+  lu_byte pooled;  /* state is reused across contracts (see 'lua_setpooled') */
   int gcpause;  /* size of pause between successive GCs */
   int gcstepmul;  /* GC 'granularity' */
   lua_CFunction panic;  /* to be called in unprotected errors */
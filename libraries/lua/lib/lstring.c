@@ -71,6 +71,13 @@ unsigned int luaS_hashlongstr (TString *ts) {
 void luaS_resize (lua_State *L, int newsize) {
   int i;
   stringtable *tb = &G(L)->strt;
+  /* added for pooled contract VMs: the table size depends on the history of
+     the state, so resizing it is not charged to the running contract */
+  int pooled = G(L)->pooled;
+  int old_enable_drops = L->enable_drops;
+  size_t old_memUsed = L->memUsed;
+  if (pooled)
+    L->enable_drops = 0;
   if (newsize > tb->size) {  /* grow table if needed */
     luaM_reallocvector(L, tb->hash, tb->size, newsize, TString *);
     for (i = tb->size; i < newsize; i++)
@@ -93,6 +100,10 @@ void luaS_resize (lua_State *L, int newsize) {
     luaM_reallocvector(L, tb->hash, tb->size, newsize, TString *);
   }
   tb->size = newsize;
+  if (pooled) {
+    L->enable_drops = old_enable_drops;
+    L->memUsed = old_memUsed;
+  }
 }
 
 
@@ -176,6 +187,11 @@ static TString *internshrstr (lua_State *L, const char *str, size_t l) {
       /* found! */
       if (isdead(g, ts))  /* dead (but not collected yet)? */
         changewhite(ts);  /* resurrect it */
+      /* in a pooled state whether the string is still interned depends on
+         its history (collector, cached prototypes), so a hit costs the
+         contract what creating it would */
+      if (g->pooled)
+        luaM_chargedrops(L, sizelstring(l));
       return ts;
     }
   }
@@ -221,8 +237,11 @@ TString *luaS_new (lua_State *L, const char *str) {
   int j;
   TString **p = G(L)->strcache[i];
   for (j = 0; j < STRCACHE_M; j++) {
-    if (strcmp(str, getstr(p[j])) == 0)  /* hit? */
+    if (strcmp(str, getstr(p[j])) == 0) {  /* hit? */
+      if (G(L)->pooled)  /* same as a miss, see 'internshrstr' */
+        luaM_chargedrops(L, sizelstring(tsslen(p[j])));
       return p[j];  /* that is it */
+    }
   }
   /* normal route */
   for (j = STRCACHE_M - 1; j > 0; j--)
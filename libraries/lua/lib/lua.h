@@ -268,6 +268,10 @@ LUA_API void  (lua_setuservalue) (lua_State *L, int idx);
 LUA_API int   (lua_setdrops) (lua_State *L, long long drops);
 LUA_API int   (lua_enabledrops) (lua_State *L, int enable, int reset_memused);
 LUA_API int   (lua_getdropsenabled) (lua_State *L);
+LUA_API void  (lua_getstatesizes) (lua_State *L, int *stacksize, int *strtsize);
+LUA_API void  (lua_recyclestate) (lua_State *L, int stacksize, int strtsize);
+LUA_API void  (lua_setpooled) (lua_State *L, int pooled);
+LUA_API int   (lua_getpooled) (lua_State *L);
 
 /*
 ** 'load' and 'call' functions (load and run Lua code)
@@ -283,6 +287,11 @@ LUA_API int   (lua_pcallk) (lua_State *L, int nargs, int nresults, int errfunc,
 LUA_API int   (lua_load) (lua_State *L, lua_Reader reader, void *dt,
                           const char *chunkname, const char *mode);
 
+LUA_API int   (lua_loadunmetered) (lua_State *L, lua_Reader reader, void *dt,
+                                   const char *chunkname, const char *mode,
+                                   size_t *memused);
+LUA_API int   (lua_clonefunction) (lua_State *L, int idx, size_t memused);
+
 LUA_API int (lua_dump) (lua_State *L, lua_Writer writer, void *data, int strip);
 
 
@@ -311,6 +320,7 @@ LUA_API int (lua_isyieldable) (lua_State *L);
 #define LUA_GCSETPAUSE		6
 #define LUA_GCSETSTEPMUL	7
 #define LUA_GCISRUNNING		9
+#define LUA_GCMETEREDFIN	10
 
 LUA_API int (lua_gc) (lua_State *L, int what, int data);
 
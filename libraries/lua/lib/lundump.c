@@ -209,6 +209,7 @@ static void LoadFunction (LoadState *S, Proto *f, TString *psource) {
   f->is_vararg = LoadByte(S);
   f->maxstacksize = LoadByte(S);
   LoadCode(S, f);
+  luaF_meterproto(S->L, f);
   LoadConstants(S, f);
   LoadUpvalues(S, f);
   LoadProtos(S, f);
@@ -734,11 +734,14 @@ void luaV_finishOp (lua_State *L) {
 	ISK(GETARG_C(i)) ? k+INDEXK(GETARG_C(i)) : base+GETARG_C(i))
 
 
+/* jumping out of a prepaid basic block: charge again at the target */
+#define leaveblock(ci)	((ci)->u.l.paidend = cl->p->code)
+
 /* execute a jump instruction */
 #define dojump(ci,i,e) \
   { int a = GETARG_A(i); \
     if (a != 0) luaF_close(L, ci->u.l.base + a - 1); \
-    ci->u.l.savedpc += GETARG_sBx(i) + e; }
+    ci->u.l.savedpc += GETARG_sBx(i) + e; leaveblock(ci); }
 
 /* for test instructions, execute the jump instruction that follows it */
 #define donextjump(ci)	{ i = *ci->u.l.savedpc; dojump(ci, i, 1); }
@@ -782,6 +785,49 @@ void luaV_finishOp (lua_State *L) {
     Protect(luaV_finishset(L,t,k,v,slot)); }
 
 
+/*
+** settle the drops prepaid for the basic blocks of the Lua calls above
+** 'limit' (all calls when NULL): the part of each block not executed yet
+** is given back when 'refund' is true, and each call is charged again
+** from its next instruction
+*/
+void luaV_settledrops (lua_State *L, CallInfo *limit, int refund) {
+  CallInfo *ci;
+  for (ci = L->ci; ci != limit && ci != NULL; ci = ci->previous) {
+    if (isLua(ci)) {
+      if (refund && ci->u.l.paidend > ci->u.l.savedpc) {
+        Proto *p = clLvalue(ci->func)->p;
+        L->drops += p->dropinfo[ci->u.l.savedpc - p->code].cost;
+      }
+      ci->u.l.paidend = ci->u.l.savedpc;
+    }
+  }
+}
+
+
+/*
+** slow path of block metering, when the drops left cannot pay for the
+** block 'ci' is entering: the drops prepaid by every call are settled
+** and, if still short, instructions are charged one by one, so a contract
+** runs out of drops at exactly the same instruction as with
+** per-instruction metering. Returns 0 when the drops ran out.
+*/
+static int chargeblock (lua_State *L, CallInfo *ci) {
+  Proto *p = clLvalue(ci->func)->p;
+  int pc = pcRel(ci->u.l.savedpc, p);
+  const DropInfo *di = &p->dropinfo[pc];
+  luaV_settledrops(L, NULL, 1);  /* take back what other blocks prepaid */
+  if (L->drops >= di->cost) {
+    L->drops -= di->cost;
+    ci->u.l.paidend = p->code + di->end;
+    return 1;
+  }
+  L->drops -= OP_DROPS[GET_OPCODE(p->code[pc])];  /* this instruction only */
+  ci->u.l.paidend = ci->u.l.savedpc;
+  return (L->drops >= 0);
+}
+
+
 
 void luaV_execute (lua_State *L) {
   CallInfo *ci = L->ci;
@@ -800,11 +846,29 @@ void luaV_execute (lua_State *L) {
     StkId ra;
     vmfetch();
 
-    if(L->enable_drops != 0) {
-      long long cost = OP_DROPS[GET_OPCODE(i)];
-      L->drops -= cost;
-      if (L->drops < 0) {
-        vmbreak;
+    if (ci->u.l.savedpc > ci->u.l.paidend) {  /* entering a basic block? */
+      const DropInfo *di = cl->p->dropinfo;
+      if (di == NULL) {  /* not block metered: every instruction is a block */
+        ci->u.l.paidend = ci->u.l.savedpc;
+        if (L->enable_drops != 0) {
+          L->drops -= OP_DROPS[GET_OPCODE(i)];
+          if (L->drops < 0) {  /* calling frames stop at their next instruction */
+            luaV_settledrops(L, NULL, 1);
+            vmbreak;
+          }
+        }
+      }
+      else {
+        di += pcRel(ci->u.l.savedpc, cl->p);
+        if (L->enable_drops == 0)
+          ci->u.l.paidend = cl->p->code + di->end;
+        else if (L->drops >= di->cost) {
+          L->drops -= di->cost;
+          ci->u.l.paidend = cl->p->code + di->end;
+        }
+        else if (!chargeblock(L, ci)) {  /* out of drops? */
+          vmbreak;
+        }
       }
     }
     
@@ -1175,6 +1239,7 @@ void luaV_execute (lua_State *L) {
           oci->u.l.base = ofunc + (nci->u.l.base - nfunc);  /* correct base */
           oci->top = L->top = ofunc + (L->top - nfunc);  /* correct top */
           oci->u.l.savedpc = nci->u.l.savedpc;
+          oci->u.l.paidend = nci->u.l.paidend;
           oci->callstatus |= CIST_TAIL;  /* function was tail called */
           ci = L->ci = oci;  /* remove new frame */
           lua_assert(L->top == oci->u.l.base + getproto(ofunc)->maxstacksize);
@@ -1203,6 +1268,7 @@ void luaV_execute (lua_State *L) {
           lua_Integer limit = ivalue(ra + 1);
           if ((0 < step) ? (idx <= limit) : (limit <= idx)) {
             ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
+            leaveblock(ci);
             chgivalue(ra, idx);  /* update internal index... */
             setivalue(ra + 3, idx);  /* ...and external index */
           }
@@ -1214,6 +1280,7 @@ void luaV_execute (lua_State *L) {
           if (luai_numlt(0, step) ? luai_numle(idx, limit)
                                   : luai_numle(limit, idx)) {
             ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
+            leaveblock(ci);
             chgfltvalue(ra, idx);  /* update internal index... */
             setfltvalue(ra + 3, idx);  /* ...and external index */
           }
@@ -1266,6 +1333,7 @@ void luaV_execute (lua_State *L) {
         if (!ttisnil(ra + 1)) {  /* continue loop? */
           setobjs2s(L, ra, ra + 1);  /* save control variable */
            ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
+           leaveblock(ci);
         }
         vmbreak;
       }
@@ -22,5 +22,51 @@ namespace taiyi { namespace net {
     const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
     const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
 
+    block_id_type block_message::read_block_id( const message& m )
+    {
+        FC_ASSERT( m.msg_type == block_message::type && m.data.size() >= sizeof( block_id_type ) );
+        block_id_type id;
+        memcpy( id._hash, m.data.data() + m.data.size() - sizeof( block_id_type ), sizeof( block_id_type ) );
+        return id;
+    }
+
+    template<>
+    message::message( const block_message& m )
+    {
+        msg_type = block_message::type;
+        const auto& packed = m.state->get_packed();
+        data.reserve( packed.size() + sizeof( block_id_type ) );
+        data.insert( data.end(), packed.begin(), packed.end() );
+        data.insert( data.end(), (const char*)m.block_id._hash, (const char*)m.block_id._hash + sizeof( block_id_type ) );
+        size = (uint32_t)data.size();
+    }
+
+    template<>
+    block_message message::as< block_message >()const
+    {
+        try {
+            FC_ASSERT( msg_type == block_message::type );
+            FC_ASSERT( data.size() >= sizeof( block_id_type ) );
+
+            std::vector< char > packed( data.begin(), data.end() - sizeof( block_id_type ) );
+            signed_block block;
+            fc::datastream< const char* > ds( packed.data(), packed.size() );
+            fc::raw::unpack( ds, block );
+            FC_ASSERT( ds.remaining() == 0, "Unexpected trailing bytes after the packed block" );
+            // varints accept overlong encodings; the peer's bytes feed the block size check and the block log,
+            // so they must match the canonical packing exactly
+            FC_ASSERT( fc::raw::pack_to_vector( block ) == packed, "Block is not canonically encoded" );
+
+            block_message result( block_state::create( std::move( block ), std::move( packed ) ) );
+            result.block_id = block_message::read_block_id( *this );
+            return result;
+        } FC_RETHROW_EXCEPTIONS(warn,
+            "error unpacking network message as a '${type}'  ${x} !=? ${msg_type}",
+            ("type", "taiyi::net::block_message")
+            ("x", block_message::type)
+            ("msg_type", msg_type)
+            );
+    }
+
 } } // taiyi::net
 
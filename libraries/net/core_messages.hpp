@@ -1,7 +1,8 @@
 #pragma once
 
 #include "config.hpp"
-#include <protocol/block.hpp>
+#include "message.hpp"
+#include <protocol/block_state.hpp>
 
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/crypto/elliptic.hpp>
@@ -21,6 +22,8 @@ namespace taiyi { namespace net {
     using taiyi::protocol::block_id_type;
     using taiyi::protocol::transaction_id_type;
     using taiyi::protocol::signed_block;
+    using taiyi::protocol::block_state;
+    using taiyi::protocol::block_state_ptr;
 
     typedef fc::ecc::public_key_data node_id_t;
     typedef fc::ripemd160 item_hash_t;
@@ -79,18 +82,35 @@ namespace taiyi { namespace net {
         {}
     };
 
+    /**
+     *  The block travels as a shared immutable block_state from the socket read to the block log,
+     *  so copies of the message only copy a pointer. The wire format is unchanged (the packed block
+     *  followed by its id); it is written and read by the message specializations below, which keep
+     *  the packed bytes received from the peer for re-broadcast and block log appends. Unpacking
+     *  rejects blocks whose bytes differ from their canonical packing.
+     */
     struct block_message
     {
         static const core_message_type_enum type;
 
         block_message(){}
         block_message(const signed_block& blk)
-            :block(blk), block_id(blk.id()){}
+            :state(block_state::create(blk)), block_id(state->get_id()){}
+        block_message(block_state_ptr s)
+            :state(std::move(s)), block_id(state->get_id()){}
 
-        signed_block    block;
+        const signed_block& block()const { return state->get_block(); }
+
+        /// Read only the id of a packed block message, without unpacking or hashing the block
+        static block_id_type read_block_id( const message& m );
+
+        block_state_ptr state;
         block_id_type   block_id;
     };
 
+    template<> message::message( const block_message& m );
+    template<> block_message message::as< block_message >()const;
+
     struct item_ids_inventory_message
     {
         static const core_message_type_enum type;
@@ -402,7 +422,7 @@ FC_REFLECT_ENUM( taiyi::net::core_message_type_enum,
 )
 
 FC_REFLECT( taiyi::net::trx_message, (trx) )
-FC_REFLECT( taiyi::net::block_message, (block)(block_id) )
+FC_REFLECT( taiyi::net::block_message, (block_id) ) // the block is packed by message( const block_message& )
 
 FC_REFLECT( taiyi::net::item_id, (item_type)(item_hash) )
 FC_REFLECT( taiyi::net::item_ids_inventory_message, (item_type)(item_hashes_available) )
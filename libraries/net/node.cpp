@@ -2749,15 +2749,15 @@ namespace taiyi { namespace net {
             // if we sent them a block, update our record of the last block they've seen accordingly
             if (last_block_message_sent)
             {
-                taiyi::net::block_message block = last_block_message_sent->as<taiyi::net::block_message>();
-                originating_peer->last_block_delegate_has_seen = block.block_id;
-                originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+                block_id_type last_block_id = block_message::read_block_id(*last_block_message_sent);
+                originating_peer->last_block_delegate_has_seen = last_block_id;
+                originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(last_block_id);
             }
             
             for (const message& reply : reply_messages)
             {
                 if (reply.msg_type == block_message_type)
-                    originating_peer->send_item(item_id(block_message_type, reply.as<taiyi::net::block_message>().block_id));
+                    originating_peer->send_item(item_id(block_message_type, block_message::read_block_id(reply)));
                 else
                     originating_peer->send_message(reply);
             }
@@ -3006,17 +3006,17 @@ namespace taiyi { namespace net {
                 std::vector<fc::uint160_t> contained_transaction_message_ids;
                 fc_ilog(fc::logger::get("sync"),
                         "p2p pushing sync block #${block_num} ${block_hash}",
-                        ("block_num", block_message_to_send.block.block_num())
+                        ("block_num", block_message_to_send.block().block_num())
                         ("block_hash", block_message_to_send.block_id));
                 _delegate->handle_block(block_message_to_send, true, contained_transaction_message_ids);
                 
-                auto bn = block_message_to_send.block.block_num();
+                auto bn = block_message_to_send.block().block_num();
                 //if(bn % 1000 == 0)
                 {
                     ilog("Successfully pushed sync block ${num} (id:${id}) by ${siming}",
                          ("num", bn)
                          ("id", block_message_to_send.block_id)
-                         ("siming", block_message_to_send.block.siming));
+                         ("siming", block_message_to_send.block().siming));
                 }
                 
                 _most_recent_blocks_accepted.push_back(block_message_to_send.block_id);
@@ -3028,12 +3028,12 @@ namespace taiyi { namespace net {
                 fc_wlog(fc::logger::get("sync"),
                         "p2p failed to push sync block #${block_num} ${block_hash}: block is on a fork older than our undo history would "
                         "allow us to switch to: ${e}",
-                        ("block_num", block_message_to_send.block.block_num())
+                        ("block_num", block_message_to_send.block().block_num())
                         ("block_hash", block_message_to_send.block_id)
                         ("e", (fc::exception)e));
                 wlog("Failed to push sync block ${num} (id:${id}): block is on a fork older than our undo history would "
                      "allow us to switch to: ${e}",
-                     ("num", block_message_to_send.block.block_num())
+                     ("num", block_message_to_send.block().block_num())
                      ("id", block_message_to_send.block_id)
                      ("e", (fc::exception)e));
                 handle_message_exception = e;
@@ -3047,10 +3047,10 @@ namespace taiyi { namespace net {
             {
                 fc_wlog(fc::logger::get("sync"),
                         "p2p failed to push sync block #${block_num} ${block_hash}: client rejected sync block sent by peer: ${e}",
-                        ("block_num", block_message_to_send.block.block_num())
+                        ("block_num", block_message_to_send.block().block_num())
                         ("block_hash", block_message_to_send.block_id)("e", e));
                 wlog("Failed to push sync block ${num} (id:${id}): client rejected sync block sent by peer: ${e}",
-                     ("num", block_message_to_send.block.block_num())
+                     ("num", block_message_to_send.block().block_num())
                      ("id", block_message_to_send.block_id)
                      ("e", e));
                 handle_message_exception = e;
@@ -3067,7 +3067,7 @@ namespace taiyi { namespace net {
                 --_total_number_of_unfetched_items;
                 dlog("sync: client accpted the block, we now have only ${count} items left to fetch before we're in sync",
                      ("count", _total_number_of_unfetched_items));
-                bool is_fork_block = is_hard_fork_block(block_message_to_send.block.block_num());
+                bool is_fork_block = is_hard_fork_block(block_message_to_send.block().block_num());
                 for (const peer_connection_ptr& peer : _active_connections)
                 {
                     ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
@@ -3080,11 +3080,11 @@ namespace taiyi { namespace net {
                         {
                             uint32_t next_fork_block_number = get_next_known_hard_fork_block_number(peer->last_known_fork_block_number);
                             if (next_fork_block_number != 0 &&
-                                next_fork_block_number <= block_message_to_send.block.block_num())
+                                next_fork_block_number <= block_message_to_send.block().block_num())
                             {
                                 std::ostringstream disconnect_reason_stream;
-                                disconnect_reason_stream << "You need to upgrade your client due to hard fork at block " << block_message_to_send.block.block_num();
-                                peers_to_disconnect[peer] = std::make_pair(disconnect_reason_stream.str(), fc::oexception(fc::exception(FC_LOG_MESSAGE(error, "You need to upgrade your client due to hard fork at block ${block_number}", ("block_number", block_message_to_send.block.block_num())))));
+                                disconnect_reason_stream << "You need to upgrade your client due to hard fork at block " << block_message_to_send.block().block_num();
+                                peers_to_disconnect[peer] = std::make_pair(disconnect_reason_stream.str(), fc::oexception(fc::exception(FC_LOG_MESSAGE(error, "You need to upgrade your client due to hard fork at block ${block_number}", ("block_number", block_message_to_send.block().block_num())))));
 #ifdef ENABLE_DEBUG_ULOGS
                                 ulog("Disconnecting from peer during sync because their version is too old.  Their version date: ${date}", ("date", peer->taiyi_git_revision_unix_timestamp));
 #endif
@@ -3116,7 +3116,7 @@ namespace taiyi { namespace net {
                         if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
                         {
                             peer->last_block_delegate_has_seen = block_message_to_send.block_id;
-                            peer->last_block_time_delegate_has_seen = block_message_to_send.block.timestamp;
+                            peer->last_block_time_delegate_has_seen = block_message_to_send.block().timestamp;
                             
                             peer->ids_of_items_being_processed.erase(items_being_processed_iter);
                             dlog("Removed item from ${endpoint}'s list of items being processed, still processing ${len} blocks",
@@ -3363,16 +3363,16 @@ namespace taiyi { namespace net {
                     _message_ids_currently_being_processed.insert(message_hash);
                     fc_ilog(fc::logger::get("sync"),
                             "p2p pushing block #${block_num} ${block_hash} from ${peer} (message_id was ${id})",
-                            ("block_num", block_message_to_process.block.block_num())
+                            ("block_num", block_message_to_process.block().block_num())
                             ("block_hash", block_message_to_process.block_id)
                             ("peer", originating_peer->get_remote_endpoint())("id", message_hash));
                     _delegate->handle_block(block_message_to_process, false, contained_transaction_message_ids);
                     _message_ids_currently_being_processed.erase(message_hash);
                     message_validated_time = fc::time_point::now();
                     ilog("Successfully pushed block ${num} (id:${id}) by ${siming}",
-                         ("num", block_message_to_process.block.block_num())
+                         ("num", block_message_to_process.block().block_num())
                          ("id", block_message_to_process.block_id)
-                         ("siming", block_message_to_process.block.siming));
+                         ("siming", block_message_to_process.block().siming));
                     _most_recent_blocks_accepted.push_back(block_message_to_process.block_id);
                     
                     bool new_transaction_discovered = false;
@@ -3397,7 +3397,7 @@ namespace taiyi { namespace net {
                 {
                     fc_ilog(fc::logger::get("sync"),
                             "p2p NOT pushing block #${block_num} ${block_hash} from ${peer} because we recently pushed it",
-                            ("block_num", block_message_to_process.block.block_num())
+                            ("block_num", block_message_to_process.block().block_num())
                             ("block_hash", block_message_to_process.block_id)
                             ("peer", originating_peer->get_remote_endpoint())("id", message_hash));
                     dlog( "Already received and accepted this block (presumably through sync mechanism), treating it as accepted" );
@@ -3406,8 +3406,8 @@ namespace taiyi { namespace net {
                 dlog( "client validated the block, advertising it to other peers" );
                 
                 item_id block_message_item_id(core_message_type_enum::block_message_type, message_hash);
-                uint32_t block_number = block_message_to_process.block.block_num();
-                fc::time_point_sec block_time = block_message_to_process.block.timestamp;
+                uint32_t block_number = block_message_to_process.block().block_num();
+                fc::time_point_sec block_time = block_message_to_process.block().timestamp;
                 
                 for (const peer_connection_ptr& peer : _active_connections)
                 {
@@ -3469,7 +3469,7 @@ namespace taiyi { namespace net {
             {
                 // client rejected the block.  Disconnect the client and any other clients that offered us this block
                 wlog("Failed to push block ${num} (id:${id}), client rejected block sent by peer",
-                     ("num", block_message_to_process.block.block_num())
+                     ("num", block_message_to_process.block().block_num())
                      ("id", block_message_to_process.block_id));
                 
                 disconnect_exception = e;
@@ -4925,9 +4925,9 @@ namespace taiyi { namespace net {
             fc::uint160_t hash_of_message_contents;
             if( item_to_broadcast.msg_type == taiyi::net::block_message_type )
             {
-                taiyi::net::block_message block_message_to_broadcast = item_to_broadcast.as<taiyi::net::block_message>();
-                hash_of_message_contents = block_message_to_broadcast.block_id; // for debugging
-                _most_recent_blocks_accepted.push_back( block_message_to_broadcast.block_id );
+                block_id_type block_id_to_broadcast = block_message::read_block_id(item_to_broadcast);
+                hash_of_message_contents = block_id_to_broadcast; // for debugging
+                _most_recent_blocks_accepted.push_back( block_id_to_broadcast );
             }
             else if( item_to_broadcast.msg_type == taiyi::net::trx_message_type )
             {
@@ -12,6 +12,7 @@
 #include <chain/util/uint256.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/contract_worker.hpp>
 
 #include <fc/git_revision.hpp>
@@ -36,7 +37,7 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         public:
             baiyujing_api_impl() : _chain( appbase::app().get_plugin< taiyi::plugins::chain::chain_plugin >() ), _db( _chain.db() )
             {
-                _on_post_apply_block_conn = _db.add_post_apply_block_handler([&]( const block_notification& note ) { on_post_apply_block( note.block ); }, appbase::app().get_plugin<taiyi::plugins::baiyujing_api::baiyujing_api_plugin>(), 0);
+                _on_post_apply_block_conn = _db.add_post_apply_block_handler([&]( const block_notification& note ) { on_post_apply_block( note ); }, appbase::app().get_plugin<taiyi::plugins::baiyujing_api::baiyujing_api_plugin>(), 0);
             }
 
             DECLARE_API_IMPL(
@@ -109,7 +110,7 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
                 (get_contract_source_code)
             )
             
-            void on_post_apply_block( const signed_block& b );
+            void on_post_apply_block( const block_notification& note );
             
             taiyi::plugins::chain::chain_plugin&                              _chain;
             chain::database&                                                  _db;
@@ -857,7 +858,8 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
             api_eval_action_return result;
             contract_worker worker;
 
-            LuaContext context;
+            pooled_lua_context pooled_context;
+            LuaContext& context = *pooled_context;
             _db.initialize_VM_baseENV(context);
             
             long long vm_drops = 100000000;
@@ -887,7 +889,8 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
             api_eval_action_return result;
             contract_worker worker;
 
-            LuaContext context;
+            pooled_lua_context pooled_context;
+            LuaContext& context = *pooled_context;
             _db.initialize_VM_baseENV(context);
             
             long long vm_drops = 100000000;
@@ -1006,8 +1009,9 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
 
         DEFINE_API_IMPL( baiyujing_api_impl, find_way_to_zone )
         {
-            CHECK_ARG_SIZE( 2 )
-            return _database_api->find_way_to_zone( { args[0].as< string >(), args[1].as< string >() } );
+            FC_ASSERT( args.size() == 2 || args.size() == 3, "Expected 2-3 arguments, was ${n}", ("n", args.size()) );
+            bool weighted = args.size() == 3 ? args[2].as< bool >() : false;
+            return _database_api->find_way_to_zone( { args[0].as< string >(), args[1].as< string >(), weighted } );
         }
 
         DEFINE_API_IMPL( baiyujing_api_impl, get_tiandao_properties )
@@ -1035,16 +1039,16 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
 #endif
         }
 
-        void baiyujing_api_impl::on_post_apply_block( const signed_block& b )
+        void baiyujing_api_impl::on_post_apply_block( const block_notification& note )
         { try {
             boost::lock_guard< boost::mutex > guard( _mtx );
-            int32_t block_num = int32_t(b.block_num());
+            int32_t block_num = int32_t(note.block_num);
             if( _callbacks.size() )
             {
-                for( size_t trx_num = 0; trx_num < b.transactions.size(); ++trx_num )
+                const auto& trx_ids = note.state.get_transaction_ids();
+                for( size_t trx_num = 0; trx_num < trx_ids.size(); ++trx_num )
                 {
-                    const auto& trx = b.transactions[trx_num];
-                    auto id = trx.id();
+                    const auto& id = trx_ids[trx_num];
                     auto itr = _callbacks.find( id );
                     if( itr == _callbacks.end() ) continue;
                     itr->second( broadcast_transaction_synchronous_return( id, block_num, int32_t( trx_num ), false ) );
@@ -1058,7 +1062,7 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
                 auto exp_it = _callback_expirations.begin();
                 if( exp_it == _callback_expirations.end() )
                     break;
-                if( exp_it->first >= b.timestamp )
+                if( exp_it->first >= note.block.timestamp )
                     break;
                 for( const transaction_id_type& txid : exp_it->second )
                 {
@@ -43,7 +43,7 @@ namespace taiyi { namespace plugins { namespace chain {
     };
 
     typedef fc::static_variant<
-        const signed_block*,
+        const block_state_ptr*,
         const signed_transaction*,
         generate_block_request*
     > write_request_ptr;
@@ -84,8 +84,14 @@ namespace taiyi { namespace plugins { namespace chain {
             bool                             dump_memory_details = false;
             bool                             benchmark_is_enabled = false;
             uint32_t                         stop_replay_at = 0;
+            fc::optional< bfs::path >        load_snapshot_dir;
+            fc::optional< bfs::path >        dump_snapshot_dir;
             uint32_t                         benchmark_interval = 0;
             uint32_t                         flush_interval = 0;
+            bool                             async_flush = false;
+            uint32_t                         signature_recovery_threads = 1;
+            uint32_t                         replay_prefetch_threads = 2;
+            bool                             compress_block_log = false;
             bool                             replay_in_memory = false;
             std::vector< std::string >       replay_memory_indices{};
             flat_map<uint32_t,block_id_type> loaded_checkpoints;
@@ -117,7 +123,7 @@ namespace taiyi { namespace plugins { namespace chain {
             
             typedef bool result_type;
             
-            bool operator()( const signed_block* block )
+            bool operator()( const block_state_ptr* block )
             {
                 bool result = false;
                 
@@ -305,13 +311,19 @@ namespace taiyi { namespace plugins { namespace chain {
             ("state-storage-dir", bpo::value<bfs::path>()->default_value("blockchain"), "the location of the chain state memory or database files (absolute path or relative to application data dir)")
             ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
             ("flush-state-interval", bpo::value<uint32_t>(), "flush state changes to disk every N blocks")
+            ("flush-state-async", bpo::value<bool>()->default_value(false), "run the periodic state flush on a background thread after block application (the flush still holds the write lock, and while transactions are pending it runs at the end of the next block)")
+            ("signature-recovery-threads", bpo::value<uint32_t>(), "Number of threads recovering transaction signatures of a block before it is applied (0 uses every CPU core, 1 disables)")
             ("memory-replay-indices", bpo::value<vector<string>>()->multitoken()->composing(), "Specify which indices should be in memory during replay")
+            ("replay-prefetch-threads", bpo::value<uint32_t>()->default_value(2), "Number of threads reading and deserializing blocks ahead of block application during replay (0 disables)")
+            ("block-log-compression", bpo::value<bool>()->default_value(false), "create new block logs in the compressed format (existing logs keep their format, see convert_block_log)")
             ;
         cli.add_options()
             ("replay-blockchain", bpo::bool_switch()->default_value(false), "clear chain database and replay all blocks" )
             ("force-open", bpo::bool_switch()->default_value(false), "force open the database, skipping the environment check" )
             ("resync-blockchain", bpo::bool_switch()->default_value(false), "clear chain database and block log" )
             ("stop-replay-at-block", bpo::value<uint32_t>(), "Stop and exit after reaching given block number")
+            ("load-snapshot", bpo::value<bfs::path>(), "clear chain database and load the state snapshot in the given directory (the block log must contain the snapshot head block)" )
+            ("dump-snapshot", bpo::value<bfs::path>(), "write a state snapshot to the given directory after opening or replaying (see stop-replay-at-block) and exit" )
             ("advanced-benchmark", "Make profiling for every plugin.")
             ("set-benchmark-interval", bpo::value<uint32_t>(), "Print time and memory usage every given number of blocks")
             ("dump-memory-details", bpo::bool_switch()->default_value(false), "Dump database objects memory usage info. Use set-benchmark-interval to set dump interval.")
@@ -342,6 +354,16 @@ namespace taiyi { namespace plugins { namespace chain {
         my->replay              = options.at( "replay-blockchain").as<bool>();
         my->resync              = options.at( "resync-blockchain").as<bool>();
         my->stop_replay_at      = options.count( "stop-replay-at-block" ) ? options.at( "stop-replay-at-block" ).as<uint32_t>() : 0;
+        
+        auto snapshot_dir = [&]( const char* name ) -> fc::optional< bfs::path > {
+            if( !options.count( name ) )
+                return fc::optional< bfs::path >();
+            auto dir = options.at( name ).as< bfs::path >();
+            return dir.is_relative() ? app().data_dir() / dir : dir;
+        };
+        my->load_snapshot_dir   = snapshot_dir( "load-snapshot" );
+        my->dump_snapshot_dir   = snapshot_dir( "dump-snapshot" );
+        FC_ASSERT( !( my->load_snapshot_dir.valid() && my->replay ), "load-snapshot cannot be combined with replay-blockchain" );
         my->benchmark_interval  = options.count( "set-benchmark-interval" ) ? options.at( "set-benchmark-interval" ).as<uint32_t>() : 0;
         my->check_locks         = options.at( "check-locks" ).as< bool >();
         my->validate_invariants = options.at( "validate-database-invariants" ).as<bool>();
@@ -350,6 +372,15 @@ namespace taiyi { namespace plugins { namespace chain {
             my->flush_interval = options.at( "flush-state-interval" ).as<uint32_t>();
         else
             my->flush_interval = 10000;
+        my->async_flush = options.at( "flush-state-async" ).as<bool>();
+        if( options.count( "signature-recovery-threads" ) )
+            my->signature_recovery_threads = options.at( "signature-recovery-threads" ).as<uint32_t>();
+        else
+            my->signature_recovery_threads = 0;
+        if( my->signature_recovery_threads == 0 )
+            my->signature_recovery_threads = std::max( 1u, std::thread::hardware_concurrency() );
+        my->replay_prefetch_threads = options.at( "replay-prefetch-threads" ).as<uint32_t>();
+        my->compress_block_log = options.at( "block-log-compression" ).as<bool>();
 
         if(options.count("checkpoint"))
         {
@@ -414,6 +445,7 @@ namespace taiyi { namespace plugins { namespace chain {
         }
         
         my->db.set_flush_interval( my->flush_interval );
+        my->db.set_signature_recovery_threads( my->signature_recovery_threads );
         my->db.add_checkpoints( my->loaded_checkpoints );
         my->db.set_require_locking( my->check_locks );
         
@@ -462,6 +494,36 @@ namespace taiyi { namespace plugins { namespace chain {
         db_open_args.database_cfg = database_config;
         db_open_args.replay_in_memory = my->replay_in_memory;
         db_open_args.replay_memory_indices = my->replay_memory_indices;
+        db_open_args.replay_prefetch_threads = my->replay_prefetch_threads;
+        db_open_args.compress_block_log = my->compress_block_log;
+        
+        if( my->load_snapshot_dir.valid() )
+        {
+            wlog( "snapshot load requested: deleting state memory" );
+            my->db.wipe( app().data_dir() / "blockchain", my->state_storage_dir, false );
+            db_open_args.load_snapshot_dir = fc::path( *my->load_snapshot_dir );
+        }
+        
+        auto dump_snapshot_and_exit = [this]() {
+            if( !my->dump_snapshot_dir.valid() )
+                return;
+            
+            try
+            {
+                my->db.with_read_lock( [&]() {
+                    my->db.export_snapshot( fc::path( *my->dump_snapshot_dir ) );
+                });
+                ilog( "Wrote state snapshot at block ${n} to ${d}.", ("n", my->db.head_block_num())("d", my->dump_snapshot_dir->generic_string()) );
+                my->db.close();
+            }
+            catch( const fc::exception& e )
+            {
+                elog( "Error writing state snapshot: ${e}", ("e", e.to_detail_string()) );
+                exit( EXIT_FAILURE );
+            }
+            
+            exit( EXIT_SUCCESS );
+        };
 
         auto benchmark_lambda = [&dumper, &get_indexes_memory_details, dump_memory_details] ( uint32_t current_block_number, const chainbase::database::abstract_index_cntr_t& abstract_index_cntr ) {
             if( current_block_number == 0 ) // initial call
@@ -499,6 +561,8 @@ namespace taiyi { namespace plugins { namespace chain {
                 ilog( "Performance report (total). Blocks: ${b}. Elapsed time: ${rt} ms (real), ${ct} ms (cpu). Memory usage: ${cm} (current), ${pm} (peak) kilobytes.", ("b", total_data.block_number)("rt", total_data.real_ms)("ct", total_data.cpu_ms)("cm", total_data.current_mem)("pm", total_data.peak_mem) );
             }
             
+            dump_snapshot_and_exit();
+            
             if( my->stop_replay_at > 0 && my->stop_replay_at == last_block_number )
             {
                 ilog("Stopped blockchain replaying on user request. Last applied block number: ${n}.", ("n", last_block_number));
@@ -526,11 +590,15 @@ namespace taiyi { namespace plugins { namespace chain {
                 wlog( " Error: ${e}", ("e", e) );
                 exit(EXIT_FAILURE);
             }
+            
+            dump_snapshot_and_exit();
         }
         
         ilog( "Started on blockchain with ${n} blocks", ("n", my->db.head_block_num()) );
         on_sync();
         
+        // From here on every state write goes through the write queue under the write lock
+        my->db.set_async_flush( my->async_flush );
         my->start_write_processing();
     }
 
@@ -550,6 +618,13 @@ namespace taiyi { namespace plugins { namespace chain {
 
     bool chain_plugin::accept_block( const taiyi::chain::signed_block& block, bool currently_syncing, uint32_t skip )
     {
+        //在调用线程里完成块的哈希和序列化，写线程只负责应用
+        return accept_block( block_state::create( block ), currently_syncing, skip );
+    }
+
+    bool chain_plugin::accept_block( const block_state_ptr& state, bool currently_syncing, uint32_t skip )
+    {
+        const auto& block = state->get_block();
         if (currently_syncing && block.block_num() % 10000 == 0) {
             ilog("Syncing Blockchain --- Got block: #${n} time: ${t} producer: ${p}", ("t", block.timestamp)("n", block.block_num())("p", block.siming) );
         }
@@ -558,7 +633,7 @@ namespace taiyi { namespace plugins { namespace chain {
         
         boost::promise< void > prom;
         write_context cxt;
-        cxt.req_ptr = &block;
+        cxt.req_ptr = &state;
         cxt.skip = skip;
         cxt.prom_ptr = &prom;
         
@@ -38,6 +38,7 @@ namespace taiyi { namespace plugins { namespace chain {
         void report_state_options( const string& plugin_name, const fc::variant_object& opts );
         
         bool accept_block( const taiyi::chain::signed_block& block, bool currently_syncing, uint32_t skip );
+        bool accept_block( const taiyi::chain::block_state_ptr& block, bool currently_syncing, uint32_t skip );
         void accept_transaction( const taiyi::chain::signed_transaction& trx );
      
         taiyi::chain::signed_block generate_block( const fc::time_point_sec when, const account_name_type& siming_owner, const fc::ecc::private_key& block_signing_private_key, uint32_t skip = database::skip_nothing );
@@ -13,6 +13,7 @@ namespace taiyi { namespace plugins { namespace chain {
             DECLARE_API_IMPL(
                 (push_block)
                 (push_transaction)
+                (get_flush_stats)
             )
             
         private:
@@ -72,6 +73,11 @@ namespace taiyi { namespace plugins { namespace chain {
             
             return result;
         }
+        
+        DEFINE_API_IMPL( chain_api_impl, get_flush_stats )
+        {
+            return _chain.db().get_flush_stats();
+        }
 
     } // detail
 
@@ -85,6 +91,7 @@ namespace taiyi { namespace plugins { namespace chain {
     DEFINE_LOCKLESS_APIS( chain_api,
         (push_block)
         (push_transaction)
+        (get_flush_stats)
     )
 
 } } } //taiyi::plugins::chain
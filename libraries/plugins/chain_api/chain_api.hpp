@@ -1,6 +1,8 @@
 #pragma once
 #include <plugins/json_rpc/utility.hpp>
 
+#include <chain/database.hpp>
+
 #include <protocol/types.hpp>
 
 #include <fc/optional.hpp>
@@ -28,6 +30,9 @@ namespace taiyi { namespace plugins { namespace chain {
         bool              success;
         optional<string>  error;
     };
+    
+    typedef json_rpc::void_type get_flush_stats_args;
+    typedef taiyi::chain::database::flush_stats get_flush_stats_return;
 
     class chain_api
     {
@@ -38,6 +43,7 @@ namespace taiyi { namespace plugins { namespace chain {
         DECLARE_API(
             (push_block)
             (push_transaction)
+            (get_flush_stats)
         )
         
     private:
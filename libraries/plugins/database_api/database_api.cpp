@@ -68,6 +68,7 @@ namespace taiyi { namespace plugins { namespace database_api {
             (find_way_to_zone)
                          
             (get_tiandao_properties)
+            (get_population_stats)
         )
 
         template< typename ResultType >
@@ -1285,29 +1286,6 @@ namespace taiyi { namespace plugins { namespace database_api {
         return result;
     }
     
-    //pre_from 用于避免相邻节点的循环通路
-    bool is_connect(chain::zone_id_type from, chain::zone_id_type dest, chain::zone_id_type pre_from, int depth, const mira::index_adapter< chain::zone_connect_index, chain::by_zone_from >& zone_connect_by_from_idx, std::vector<string>& way_points, chain::database& db) {
-        if(depth > 10)
-            return false;
-        auto itz = zone_connect_by_from_idx.lower_bound( from );
-        while(itz != zone_connect_by_from_idx.end()) {
-            if(itz->from != from)
-                break;
-            if(itz->to != pre_from) {
-                if(itz->to == dest) {
-                    way_points.push_back(db.get< chain::zone_object, chain::by_id >(dest).name);
-                    return true;
-                }
-                if(is_connect(itz->to, dest, from, depth+1, zone_connect_by_from_idx, way_points, db)) {
-                    way_points.insert(way_points.begin(), db.get< chain::zone_object, chain::by_id >(itz->to).name);
-                    return true;
-                }
-            }
-            itz++;
-        }
-        return false;
-    }
-
     DEFINE_API_IMPL( database_api_impl, find_way_to_zone )
     {
         const auto* from_zone = _db.find< chain::zone_object, chain::by_name >( args.from_zone );
@@ -1316,21 +1294,9 @@ namespace taiyi { namespace plugins { namespace database_api {
         FC_ASSERT( to_zone != nullptr );
 
         find_way_to_zone_return result;
-        const auto& zone_connect_by_from_idx = _db.get_index< zone_connect_index >().indices().get< chain::by_zone_from >();
-        auto itz = zone_connect_by_from_idx.lower_bound( from_zone->id );
-        while(itz != zone_connect_by_from_idx.end()) {
-            if(itz->from != from_zone->id)
-                break;
-            if(itz->to == to_zone->id) {
-                result.way_points.push_back(to_zone->name);
-                break;
-            }
-            if(is_connect(itz->to, to_zone->id, from_zone->id, 1, zone_connect_by_from_idx, result.way_points, _db)) {
-                result.way_points.insert(result.way_points.begin(), _db.get< chain::zone_object, chain::by_id >(itz->to).name);
-                break;
-            }
-            itz++;
-        }
+        auto route = _db.find_zone_route( *from_zone, *to_zone, args.weighted );
+        for( const auto& zone : route )
+            result.way_points.push_back( _db.get< chain::zone_object, chain::by_id >( zone ).name );
         return result;
     }
     
@@ -1338,10 +1304,26 @@ namespace taiyi { namespace plugins { namespace database_api {
     {
        return _db.get_tiandao_properties();
     }
+    
+    DEFINE_API_IMPL( database_api_impl, get_population_stats )
+    {
+        if( args.zone.empty() )
+            return _db.get_population_stats();
+        
+        const auto& zone = _db.get_zone( args.zone );
+        const auto* stats = _db.find_population_stats( zone.id );
+        if( stats != nullptr )
+            return *stats;
+        
+        //还没有角色到过的区域
+        get_population_stats_return result;
+        result.zone = zone.id;
+        return result;
+    }
 
     DEFINE_LOCKLESS_APIS( database_api, (get_config)(get_version) )
     
-    DEFINE_READ_APIS( database_api,
+    DEFINE_CACHED_READ_APIS( database_api,
         (get_dynamic_global_properties)
         (get_siming_schedule)
         (get_hardfork_properties)
@@ -1366,12 +1348,6 @@ namespace taiyi { namespace plugins { namespace database_api {
         (find_qi_delegation_expirations)
         (list_decline_adoring_rights_requests)
         (find_decline_adoring_rights_requests)
-        (get_transaction_hex)
-        (get_required_signatures)
-        (get_potential_signatures)
-        (verify_authority)
-        (verify_account_authority)
-        (verify_signatures)
         (find_account_resources)
         (find_nfa)
         (find_nfas)
@@ -1386,6 +1362,17 @@ namespace taiyi { namespace plugins { namespace database_api {
         (find_way_to_zone)
                      
         (get_tiandao_properties)
+        (get_population_stats)
+    )
+    
+    //交易和签名的检查结果由请求本身决定，不进结果缓存
+    DEFINE_READ_APIS( database_api,
+        (get_transaction_hex)
+        (get_required_signatures)
+        (get_potential_signatures)
+        (verify_authority)
+        (verify_account_authority)
+        (verify_signatures)
     )
     
 } } } // taiyi::plugins::database_api
@@ -140,6 +140,7 @@ namespace taiyi { namespace plugins { namespace database_api {
             (find_way_to_zone)
                     
             (get_tiandao_properties)
+            (get_population_stats)
         )
         
     private:
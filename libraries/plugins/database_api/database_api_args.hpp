@@ -103,6 +103,14 @@ namespace taiyi { namespace plugins { namespace database_api {
     typedef void_type                            get_tiandao_properties_args;
     typedef api_tiandao_property_object          get_tiandao_properties_return;
     
+    /* get_population_stats */
+    
+    struct get_population_stats_args
+    {
+        string zone; ///区域名，为空时返回全世界的人口统计
+    };
+    typedef api_population_stats_object          get_population_stats_return;
+    
     /* get_siming_schedule */
     
     typedef void_type                   get_siming_schedule_args;
@@ -442,6 +450,7 @@ namespace taiyi { namespace plugins { namespace database_api {
     {
         string from_zone;
         string to_zone;
+        bool   weighted = false;   ///为真时按移动天数最少寻路，否则按经过的区域最少
     };
     struct find_way_to_zone_return
     {
@@ -539,5 +548,7 @@ FC_REFLECT( taiyi::plugins::database_api::find_zones_args, (ids) )
 FC_REFLECT( taiyi::plugins::database_api::list_zones_return, (result) )
 FC_REFLECT( taiyi::plugins::database_api::find_zones_by_name_args, (name_list) )
 
-FC_REFLECT( taiyi::plugins::database_api::find_way_to_zone_args, (from_zone)(to_zone) )
+FC_REFLECT( taiyi::plugins::database_api::find_way_to_zone_args, (from_zone)(to_zone)(weighted) )
 FC_REFLECT( taiyi::plugins::database_api::find_way_to_zone_return, (way_points) )
+
+FC_REFLECT( taiyi::plugins::database_api::get_population_stats_args, (zone) )
@@ -6,6 +6,7 @@
 #include <chain/transaction_object.hpp>
 #include <chain/siming_objects.hpp>
 #include <chain/tiandao_property_object.hpp>
+#include <chain/population_stats_object.hpp>
 #include <chain/account_object.hpp>
 #include <chain/nfa_objects.hpp>
 #include <chain/actor_objects.hpp>
@@ -27,6 +28,7 @@ namespace taiyi { namespace plugins { namespace database_api {
     typedef reward_fund_object                      api_reward_fund_object;
     typedef actor_talent_rule_object                api_actor_talent_rule_object;
     typedef tiandao_property_object                 api_tiandao_property_object;
+    typedef population_stats_object                 api_population_stats_object;
     typedef zone_object                             api_zone_object;
 
     struct api_account_object
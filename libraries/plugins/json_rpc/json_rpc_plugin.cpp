@@ -401,6 +401,7 @@ namespace taiyi { namespace plugins { namespace json_rpc {
     {
         cfg.add_options()
             ("log-json-rpc", bpo::value< string >(), "json-rpc log directory name.")
+            ("api-read-result-cache", bpo::value< bool >()->default_value( false ), "Reuse results of identical cacheable read API calls until the next database write, without taking the read lock.")
         ;
     }
 
@@ -408,6 +409,8 @@ namespace taiyi { namespace plugins { namespace json_rpc {
     {
         my->initialize();
         
+        read_result_cache_enabled() = options.at( "api-read-result-cache" ).as< bool >();
+        
         if( options.count( "log-json-rpc" ) )
         {
             auto dir_name = options.at( "log-json-rpc" ).as< string >();
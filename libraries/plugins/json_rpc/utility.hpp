@@ -1,9 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <type_traits>
 
 #include <fc/reflect/reflect.hpp>
 #include <fc/macros.hpp>
+#include <fc/io/json.hpp>
 
 #include <boost/preprocessor/seq/for_each.hpp>
 #include <boost/preprocessor/cat.hpp>
@@ -42,6 +46,88 @@ BOOST_PP_SEQ_FOR_EACH( DECLARE_API_IMPL_HELPER, _, METHODS )
 #define DEFINE_API_IMPL( class, method )                                                        \
 BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args )   \
 
+namespace taiyi { namespace plugins { namespace json_rpc {
+
+    /**
+     * When enabled, read APIs defined with DEFINE_CACHED_READ_APIS reuse the result of an identical
+     * earlier call while the database write generation is unchanged, skipping the read lock. This is a
+     * result cache, not a snapshot read: a miss still reads the live state under the read lock, and any
+     * write invalidates every cached result. APIs whose result depends on anything but the chain state
+     * and the arguments (such as wall-clock time) must use DEFINE_READ_APIS instead.
+     */
+    inline std::atomic< bool >& read_result_cache_enabled()
+    {
+        static std::atomic< bool > enabled( false );
+        return enabled;
+    }
+
+    namespace detail {
+
+        template< typename Return >
+        class read_result_cache
+        {
+        public:
+            template< typename Database, typename Args, typename Lambda >
+            Return get_or_read( Database& db, const Args& args, Lambda&& read )
+            {
+                std::string key = fc::json::to_string( args );
+                Return result;
+                if( find( &db, db.write_generation(), key, result ) )
+                    return result;
+
+                uint64_t generation = 0;
+                result = db.with_read_lock( [&]() {
+                    generation = db.write_generation();
+                    return read();
+                });
+                store( &db, generation, key, result );
+                return result;
+            }
+
+        private:
+            bool find( const void* db, uint64_t generation, const std::string& key, Return& result )
+            {
+                std::lock_guard< std::mutex > guard( _mutex );
+                if( db != _db || generation != _generation )
+                    return false;
+
+                auto itr = _results.find( key );
+                if( itr == _results.end() )
+                    return false;
+
+                result = itr->second;
+                return true;
+            }
+
+            void store( const void* db, uint64_t generation, const std::string& key, const Return& result )
+            {
+                std::lock_guard< std::mutex > guard( _mutex );
+                if( db == _db && generation < _generation )
+                    return;
+
+                if( db != _db || generation > _generation )
+                {
+                    _results.clear();
+                    _db = db;
+                    _generation = generation;
+                }
+
+                if( _results.size() < max_results )
+                    _results.emplace( key, result );
+            }
+
+            static const size_t                 max_results = 64;
+
+            std::mutex                          _mutex;
+            const void*                         _db = nullptr;
+            uint64_t                            _generation = 0;
+            std::map< std::string, Return >     _results;
+        };
+
+    } // detail
+
+} } } // taiyi::plugins::json_rpc
+
 #define DEFINE_READ_API_HELPER( r, class, method )                                                       \
 BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
 {                                                                                                        \
@@ -55,6 +141,24 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
    }                                                                                                     \
 }
 
+#define DEFINE_CACHED_READ_API_HELPER( r, class, method )                                                \
+BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
+{                                                                                                        \
+   if( lock )                                                                                            \
+   {                                                                                                     \
+      if( taiyi::plugins::json_rpc::read_result_cache_enabled() )                                        \
+      {                                                                                                  \
+         static taiyi::plugins::json_rpc::detail::read_result_cache< BOOST_PP_CAT( method, _return ) > results; \
+         return results.get_or_read( my->_db, args, [&args, this](){ return my->method( args ); });    \
+      }                                                                                                  \
+      return my->_db.with_read_lock( [&args, this](){ return my->method( args ); });                     \
+   }                                                                                                     \
+   else                                                                                                  \
+   {                                                                                                     \
+      return my->method( args );                                                                         \
+   }                                                                                                     \
+}
+
 #define DEFINE_WRITE_API_HELPER( r, class, method )                                                      \
 BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
 {                                                                                                        \
@@ -78,6 +182,9 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
 #define DEFINE_READ_APIS( class, METHODS ) \
    BOOST_PP_SEQ_FOR_EACH( DEFINE_READ_API_HELPER, class, METHODS )
 
+#define DEFINE_CACHED_READ_APIS( class, METHODS ) \
+   BOOST_PP_SEQ_FOR_EACH( DEFINE_CACHED_READ_API_HELPER, class, METHODS )
+
 #define DEFINE_WRITE_APIS( class, METHODS ) \
    BOOST_PP_SEQ_FOR_EACH( DEFINE_WRITE_API_HELPER, class, METHODS )
 
@@ -181,13 +181,13 @@ namespace taiyi { namespace plugins { namespace p2p {
                 if (sync_mode)
                     fc_ilog(fc::logger::get("sync"),
                             "chain pushing sync block #${block_num} ${block_hash}, head is ${head}",
-                            ("block_num", blk_msg.block.block_num())
+                            ("block_num", blk_msg.block().block_num())
                             ("block_hash", blk_msg.block_id)
                             ("head", head_block_num));
                 else
                     fc_ilog(fc::logger::get("sync"),
                             "chain pushing block #${block_num} ${block_hash}, head is ${head}",
-                            ("block_num", blk_msg.block.block_num())
+                            ("block_num", blk_msg.block().block_num())
                             ("block_hash", blk_msg.block_id)
                             ("head", head_block_num));
                 
@@ -196,15 +196,16 @@ namespace taiyi { namespace plugins { namespace p2p {
                     // you can help the network code out by throwing a block_older_than_undo_history exception.
                     // when the net code sees that, it will stop trying to push blocks from that chain, but
                     // leave that peer connected so that they can get sync blocks from us
-                    bool result = chain.accept_block( blk_msg.block, sync_mode, ( block_producer | force_validate ) ? chain::database::skip_nothing : chain::database::skip_transaction_signatures );
+                    //网络层解包时已建好块状态（含原始打包字节），分叉库、块应用、通知和块日志共用这一份
+                    bool result = chain.accept_block( blk_msg.state, sync_mode, ( block_producer | force_validate ) ? chain::database::skip_nothing : chain::database::skip_transaction_signatures );
                     
                     if( !sync_mode )
                     {
-                        fc::microseconds offset = fc::time_point::now() - blk_msg.block.timestamp;
+                        fc::microseconds offset = fc::time_point::now() - blk_msg.block().timestamp;
                         ilog( "Got ${t} transactions on block ${b} by ${w} -- Block Time Offset: ${l} ms",
-                             ("t", blk_msg.block.transactions.size())
-                             ("b", blk_msg.block.block_num())
-                             ("w", blk_msg.block.siming)
+                             ("t", blk_msg.block().transactions.size())
+                             ("b", blk_msg.block().block_num())
+                             ("w", blk_msg.block().siming)
                              ("l", offset.count() / 1000) );
                     }
                     
@@ -332,12 +333,12 @@ namespace taiyi { namespace plugins { namespace p2p {
             {
                 return chain.db().with_read_lock( [&]()
                                                  {
-                    auto opt_block = chain.db().fetch_block_by_id(id.item_hash);
-                    if( !opt_block )
+                    auto state = chain.db().fetch_block_state_by_id(id.item_hash);
+                    if( !state )
                         elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}", ("id", id.item_hash)("id2", chain.db().get_block_id_for_num(block_header::num_from_id(id.item_hash))));
-                    FC_ASSERT( opt_block.valid() );
-                    // ilog("Serving up block #${num}", ("num", opt_block->block_num()));
-                    return block_message(std::move(*opt_block));
+                    FC_ASSERT( state );
+                    // ilog("Serving up block #${num}", ("num", state->get_block_num()));
+                    return block_message(std::move(state));
                 });
             }
             return chain.db().with_read_lock( [&]()
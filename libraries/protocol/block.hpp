@@ -7,6 +7,7 @@ namespace taiyi { namespace protocol {
     struct signed_block : public signed_block_header
     {
         checksum_type calculate_merkle_root()const;
+        static checksum_type calculate_merkle_root( vector<digest_type> merkle_digests );
         vector<signed_transaction> transactions;
     };
 
@@ -0,0 +1,40 @@
+#include <protocol/block_state.hpp>
+
+#include <fc/io/raw.hpp>
+
+namespace taiyi { namespace protocol {
+
+    block_state_ptr block_state::create( signed_block b )
+    {
+        auto packed = fc::raw::pack_to_vector( b );
+        return block_state_ptr( new block_state( std::move( b ), std::move( packed ) ) );
+    }
+
+    block_state_ptr block_state::create( signed_block b, std::vector< char > packed )
+    {
+        return block_state_ptr( new block_state( std::move( b ), std::move( packed ) ) );
+    }
+
+    block_state::block_state( signed_block b, std::vector< char > packed )
+    : _block( std::move( b ) ), _packed( std::move( packed ) )
+    {
+        _id = _block.id();
+        _block_num = _block.block_num();
+        _digest = _block.digest();
+
+        _trx_ids.reserve( _block.transactions.size() );
+        _trx_digests.reserve( _block.transactions.size() );
+        for( const auto& trx : _block.transactions )
+        {
+            _trx_ids.push_back( trx.id() );
+            _trx_digests.push_back( trx.merkle_digest() );
+        }
+        _merkle_root = signed_block::calculate_merkle_root( _trx_digests );
+    }
+
+    bool block_state::validate_signee( const fc::ecc::public_key& expected_signee, fc::ecc::canonical_signature_type canon_type )const
+    {
+        return fc::ecc::public_key( _block.siming_signature, _digest, canon_type ) == expected_signee;
+    }
+
+} } // taiyi::protocol
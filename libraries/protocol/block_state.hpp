@@ -0,0 +1,49 @@
+#pragma once
+#include <protocol/block.hpp>
+
+#include <memory>
+
+namespace taiyi { namespace protocol {
+
+    class block_state;
+    typedef std::shared_ptr< const block_state > block_state_ptr;
+
+    /**
+     * 不可变的已签名块，连同它的打包字节、块id、头摘要、交易默克尔根以及每个交易的id和默克尔摘要。
+     * 这些派生数据在创建时一次算好，之后分叉库、块应用、通知和网络层都共享同一份，不再重复哈希和序列化。
+     * 从网络收到的块保留对方发来的原始打包字节，转发和写块日志时直接使用。
+     * 创建可以在任意线程进行，建议放在写线程之外。
+     */
+    class block_state
+    {
+    public:
+        static block_state_ptr create( signed_block b );
+        /// 调用方已有块的打包字节时（比如从块日志或网络消息读出）直接复用，省去一次序列化
+        static block_state_ptr create( signed_block b, std::vector< char > packed );
+
+        const signed_block&                         get_block()const { return _block; }
+        const block_id_type&                        get_id()const { return _id; }
+        uint32_t                                    get_block_num()const { return _block_num; }
+        const digest_type&                          get_digest()const { return _digest; }
+        const checksum_type&                        get_merkle_root()const { return _merkle_root; }
+        const std::vector< char >&                  get_packed()const { return _packed; }
+        const std::vector< transaction_id_type >&   get_transaction_ids()const { return _trx_ids; }
+        const std::vector< digest_type >&           get_transaction_digests()const { return _trx_digests; }
+
+        /// 用缓存的头摘要恢复签名公钥，等价于 signed_block_header::validate_signee
+        bool validate_signee( const fc::ecc::public_key& expected_signee, fc::ecc::canonical_signature_type canon_type = fc::ecc::bip_0062 )const;
+
+    private:
+        block_state( signed_block b, std::vector< char > packed );
+
+        const signed_block                  _block;
+        const std::vector< char >           _packed;
+        block_id_type                       _id;
+        uint32_t                            _block_num = 0;
+        digest_type                         _digest;
+        checksum_type                       _merkle_root;
+        std::vector< transaction_id_type >  _trx_ids;
+        std::vector< digest_type >          _trx_digests;
+    };
+
+} } // taiyi::protocol
@@ -7,7 +7,7 @@
 
 #ifdef IS_TEST_NET
 
-#define TAIYI_BLOCKCHAIN_VERSION                ( version(0, 0, 0) )
+#define TAIYI_BLOCKCHAIN_VERSION                ( version(0, 1, 0) )
 
 #define TAIYI_INIT_PRIVATE_KEY                  (fc::ecc::private_key::regenerate(fc::sha256::hash(std::string("init_key"))))
 #define TAIYI_INIT_PUBLIC_KEY_STR               (std::string( taiyi::protocol::public_key_type(TAIYI_INIT_PRIVATE_KEY.get_public_key()) ))
@@ -32,7 +32,7 @@
 
 #else // IS LIVE TAIYI NETWORK
 
-#define TAIYI_BLOCKCHAIN_VERSION                ( version(0, 0, 0) )
+#define TAIYI_BLOCKCHAIN_VERSION                ( version(0, 1, 0) )
 
 #define TAIYI_INIT_PUBLIC_KEY_STR               "TAI8HpgpX6nXnqJcZCcUwDQpFeorz4ZHMegQA5Be4K88wzRSnxjeo"
 #define TAIYI_CHAIN_ID                          fc::sha256()
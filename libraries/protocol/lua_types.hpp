@@ -9,9 +9,8 @@ namespace taiyi { namespace protocol {
     typedef struct lua_##T              \
     {                                   \
         T v;                            \
-        lua_##T(T v)                    \
+        lua_##T(T v) : v(std::move(v))  \
         {                               \
-            this->v = v;                \
         }                               \
         lua_##T() {}                    \
     } lua_##T;
@@ -66,9 +65,8 @@ namespace taiyi { namespace protocol {
     typedef struct lua_table
     {
         lua_map v;
-        lua_table(lua_map v)
+        lua_table(lua_map v) : v(std::move(v))
         {
-            this->v = v;
         }
         lua_table(){};
     } lua_table;
@@ -77,12 +75,12 @@ namespace taiyi { namespace protocol {
     {
         lua_key_variant key;
         lua_key(){};
-        lua_key(lua_types lkey)
+        lua_key(const lua_types& lkey)
         {
             key = cast_from_lua_types(lkey);
         }
         
-        static lua_key_variant cast_from_lua_types(lua_types lt)
+        static lua_key_variant cast_from_lua_types(const lua_types& lt)
         {
             switch (lt.which())
             {
@@ -147,26 +145,20 @@ namespace taiyi { namespace protocol {
                 {
                     case 0:
                     {
-                        LUATYPE_NAME(int)
-                        ad = a.key.get<LUATYPE_NAME(int)>();
-                        LUATYPE_NAME(int)
-                        bd = b.key.get<LUATYPE_NAME(int)>();
+                        const auto& ad = a.key.get<LUATYPE_NAME(int)>();
+                        const auto& bd = b.key.get<LUATYPE_NAME(int)>();
                         return ad.v == bd.v;
                     }
                     case 1:
                     {
-                        LUATYPE_NAME(number)
-                        ad = a.key.get<LUATYPE_NAME(number)>();
-                        LUATYPE_NAME(number)
-                        bd = b.key.get<LUATYPE_NAME(number)>();
+                        const auto& ad = a.key.get<LUATYPE_NAME(number)>();
+                        const auto& bd = b.key.get<LUATYPE_NAME(number)>();
                         return ad.v == bd.v;
                     }
                     case 2:
                     {
-                        LUATYPE_NAME(string)
-                        ad = a.key.get<LUATYPE_NAME(string)>();
-                        LUATYPE_NAME(string)
-                        bd = b.key.get<LUATYPE_NAME(string)>();
+                        const auto& ad = a.key.get<LUATYPE_NAME(string)>();
+                        const auto& bd = b.key.get<LUATYPE_NAME(string)>();
                         return ad.v == bd.v;
                     }
                     default:
@@ -184,26 +176,20 @@ namespace taiyi { namespace protocol {
                 {
                     case 0:
                     {
-                        LUATYPE_NAME(int)
-                        ad = a.key.get<LUATYPE_NAME(int)>();
-                        LUATYPE_NAME(int)
-                        bd = b.key.get<LUATYPE_NAME(int)>();
+                        const auto& ad = a.key.get<LUATYPE_NAME(int)>();
+                        const auto& bd = b.key.get<LUATYPE_NAME(int)>();
                         return ad.v < bd.v;
                     }
                     case 1:
                     {
-                        LUATYPE_NAME(number)
-                        ad = a.key.get<LUATYPE_NAME(number)>();
-                        LUATYPE_NAME(number)
-                        bd = b.key.get<LUATYPE_NAME(number)>();
+                        const auto& ad = a.key.get<LUATYPE_NAME(number)>();
+                        const auto& bd = b.key.get<LUATYPE_NAME(number)>();
                         return ad.v < bd.v;
                     }
                     case 2:
                     {
-                        LUATYPE_NAME(string)
-                        ad = a.key.get<LUATYPE_NAME(string)>();
-                        LUATYPE_NAME(string)
-                        bd = b.key.get<LUATYPE_NAME(string)>();
+                        const auto& ad = a.key.get<LUATYPE_NAME(string)>();
+                        const auto& bd = b.key.get<LUATYPE_NAME(string)>();
                         return ad.v < bd.v;
                     }
                     default:
@@ -0,0 +1,93 @@
+#include <lua.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+//典型合约负载：数值循环、表读写、字符串拼接、函数调用与闭包
+struct bench_script
+{
+    const char* name;
+    const char* code;
+};
+
+static const bench_script scripts[] = {
+    { "arith_loop",
+      "local s = 0 for i = 1, 20000 do s = s + i * 2 - i // 3 end return s" },
+    { "table_rw",
+      "local t = {} for i = 1, 2000 do t[i] = { id = i, v = i * 2 } end "
+      "local s = 0 for k, o in ipairs(t) do if o.v % 3 == 0 then s = s + o.id end end return s" },
+    { "string_concat",
+      "local parts = {} for i = 1, 500 do parts[#parts + 1] = 'n' .. i end return #table.concat(parts, ',')" },
+    { "calls",
+      "local function fib(n) if n < 2 then return n end return fib(n - 1) + fib(n - 2) end return fib(18)" },
+    { "closures",
+      "local fs = {} for i = 1, 500 do fs[i] = function(x) return x + i end end "
+      "local s = 0 for r = 1, 10 do for i = 1, #fs do s = fs[i](s) % 100000 end end return s" },
+};
+
+static int run_script( lua_State* L, const char* code, bool metered, long long& used )
+{
+    const long long budget = 1000000000LL;
+    if( luaL_loadstring( L, code ) != LUA_OK )
+        return -1;
+
+    lua_enabledrops( L, metered ? 1 : 0, 1 );
+    lua_setdrops( L, budget );
+    int status = lua_pcall( L, 0, 1, 0 );
+    used = budget - lua_getdrops( L );
+    lua_enabledrops( L, 0, 1 );
+    lua_settop( L, 0 );
+    return status;
+}
+
+int main( int argc, char** argv, char** envp )
+{
+    int rounds = argc > 1 ? std::atoi( argv[1] ) : 200;
+    if( rounds <= 0 )
+        rounds = 200;
+
+    lua_State* L = luaL_newstate();
+    luaL_openlibs( L );
+    // block metering is only compiled in for pooled states
+    lua_setpooled( L, 1 );
+
+    std::cout << std::left << std::setw( 16 ) << "script"
+              << std::right << std::setw( 14 ) << "drops"
+              << std::setw( 16 ) << "metered(us)"
+              << std::setw( 16 ) << "unmetered(us)"
+              << std::setw( 10 ) << "ratio" << std::endl;
+
+    for( const auto& s : scripts )
+    {
+        double elapsed[2] = { 0, 0 };
+        long long drops = 0;
+        for( int metered = 0; metered < 2; ++metered )
+        {
+            auto start = std::chrono::steady_clock::now();
+            for( int r = 0; r < rounds; ++r )
+            {
+                long long used = 0;
+                if( run_script( L, s.code, metered != 0, used ) != LUA_OK )
+                {
+                    std::cerr << s.name << " failed: " << lua_tostring( L, -1 ) << std::endl;
+                    lua_close( L );
+                    return 1;
+                }
+                if( metered )
+                    drops = used;
+            }
+            elapsed[metered] = std::chrono::duration< double, std::micro >( std::chrono::steady_clock::now() - start ).count() / rounds;
+        }
+
+        std::cout << std::left << std::setw( 16 ) << s.name
+                  << std::right << std::setw( 14 ) << drops
+                  << std::setw( 16 ) << std::fixed << std::setprecision( 1 ) << elapsed[1]
+                  << std::setw( 16 ) << elapsed[0]
+                  << std::setw( 10 ) << std::setprecision( 3 ) << elapsed[1] / elapsed[0] << std::endl;
+    }
+
+    lua_close( L );
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <protocol/lua_types.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+using namespace taiyi::protocol;
+
+//模拟大型游戏合约的数据：排行榜、背包等多层嵌套表
+static lua_map make_contract_data( int entries )
+{
+    lua_map board;
+    for( int i = 0; i < entries; ++i )
+    {
+        lua_map items;
+        for( int j = 0; j < 8; ++j )
+            items[lua_key(lua_int(j))] = lua_types(lua_string("item_" + std::to_string(i * 8 + j)));
+
+        lua_map player;
+        player[lua_key(lua_string("name"))] = lua_types(lua_string("player_" + std::to_string(i)));
+        player[lua_key(lua_string("score"))] = lua_types(lua_int(i * 37 % 10007));
+        player[lua_key(lua_string("ratio"))] = lua_types(lua_number(i / 3.0));
+        player[lua_key(lua_string("online"))] = lua_types(lua_bool(i % 2 == 0));
+        player[lua_key(lua_string("items"))] = lua_types(lua_table(items));
+        board[lua_key(lua_string("account_" + std::to_string(i)))] = lua_types(lua_table(player));
+    }
+
+    lua_map data;
+    data[lua_key(lua_string("board"))] = lua_types(lua_table(board));
+    data[lua_key(lua_string("season"))] = lua_types(lua_int(3));
+    return data;
+}
+
+template< typename Func >
+static double measure( int rounds, Func&& f )
+{
+    auto start = std::chrono::steady_clock::now();
+    for( int r = 0; r < rounds; ++r )
+        f();
+    return std::chrono::duration< double, std::micro >( std::chrono::steady_clock::now() - start ).count() / rounds;
+}
+
+int main( int argc, char** argv, char** envp )
+{
+    int rounds = argc > 1 ? std::atoi( argv[1] ) : 50;
+    if( rounds <= 0 )
+        rounds = 50;
+
+    std::cout << std::left << std::setw( 10 ) << "entries"
+              << std::right << std::setw( 12 ) << "bytes"
+              << std::setw( 14 ) << "pack(us)"
+              << std::setw( 14 ) << "unpack(us)"
+              << std::setw( 14 ) << "copy(us)"
+              << std::setw( 14 ) << "lookup(us)" << std::endl;
+
+    for( int entries : { 100, 1000, 10000 } )
+    {
+        const lua_map data = make_contract_data( entries );
+        const std::vector< char > packed = fc::raw::pack_to_vector( data );
+        const auto& board = data.at( lua_key(lua_string("board")) ).get< lua_table >().v;
+
+        size_t sink = 0;
+        double pack_time = measure( rounds, [&]() { sink += fc::raw::pack_to_vector( data ).size(); } );
+        double unpack_time = measure( rounds, [&]() { sink += fc::raw::unpack_from_vector< lua_map >( packed ).size(); } );
+        double copy_time = measure( rounds, [&]() { lua_map copied = data; sink += copied.size(); } );
+        double lookup_time = measure( rounds, [&]() {
+            for( int i = 0; i < entries; i += 7 )
+                sink += board.count( lua_key(lua_string("account_" + std::to_string(i))) );
+        } );
+
+        std::cout << std::left << std::setw( 10 ) << entries
+                  << std::right << std::setw( 12 ) << packed.size()
+                  << std::setw( 14 ) << std::fixed << std::setprecision( 1 ) << pack_time
+                  << std::setw( 14 ) << unpack_time
+                  << std::setw( 14 ) << copy_time
+                  << std::setw( 14 ) << lookup_time << std::endl;
+
+        if( sink == 0 )
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <chain/block_log.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <cstring>
+#include <iostream>
+
+//把区块日志转换为压缩格式（或用 --decompress 转回原始格式），输出文件不能已存在
+int main( int argc, char** argv, char** envp )
+{
+    bool decompress = argc == 4 && strcmp( argv[1], "--decompress" ) == 0;
+    if( argc != 3 && !decompress )
+    {
+        std::cerr << "usage: " << argv[0] << " [--decompress] <source block_log> <destination block_log>" << std::endl;
+        return 1;
+    }
+
+    fc::path src_path( argv[argc - 2] );
+    fc::path dst_path( argv[argc - 1] );
+
+    try
+    {
+        FC_ASSERT( fc::exists( src_path ), "Source block log ${p} does not exist", ("p", src_path) );
+        FC_ASSERT( !fc::exists( dst_path ) && !fc::exists( dst_path.generic_string() + ".index" ),
+                  "Destination block log ${p} already exists", ("p", dst_path) );
+
+        taiyi::chain::block_log src;
+        src.open( src_path );
+        taiyi::chain::block_log dst;
+        dst.open( dst_path, !decompress );
+
+        uint32_t head = src.head_block_num();
+        auto start = fc::time_point::now();
+        for( uint32_t n = 1; n <= head; ++n )
+        {
+            dst.append( *src.read_block_by_num( n ) );
+            if( n % 100000 == 0 )
+                std::cerr << "   " << double( n ) * 100 / head << "%   " << n << " of " << head << std::endl;
+        }
+        dst.flush();
+
+        auto src_size = fc::file_size( src_path );
+        auto dst_size = fc::file_size( dst_path );
+        std::cout << "converted " << head << " blocks in " << ( fc::time_point::now() - start ).count() / 1000000.0 << " s, "
+                  << src_size << " -> " << dst_size << " bytes ("
+                  << ( src_size ? double( dst_size ) * 100 / src_size : 0 ) << "%)" << std::endl;
+    }
+    catch( const fc::exception& e )
+    {
+        std::cerr << e.to_detail_string() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
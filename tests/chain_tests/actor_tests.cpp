@@ -0,0 +1,262 @@
+#include <boost/test/unit_test.hpp>
+
+#include <chain/taiyi_fwd.hpp>
+
+#include <protocol/exceptions.hpp>
+#include <protocol/hardfork.hpp>
+
+#include <chain/database.hpp>
+#include <chain/database_exceptions.hpp>
+
+#include <chain/taiyi_objects.hpp>
+#include <chain/account_object.hpp>
+#include <chain/contract_objects.hpp>
+#include <chain/actor_objects.hpp>
+#include <chain/nfa_objects.hpp>
+#include <chain/zone_objects.hpp>
+#include <chain/population_stats_object.hpp>
+
+#include <fc/macros.hpp>
+#include <fc/crypto/digest.hpp>
+
+#include "../db_fixture/database_fixture.hpp"
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+using namespace taiyi;
+using namespace taiyi::chain;
+using namespace taiyi::protocol;
+using std::string;
+
+BOOST_FIXTURE_TEST_SUITE( actor_tests, clean_database_fixture )
+
+BOOST_AUTO_TEST_CASE( talent_rule_trigger_conditions )
+{ try {
+    BOOST_TEST_MESSAGE( "Testing: talent_rule_trigger_conditions" );
+
+    ACTORS( (alice) )
+    vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+    generate_block();
+
+    signed_transaction tx;
+    auto push = [&]( const operation& op, const fc::ecc::private_key& key ) {
+        tx.operations.clear();
+        tx.signatures.clear();
+        tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+        tx.operations.push_back( op );
+        sign( tx, key );
+        db->push_transaction( tx, 0 );
+        generate_block();
+    };
+    auto create_rule = [&]( const string& contract_name, const string& conditions ) -> const actor_talent_rule_object& {
+        create_contract_operation cop;
+        cop.owner = "alice";
+        cop.name = contract_name;
+        cop.data = "function talent_data() \n \
+                        return { name = 'talent', description = 'talent'" + conditions + " } \n \
+                    end \n \
+                    function trigger() \n \
+                        return { triggered = true } \n \
+                    end";
+        push( cop, alice_private_key );
+
+        create_actor_talent_rule_operation rop;
+        rop.creator = "alice";
+        rop.contract = contract_name;
+        push( rop, alice_post_key );
+
+        const auto& contract = db->get< contract_object, by_name >( contract_name );
+        return db->get< actor_talent_rule_object, by_contract >( contract.id );
+    };
+
+    BOOST_TEST_MESSAGE( "--- Test rules without conditions keep the single trigger" );
+
+    const auto& plain_rule = create_rule( "contract.talent.plain", "" );
+    BOOST_REQUIRE_EQUAL( plain_rule.max_triggers, 1 );
+    BOOST_REQUIRE_EQUAL( plain_rule.min_trigger_age, 0 );
+    BOOST_REQUIRE_EQUAL( plain_rule.max_trigger_age, std::numeric_limits<uint16_t>::max() );
+    BOOST_REQUIRE( plain_rule.min_attributes.empty() );
+    BOOST_REQUIRE( plain_rule.can_trigger( 0, 0, nullptr ) );
+    BOOST_REQUIRE( !plain_rule.can_trigger( 0, 1, nullptr ) );
+
+    BOOST_TEST_MESSAGE( "--- Test declared conditions are parsed" );
+
+    const auto& rule = create_rule( "contract.talent.cond", ", max_triggers = 2, min_age = 10, max_age = 20, min_attributes = { strength = 12 }" );
+    BOOST_REQUIRE_EQUAL( rule.max_triggers, 2 );
+    BOOST_REQUIRE_EQUAL( rule.min_trigger_age, 10 );
+    BOOST_REQUIRE_EQUAL( rule.max_trigger_age, 20 );
+    BOOST_REQUIRE_EQUAL( rule.min_attributes.size(), 1u );
+    BOOST_REQUIRE_EQUAL( rule.min_attributes.begin()->first, 0 );
+    BOOST_REQUIRE_EQUAL( rule.min_attributes.begin()->second, 12 );
+
+    const auto& attrs = db->create< actor_core_attributes_object >( [&]( actor_core_attributes_object& obj ) {
+        obj.strength = 12;
+    });
+    BOOST_REQUIRE( rule.can_trigger( 15, 0, &attrs ) );
+
+    BOOST_TEST_MESSAGE( "--- Test max_triggers" );
+
+    BOOST_REQUIRE( rule.can_trigger( 15, 1, &attrs ) );
+    BOOST_REQUIRE( !rule.can_trigger( 15, 2, &attrs ) );
+
+    BOOST_TEST_MESSAGE( "--- Test min_age" );
+
+    BOOST_REQUIRE( rule.can_trigger( 10, 0, &attrs ) );
+    BOOST_REQUIRE( !rule.can_trigger( 9, 0, &attrs ) );
+
+    BOOST_TEST_MESSAGE( "--- Test max_age" );
+
+    BOOST_REQUIRE( rule.can_trigger( 20, 0, &attrs ) );
+    BOOST_REQUIRE( !rule.can_trigger( 21, 0, &attrs ) );
+
+    BOOST_TEST_MESSAGE( "--- Test min_attributes" );
+
+    db->modify( attrs, [&]( actor_core_attributes_object& obj ) {
+        obj.strength = 11;
+    });
+    BOOST_REQUIRE( !rule.can_trigger( 15, 0, &attrs ) );
+    BOOST_REQUIRE( !rule.can_trigger( 15, 0, nullptr ) );
+
+    BOOST_TEST_MESSAGE( "--- Test invalid conditions are rejected" );
+
+    TAIYI_REQUIRE_THROW( create_rule( "contract.talent.badtype", ", max_triggers = 'many'" ), fc::exception );
+    TAIYI_REQUIRE_THROW( create_rule( "contract.talent.badcount", ", max_triggers = 0" ), fc::exception );
+    TAIYI_REQUIRE_THROW( create_rule( "contract.talent.badage", ", min_age = 30, max_age = 20" ), fc::exception );
+    TAIYI_REQUIRE_THROW( create_rule( "contract.talent.badtable", ", min_attributes = 5" ), fc::exception );
+    TAIYI_REQUIRE_THROW( create_rule( "contract.talent.badname", ", min_attributes = { luck = 1 }" ), fc::exception );
+    TAIYI_REQUIRE_THROW( create_rule( "contract.talent.badvalue", ", min_attributes = { strength = 'high' }" ), fc::exception );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( population_stats )
+{ try {
+    BOOST_TEST_MESSAGE( "Testing: population_stats" );
+
+    ACTORS( (alice) )
+    generate_block();
+
+    auto create_zone = [&]( const string& name, E_ZONE_TYPE type, int64_t nfa_id ) -> const zone_object& {
+        return db->create< zone_object >( [&]( zone_object& obj ) {
+            obj.name = name;
+            obj.type = type;
+            obj.nfa_id = nfa_id;
+        });
+    };
+    //同 create_actor_evaluator，角色创建后计入统计
+    auto create_actor = [&]( const string& name ) -> const actor_object& {
+        const auto& nfa = db->create< nfa_object >( [&]( nfa_object& obj ) {
+            obj.creator_account = alice.id;
+            obj.owner_account = alice.id;
+            obj.active_account = alice.id;
+        });
+        const auto& act = db->create< actor_object >( [&]( actor_object& obj ) {
+            obj.name = name;
+            obj.nfa_id = nfa.id;
+        });
+        db->initialize_actor_talents( act );
+        db->adjust_population_stats( act, 1 );
+        return act;
+    };
+    //同成长、死亡和移动，修改前后分别减去和加上角色的统计
+    auto modify_actor = [&]( const actor_object& act, std::function< void( actor_object& ) > m ) {
+        db->adjust_population_stats( act, -1 );
+        db->modify( act, m );
+        db->adjust_population_stats( act, 1 );
+    };
+    auto zone_living = [&]( const zone_object& zone ) -> uint32_t {
+        const auto* stats = db->find_population_stats( zone.id );
+        return stats == nullptr ? 0 : stats->living;
+    };
+    auto zone_dead = [&]( const zone_object& zone ) -> uint32_t {
+        const auto* stats = db->find_population_stats( zone.id );
+        return stats == nullptr ? 0 : stats->dead;
+    };
+
+    const auto& world = db->get_population_stats();
+    const uint32_t living = world.living;
+    const uint32_t dead = world.dead;
+    const uint32_t young = world.living_by_age[0];
+    const uint32_t in_yuanye = world.living_by_zone_type[YUANYE];
+    const uint32_t in_shanyue = world.living_by_zone_type[SHANYUE];
+
+    const auto& zone_a = create_zone( "population_a", YUANYE, 200001 );
+    const auto& zone_b = create_zone( "population_b", SHANYUE, 200002 );
+
+    BOOST_TEST_MESSAGE( "--- Test actor creation" );
+
+    const auto& li = create_actor( "population_li" );
+    const auto& wang = create_actor( "population_wang" );
+    BOOST_REQUIRE_EQUAL( world.living, living + 2 );
+    BOOST_REQUIRE_EQUAL( world.living_by_age[0], young + 2 );
+    BOOST_REQUIRE( db->find_population_stats( zone_a.id ) == nullptr );
+
+    BOOST_TEST_MESSAGE( "--- Test birth" );
+
+    db->born_actor( li, 1, 1, zone_a );
+    db->born_actor( wang, -1, 2, zone_a );
+    BOOST_REQUIRE_EQUAL( world.living, living + 2 );
+    BOOST_REQUIRE_EQUAL( world.living_by_zone_type[YUANYE], in_yuanye + 2 );
+    BOOST_REQUIRE_EQUAL( zone_living( zone_a ), 2u );
+
+    BOOST_TEST_MESSAGE( "--- Test ageing" );
+
+    modify_actor( li, [&]( actor_object& obj ) { obj.age = 25; } );
+    BOOST_REQUIRE_EQUAL( world.living, living + 2 );
+    BOOST_REQUIRE_EQUAL( world.living_by_age[0], young + 1 );
+    BOOST_REQUIRE_EQUAL( world.living_by_age[2], 1u );
+
+    BOOST_TEST_MESSAGE( "--- Test death" );
+
+    modify_actor( li, [&]( actor_object& obj ) { obj.health_max = 0; obj.health = 0; } );
+    BOOST_REQUIRE_EQUAL( world.living, living + 1 );
+    BOOST_REQUIRE_EQUAL( world.dead, dead + 1 );
+    BOOST_REQUIRE_EQUAL( world.living_by_age[2], 0u );
+    BOOST_REQUIRE_EQUAL( world.living_by_zone_type[YUANYE], in_yuanye + 1 );
+    BOOST_REQUIRE_EQUAL( zone_living( zone_a ), 1u );
+    BOOST_REQUIRE_EQUAL( zone_dead( zone_a ), 1u );
+
+    BOOST_TEST_MESSAGE( "--- Test move_actor" );
+
+    modify_actor( wang, [&]( actor_object& obj ) { obj.location = zone_b.id; } );
+    BOOST_REQUIRE_EQUAL( world.living, living + 1 );
+    BOOST_REQUIRE_EQUAL( world.living_by_zone_type[YUANYE], in_yuanye );
+    BOOST_REQUIRE_EQUAL( world.living_by_zone_type[SHANYUE], in_shanyue + 1 );
+    BOOST_REQUIRE_EQUAL( zone_living( zone_a ), 0u );
+    BOOST_REQUIRE_EQUAL( zone_living( zone_b ), 1u );
+
+    BOOST_TEST_MESSAGE( "--- Test change_zone_type" );
+
+    db->change_zone_type( zone_b, YUANYE );
+    BOOST_REQUIRE_EQUAL( world.living_by_zone_type[YUANYE], in_yuanye + 1 );
+    BOOST_REQUIRE_EQUAL( world.living_by_zone_type[SHANYUE], in_shanyue );
+    BOOST_REQUIRE_EQUAL( zone_living( zone_b ), 1u );
+
+    BOOST_TEST_MESSAGE( "--- Test undo restores the counts" );
+
+    {
+        auto session = db->start_undo_session();
+        const auto& zhao = create_actor( "population_zhao" );
+        db->born_actor( zhao, 1, 1, zone_b );
+        modify_actor( wang, [&]( actor_object& obj ) { obj.health = 0; } );
+        db->change_zone_type( zone_b, SHANYUE );
+        BOOST_REQUIRE_EQUAL( world.living, living + 1 );
+        BOOST_REQUIRE_EQUAL( world.living_by_zone_type[SHANYUE], in_shanyue + 1 );
+        BOOST_REQUIRE_EQUAL( zone_dead( zone_b ), 1u );
+        session.undo();
+    }
+    BOOST_REQUIRE_EQUAL( world.living, living + 1 );
+    BOOST_REQUIRE_EQUAL( world.dead, dead + 1 );
+    BOOST_REQUIRE_EQUAL( world.living_by_age[0], young + 1 );
+    BOOST_REQUIRE_EQUAL( world.living_by_zone_type[YUANYE], in_yuanye + 1 );
+    BOOST_REQUIRE_EQUAL( world.living_by_zone_type[SHANYUE], in_shanyue );
+    BOOST_REQUIRE_EQUAL( zone_living( zone_b ), 1u );
+    BOOST_REQUIRE_EQUAL( zone_dead( zone_b ), 0u );
+    BOOST_REQUIRE( db->find< actor_object, by_name >( "population_zhao" ) == nullptr );
+    validate_database();
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
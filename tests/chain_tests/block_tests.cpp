@@ -12,10 +12,17 @@
 #include <plugins/account_history/account_history_plugin.hpp>
 #include <plugins/siming/block_producer.hpp>
 
+#include <net/core_messages.hpp>
+
 #include <utilities/tempdir.hpp>
 #include <utilities/database_configuration.hpp>
 
 #include <fc/crypto/digest.hpp>
+#include <fc/filesystem.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <thread>
 
 #include "../db_fixture/database_fixture.hpp"
 
@@ -97,6 +104,243 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
     }
 }
 
+BOOST_AUTO_TEST_CASE( state_snapshot_export_import )
+{
+    try {
+        fc::temp_directory data_dir1( taiyi::utilities::temp_directory_path() ), data_dir2( taiyi::utilities::temp_directory_path() );
+        fc::temp_directory snapshot_dir( taiyi::utilities::temp_directory_path() );
+        auto init_account_priv_key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "init_key" ) ) );
+        database::snapshot_manifest manifest;
+        {
+            database db;
+            siming::block_producer bp( db );
+            db.set_log_hardforks(false);
+            open_test_database( db, data_dir1.path() );
+            for( uint32_t i = 0; i < 50; ++i )
+                bp.generate_block(db.get_slot_time(1), db.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            db.close();
+        }
+        {
+            // 重新打开后状态回到最后不可逆块
+            database db;
+            db.set_log_hardforks(false);
+            open_test_database( db, data_dir1.path() );
+            manifest = db.export_snapshot( snapshot_dir.path() );
+            BOOST_REQUIRE( manifest.head_block_num > 0 );
+            BOOST_REQUIRE_EQUAL( manifest.head_block_num, db.head_block_num() );
+            BOOST_REQUIRE_EQUAL( manifest.sections.size(), db.index_delegates().size() );
+            db.close();
+        }
+        
+        fc::copy( data_dir1.path() / "block_log", data_dir2.path() / "block_log" );
+        fc::copy( data_dir1.path() / "block_log.index", data_dir2.path() / "block_log.index" );
+        
+        database::open_args args;
+        args.data_dir = data_dir2.path();
+        args.state_storage_dir = data_dir2.path();
+        args.initial_supply = INITIAL_TEST_SUPPLY;
+        args.database_cfg = taiyi::utilities::default_database_configuration();
+        args.load_snapshot_dir = snapshot_dir.path();
+        {
+            database db;
+            siming::block_producer bp( db );
+            db.set_log_hardforks(false);
+            db.open( args );
+            BOOST_REQUIRE( db.head_block_id() == manifest.head_block_id );
+            db.validate_invariants();
+            
+            auto b = bp.generate_block(db.get_slot_time(1), db.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            BOOST_REQUIRE( db.head_block_id() == b.id() );
+            db.close();
+        }
+        
+        // 段文件被改动后在载入任何对象之前就被拒绝
+        {
+            std::ofstream section( ( snapshot_dir.path() / ( manifest.sections.front().index_name + ".bin" ) ).string(), std::ios::binary | std::ios::app );
+            section << 'x';
+        }
+        {
+            database db;
+            db.set_log_hardforks(false);
+            BOOST_REQUIRE_THROW( db.open( args ), fc::exception );
+        }
+    }
+    catch (fc::exception& e) {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( pipelined_reindex )
+{
+    try {
+        fc::temp_directory data_dir( taiyi::utilities::temp_directory_path() );
+        auto init_account_priv_key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "init_key" ) ) );
+        block_id_type head_id;
+        {
+            database db;
+            siming::block_producer bp( db );
+            db.set_log_hardforks(false);
+            open_test_database( db, data_dir.path() );
+            for( uint32_t i = 0; i < 60; ++i )
+                bp.generate_block(db.get_slot_time(1), db.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            db.close();
+        }
+        {
+            block_log log;
+            log.open( data_dir.path() / "block_log" );
+            head_id = log.head()->id();
+            uint32_t head_num = log.head()->block_num();
+            
+            // 预读的块和逐块读取的一致，且容量小于块数时也按顺序交付
+            block_prefetcher prefetcher( log, 1, head_num, 3, 4 );
+            for( uint32_t n = 1; n <= head_num; ++n )
+            {
+                auto block = prefetcher.next();
+                BOOST_REQUIRE_EQUAL( block->get_block_num(), n );
+                BOOST_REQUIRE( block->get_id() == log.read_block_by_num( n )->id() );
+            }
+            BOOST_REQUIRE_EQUAL( prefetcher.get_stats().blocks, head_num );
+        }
+        {
+            database db;
+            db.set_log_hardforks(false);
+            database::open_args args;
+            args.data_dir = data_dir.path();
+            args.state_storage_dir = data_dir.path();
+            args.initial_supply = INITIAL_TEST_SUPPLY;
+            args.database_cfg = taiyi::utilities::default_database_configuration();
+            args.replay_prefetch_threads = 2;
+            auto last_block_num = db.reindex( args );
+            BOOST_REQUIRE_EQUAL( last_block_num, protocol::block_header::num_from_id( head_id ) );
+            BOOST_REQUIRE( db.head_block_id() == head_id );
+            db.validate_invariants();
+            db.close();
+        }
+    }
+    catch (fc::exception& e) {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( block_log_concurrent_reads )
+{
+    try {
+        fc::temp_directory data_dir( taiyi::utilities::temp_directory_path() );
+        block_log log;
+        log.open( data_dir.path() / "block_log" );
+        
+        const uint32_t block_count = 500;
+        std::vector< block_id_type > ids;
+        signed_block b;
+        std::atomic< bool > done( false ), mismatch( false );
+        std::atomic< uint32_t > reads( 0 );
+        
+        // 读线程在追加块的同时不断读取已写入的块
+        std::thread reader( [&]() {
+            uint32_t n = 0;
+            while( !done )
+            {
+                auto head = log.head_block_num();
+                if( head == 0 )
+                    continue;
+                n = n % head + 1;
+                auto block = log.read_block_by_num( n );
+                if( !block.valid() || block->block_num() != n )
+                    mismatch = true;
+                ++reads;
+            }
+        } );
+        
+        for( uint32_t i = 0; i < block_count; ++i )
+        {
+            b.previous = ids.empty() ? block_id_type() : ids.back();
+            b.timestamp = fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + i * TAIYI_BLOCK_INTERVAL );
+            log.append( b );
+            log.flush();
+            ids.push_back( b.id() );
+        }
+        done = true;
+        reader.join();
+        BOOST_REQUIRE( !mismatch );
+        BOOST_REQUIRE( reads > 0 );
+        
+        for( uint32_t n = 1; n <= block_count; ++n )
+            BOOST_REQUIRE( log.read_block_by_num( n )->id() == ids[ n - 1 ] );
+        BOOST_REQUIRE( !log.read_block_by_num( block_count + 1 ).valid() );
+        
+        auto itr = log.read_block( 0 );
+        for( uint32_t n = 1; n < block_count; ++n )
+        {
+            BOOST_REQUIRE( itr.first.id() == ids[ n - 1 ] );
+            BOOST_REQUIRE_EQUAL( log.get_block_pos( n + 1 ), itr.second );
+            itr = log.read_block( itr.second );
+        }
+        BOOST_REQUIRE( itr.first.id() == ids.back() );
+    }
+    catch (fc::exception& e) {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( compressed_block_log )
+{
+    try {
+        fc::temp_directory data_dir( taiyi::utilities::temp_directory_path() );
+        const uint32_t block_count = 50;
+        std::vector< signed_block > blocks;
+        {
+            block_log log;
+            log.open( data_dir.path() / "block_log", true );
+            BOOST_REQUIRE( log.is_compressed() );
+            
+            signed_block b;
+            for( uint32_t i = 0; i < block_count; ++i )
+            {
+                b.previous = blocks.empty() ? block_id_type() : blocks.back().id();
+                b.timestamp = fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + i * TAIYI_BLOCK_INTERVAL );
+                b.siming = "initminer";
+                log.append( b );
+                blocks.push_back( b );
+            }
+            log.flush();
+        }
+        
+        auto check_log = [&]( bool compress_new_log ) {
+            block_log log;
+            log.open( data_dir.path() / "block_log", compress_new_log );
+            BOOST_REQUIRE( log.is_compressed() );
+            BOOST_REQUIRE_EQUAL( log.head_block_num(), block_count );
+            BOOST_REQUIRE( log.head()->id() == blocks.back().id() );
+            
+            for( uint32_t n = 1; n <= block_count; ++n )
+            {
+                BOOST_REQUIRE( log.read_block_by_num( n )->id() == blocks[ n - 1 ].id() );
+                BOOST_REQUIRE( log.read_serialized_block( n ) == fc::raw::pack_to_vector( blocks[ n - 1 ] ) );
+            }
+            
+            auto itr = log.read_block( log.get_block_pos( 1 ) );
+            for( uint32_t n = 2; n <= block_count; ++n )
+            {
+                BOOST_REQUIRE_EQUAL( itr.second, log.get_block_pos( n ) );
+                itr = log.read_block( itr.second );
+                BOOST_REQUIRE( itr.first.id() == blocks[ n - 1 ].id() );
+            }
+        };
+        
+        // 已有的压缩日志保持压缩格式；索引丢失后按帧重建
+        check_log( false );
+        fc::remove_all( data_dir.path() / "block_log.index" );
+        check_log( true );
+    }
+    catch (fc::exception& e) {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
 BOOST_AUTO_TEST_CASE( undo_block )
 {
     try {
@@ -503,6 +747,224 @@ BOOST_FIXTURE_TEST_CASE( double_sign_check, clean_database_fixture )
     
 } FC_LOG_AND_RETHROW() }
 
+BOOST_FIXTURE_TEST_CASE( signature_keys_cache, clean_database_fixture )
+{ try {
+    generate_block();
+    ACTOR(bob);
+    
+    transfer_operation t;
+    t.from = "bob";
+    t.to = TAIYI_INIT_SIMING_NAME;
+    t.amount = asset(1,YANG_SYMBOL);
+    
+    signed_transaction trx;
+    trx.operations.push_back(t);
+    trx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    sign( trx, bob_private_key );
+    
+    BOOST_TEST_MESSAGE( "Verify that recovered keys are cached per transaction" );
+    const auto& keys = db->get_signature_keys( trx, trx.id(), fc::ecc::fc_canonical );
+    BOOST_REQUIRE( keys.size() == 1 );
+    BOOST_REQUIRE( *keys.begin() == bob_private_key.get_public_key() );
+    BOOST_REQUIRE( &db->get_signature_keys( trx, trx.id(), fc::ecc::fc_canonical ) == &keys );
+    
+    BOOST_TEST_MESSAGE( "Verify that a different signature set is recovered again" );
+    trx.signatures.clear();
+    sign( trx, generate_private_key( "bogus" ) );
+    const auto& other_keys = db->get_signature_keys( trx, trx.id(), fc::ecc::fc_canonical );
+    BOOST_REQUIRE( other_keys.size() == 1 );
+    BOOST_REQUIRE( *other_keys.begin() == generate_private_key( "bogus" ).get_public_key() );
+    
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( parallel_signature_recovery )
+{ try {
+    //db2 只通过完整校验的 push_block 接收区块，签名公钥缓存是冷的，只有预恢复会提前恢复后面交易的签名
+    fc::temp_directory dir1( taiyi::utilities::temp_directory_path() ), dir2( taiyi::utilities::temp_directory_path() );
+    database db1, db2;
+    siming::block_producer bp1( db1 );
+    db1.set_log_hardforks( false );
+    open_test_database( db1, dir1.path() );
+    db2.set_log_hardforks( false );
+    open_test_database( db2, dir2.path() );
+    db2.set_signature_recovery_threads( 4 );
+    
+    auto init_account_priv_key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "init_key" ) ) );
+    public_key_type init_account_pub_key = init_account_priv_key.get_public_key();
+    
+    signed_transaction trx;
+    account_create_operation cop;
+    cop.new_account_name = "alice";
+    cop.creator = TAIYI_INIT_SIMING_NAME;
+    cop.fee = db1.get_siming_schedule_object().median_props.account_creation_fee;
+    cop.owner = authority( 1, init_account_pub_key, 1 );
+    cop.active = cop.owner;
+    trx.operations.push_back( cop );
+    trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
+    PUSH_TX( db1, trx );
+    auto b = bp1.generate_block( db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing );
+    db2.push_block( b, database::skip_nothing );
+    
+    for( int round = 0; round < 3; ++round )
+    {
+        for( int i = 1; i <= 20; ++i )
+        {
+            transfer_operation t;
+            t.from = TAIYI_INIT_SIMING_NAME;
+            t.to = "alice";
+            t.amount = asset( i, YANG_SYMBOL );
+            
+            trx.clear();
+            trx.operations.push_back( t );
+            trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+            trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
+            PUSH_TX( db1, trx );
+        }
+        b = bp1.generate_block( db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing );
+        BOOST_REQUIRE( b.transactions.size() == 20 );
+        for( const auto& tx : b.transactions )
+            BOOST_REQUIRE( db2.find_cached_signature_keys( tx, tx.id(), fc::ecc::bip_0062 ) == nullptr );
+        
+        BOOST_TEST_MESSAGE( "Verify that a bad signature is still rejected by the serial check" );
+        signed_block bad = b;
+        bad.transactions[9].signatures.push_back( bad.transactions[9].signatures[0] );
+        bad.transaction_merkle_root = bad.calculate_merkle_root();
+        bad.sign( init_account_priv_key );
+        TAIYI_REQUIRE_THROW( db2.push_block( bad, database::skip_nothing ), tx_duplicate_sig );
+        
+        BOOST_TEST_MESSAGE( "Verify that the workers recovered the keys of transactions the serial apply never reached" );
+        BOOST_REQUIRE( db2.find_cached_signature_keys( bad.transactions[9], bad.transactions[9].id(), fc::ecc::bip_0062 ) == nullptr );
+        for( size_t i = 10; i < bad.transactions.size(); ++i )
+        {
+            const auto* keys = db2.find_cached_signature_keys( bad.transactions[i], bad.transactions[i].id(), fc::ecc::bip_0062 );
+            BOOST_REQUIRE( keys != nullptr );
+            BOOST_REQUIRE( *keys == flat_set<public_key_type>{ init_account_pub_key } );
+            //完整校验时命中的就是预恢复缓存的这份公钥
+            BOOST_REQUIRE( &db2.get_signature_keys( bad.transactions[i], bad.transactions[i].id(), fc::ecc::bip_0062 ) == keys );
+        }
+        
+        BOOST_TEST_MESSAGE( "Verify that the valid block applies with the same recovery workers" );
+        asset alice_balance = db2.get_balance( "alice", YANG_SYMBOL );
+        db2.push_block( b, database::skip_nothing );
+        BOOST_REQUIRE( db2.head_block_id() == db1.head_block_id() );
+        BOOST_REQUIRE_EQUAL( db2.get_balance( "alice", YANG_SYMBOL ).amount.value, alice_balance.amount.value + 210 );
+        
+        //线程数变化时重建工作线程
+        if( round == 1 )
+            db2.set_signature_recovery_threads( 2 );
+    }
+    
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( block_state_caches_identity, clean_database_fixture )
+{ try {
+    generate_block();
+    ACTOR(bob);
+    generate_block();
+    
+    for( int i = 1; i <= 3; ++i )
+    {
+        transfer_operation t;
+        t.from = TAIYI_INIT_SIMING_NAME;
+        t.to = "bob";
+        t.amount = asset(i,YANG_SYMBOL);
+        
+        signed_transaction trx;
+        trx.operations.push_back(t);
+        trx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+        sign( trx, init_account_priv_key );
+        db->push_transaction(trx, 0);
+    }
+    generate_block();
+    
+    BOOST_TEST_MESSAGE( "Verify that the cached values match the ones computed from the block" );
+    signed_block b = *db->fetch_block_by_number( db->head_block_num() );
+    BOOST_REQUIRE( b.transactions.size() == 3 );
+    auto state = block_state::create( b );
+    
+    BOOST_REQUIRE( state->get_id() == b.id() );
+    BOOST_REQUIRE( state->get_id() == db->head_block_id() );
+    BOOST_REQUIRE_EQUAL( state->get_block_num(), b.block_num() );
+    BOOST_REQUIRE( state->get_digest() == b.digest() );
+    BOOST_REQUIRE( state->get_merkle_root() == b.calculate_merkle_root() );
+    BOOST_REQUIRE( state->get_merkle_root() == b.transaction_merkle_root );
+    BOOST_REQUIRE( state->get_packed() == fc::raw::pack_to_vector( b ) );
+    BOOST_REQUIRE_EQUAL( state->get_transaction_ids().size(), b.transactions.size() );
+    for( size_t i = 0; i < b.transactions.size(); ++i )
+    {
+        BOOST_REQUIRE( state->get_transaction_ids()[i] == b.transactions[i].id() );
+        BOOST_REQUIRE( state->get_transaction_digests()[i] == b.transactions[i].merkle_digest() );
+    }
+    BOOST_REQUIRE( state->validate_signee( init_account_priv_key.get_public_key() ) );
+    BOOST_REQUIRE( !state->validate_signee( generate_private_key( "bogus" ).get_public_key() ) );
+    
+    BOOST_TEST_MESSAGE( "Verify that an empty block has the empty merkle root" );
+    signed_block empty;
+    BOOST_REQUIRE( block_state::create( empty )->get_merkle_root() == checksum_type() );
+    
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( fetch_block_state, clean_database_fixture )
+{ try {
+    generate_blocks( 30 );
+    
+    BOOST_TEST_MESSAGE( "Verify that the fork database hands out its shared state" );
+    auto head = db->fetch_block_state_by_id( db->head_block_id() );
+    BOOST_REQUIRE( head );
+    BOOST_REQUIRE( head == db->fetch_block_state_by_id( db->head_block_id() ) );
+    BOOST_REQUIRE( head->get_packed() == fc::raw::pack_to_vector( *db->fetch_block_by_number( db->head_block_num() ) ) );
+    
+    BOOST_TEST_MESSAGE( "Verify that irreversible blocks are served with their logged bytes" );
+    auto first = db->fetch_block_state_by_id( db->get_block_id_for_num( 1 ) );
+    BOOST_REQUIRE( first );
+    BOOST_REQUIRE_EQUAL( first->get_block_num(), 1u );
+    BOOST_REQUIRE( first->get_packed() == fc::raw::pack_to_vector( *db->fetch_block_by_number( 1 ) ) );
+    
+    BOOST_TEST_MESSAGE( "Verify that unknown ids are not found" );
+    block_id_type unknown = db->get_block_id_for_num( 2 );
+    unknown._hash[4] ^= 1;
+    BOOST_REQUIRE( !db->fetch_block_state_by_id( unknown ) );
+    
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( block_message_round_trip, clean_database_fixture )
+{ try {
+    generate_block();
+    
+    BOOST_TEST_MESSAGE( "Verify that a block message survives packing and unpacking" );
+    signed_block b = *db->fetch_block_by_number( db->head_block_num() );
+    net::message m{ net::block_message( b ) };
+    BOOST_REQUIRE( net::block_message::read_block_id( m ) == b.id() );
+    
+    net::block_message received = m.as< net::block_message >();
+    BOOST_REQUIRE( received.block_id == b.id() );
+    BOOST_REQUIRE( received.state->get_id() == b.id() );
+    BOOST_REQUIRE( received.state->get_packed() == fc::raw::pack_to_vector( b ) );
+    BOOST_REQUIRE( net::message( received ).data == m.data );
+    
+    BOOST_TEST_MESSAGE( "Verify that an overlong encoding of the transaction count is rejected" );
+    BOOST_REQUIRE( b.transactions.empty() );
+    std::vector< char > packed = fc::raw::pack_to_vector( b );
+    BOOST_REQUIRE( packed.back() == 0 );
+    packed.back() = char( 0x80 );
+    packed.push_back( 0 );
+    
+    net::message overlong;
+    overlong.msg_type = net::block_message::type;
+    overlong.data = packed;
+    overlong.data.insert( overlong.data.end(), (const char*)b.id()._hash, (const char*)b.id()._hash + sizeof( block_id_type ) );
+    overlong.size = (uint32_t)overlong.data.size();
+    TAIYI_REQUIRE_THROW( overlong.as< net::block_message >(), fc::exception );
+    
+    BOOST_TEST_MESSAGE( "Verify that trailing bytes are rejected" );
+    net::message trailing = m;
+    trailing.data.insert( trailing.data.end() - sizeof( block_id_type ), char( 0 ) );
+    trailing.size = (uint32_t)trailing.data.size();
+    TAIYI_REQUIRE_THROW( trailing.as< net::block_message >(), fc::exception );
+    
+} FC_LOG_AND_RETHROW() }
+
 BOOST_FIXTURE_TEST_CASE( pop_block_twice, clean_database_fixture )
 {
     try
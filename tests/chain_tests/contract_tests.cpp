@@ -22,6 +22,7 @@ extern "C" {
 #include <random>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
 #include <chain/contract_handles.hpp>
 
 using namespace taiyi;
@@ -740,5 +741,457 @@ BOOST_AUTO_TEST_CASE( call_contract_function_apply )
     
 } FC_LOG_AND_RETHROW() }
 
+//=============================================================================
+BOOST_AUTO_TEST_CASE( contract_data_keyed_storage )
+{ try {
+    string lua_code =  "function set_data() \n \
+                            contract_helper:write_contract_data({board = {alice = 10}, count = 3}, {board = true, count = true}) \n \
+                        end \n \
+                        function drop_count() \n \
+                            contract_helper:write_contract_data({}, {count = false}) \n \
+                        end";
+
+    BOOST_TEST_MESSAGE( "Testing: contract_data_keyed_storage" );
+
+    ACTORS( (alice)(bob) )
+    vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+    vest( TAIYI_INIT_SIMING_NAME, "bob", ASSET( "1000.000 YANG" ) );
+    generate_block();
+
+    signed_transaction tx;
+
+    create_contract_operation op;
+    op.owner = "bob";
+    op.name = "contract.data";
+    op.data = lua_code;
+
+    tx.operations.push_back( op );
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, bob_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+    generate_block();
+
+    const auto& contract = db->get<contract_object, by_name>( "contract.data" );
+    auto stored_data = [&]() {
+        lua_map data;
+        const auto& idx = db->get_index<contract_data_index, by_contract_key>();
+        for( auto itr = idx.lower_bound( contract.id ); itr != idx.end() && itr->contract_id == contract.id; ++itr )
+            data[itr->key] = itr->value;
+        return data;
+    };
+
+    auto call = [&]( const string& function_name ) {
+        call_contract_function_operation cop;
+        cop.caller = "alice";
+        cop.contract_name = "contract.data";
+        cop.function_name = function_name;
+
+        tx.operations.clear();
+        tx.signatures.clear();
+        tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+        tx.operations.push_back( cop );
+        sign( tx, alice_private_key );
+        db->push_transaction( tx, 0 );
+        validate_database();
+        generate_block();
+    };
+
+    BOOST_TEST_MESSAGE( "--- Test written keys are stored one object per key" );
+
+    call( "set_data" );
+    lua_map data = stored_data();
+    BOOST_REQUIRE( data.size() == 2 );
+    BOOST_REQUIRE( data[lua_key(lua_string("count"))].get<lua_int>().v == 3 );
+    BOOST_REQUIRE( contract.contract_data_count == 2 );
+    BOOST_REQUIRE( contract.contract_data_pack_size() == fc::raw::pack_size( data ) );
+
+    BOOST_TEST_MESSAGE( "--- Test erased keys are removed and totals follow" );
+
+    call( "drop_count" );
+    data = stored_data();
+    BOOST_REQUIRE( data.size() == 1 );
+    BOOST_REQUIRE( data.find( lua_key(lua_string("board")) ) != data.end() );
+    BOOST_REQUIRE( contract.contract_data_count == 1 );
+    BOOST_REQUIRE( contract.contract_data_pack_size() == fc::raw::pack_size( data ) );
+
+} FC_LOG_AND_RETHROW() }
+
+//=============================================================================
+BOOST_AUTO_TEST_CASE( contract_data_reentrant_calls )
+{ try {
+    //outer写入count后经invoke_contract_function重入本合约的inner
+    string lua_code =  "function outer() \n \
+                            contract_helper:write_contract_data({count = 1}, {count = true}) \n \
+                            contract_helper:invoke_contract_function('contract.other', 'inner', '[]') \n \
+                            local d = contract_helper:read_contract_data({inner = true}) \n \
+                            contract_helper:write_contract_data({seen = d.inner ~= nil and 1 or 0}, {seen = true}) \n \
+                        end \n \
+                        function inner() \n \
+                            contract_helper:write_contract_data({count = 2, inner = 1}, {count = true, inner = true}) \n \
+                            contract_helper:write_account_contract_data({visits = 1}, {visits = true}) \n \
+                        end";
+
+    BOOST_TEST_MESSAGE( "Testing: contract_data_reentrant_calls" );
+
+    ACTORS( (alice)(bob) )
+    vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+    vest( TAIYI_INIT_SIMING_NAME, "bob", ASSET( "1000.000 YANG" ) );
+    generate_block();
+
+    signed_transaction tx;
+    auto push = [&]( const operation& op, const fc::ecc::private_key& key ) {
+        tx.operations.clear();
+        tx.signatures.clear();
+        tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+        tx.operations.push_back( op );
+        sign( tx, key );
+        db->push_transaction( tx, 0 );
+    };
+    auto create = [&]( const string& name, const string& code ) {
+        create_contract_operation op;
+        op.owner = "bob";
+        op.name = name;
+        op.data = code;
+        push( op, bob_private_key );
+        generate_block();
+    };
+    auto call_outer = [&]( const string& name ) {
+        call_contract_function_operation op;
+        op.caller = "alice";
+        op.contract_name = name;
+        op.function_name = "outer";
+        push( op, alice_private_key );
+    };
+    auto stored_data = [&]( const contract_object& contract ) {
+        lua_map data;
+        const auto& idx = db->get_index<contract_data_index, by_contract_key>();
+        for( auto itr = idx.lower_bound( contract.id ); itr != idx.end() && itr->contract_id == contract.id; ++itr )
+            data[itr->key] = itr->value;
+        return data;
+    };
+    auto account_data = [&]( const contract_object& contract ) {
+        return db->get<account_contract_data_object, by_account_contract>( boost::make_tuple( db->get_account( "alice" ).id, contract.id ) ).contract_data;
+    };
+    auto count_key = lua_key(lua_string("count"));
+    auto seen_key = lua_key(lua_string("seen"));
+    auto inner_key = lua_key(lua_string("inner"));
+
+    create( "contract.other", "function noop() end" );
+    create( "contract.keyed", lua_code );
+    create( "contract.snapshot", lua_code );
+
+    BOOST_TEST_MESSAGE( "--- Test re-entrant calls see and keep each other's keys after hardfork 0.1" );
+
+    const auto& keyed = db->get<contract_object, by_name>( "contract.keyed" );
+    call_outer( "contract.keyed" );
+    lua_map data = stored_data( keyed );
+    BOOST_REQUIRE( data.size() == 3 );
+    BOOST_REQUIRE( data[count_key].get<lua_int>().v == 1 );
+    BOOST_REQUIRE( data[inner_key].get<lua_int>().v == 1 );
+    BOOST_REQUIRE( data[seen_key].get<lua_int>().v == 1 );
+    BOOST_REQUIRE( account_data( keyed ).size() == 1 );
+    BOOST_REQUIRE( keyed.contract_data_pack_size() == fc::raw::pack_size( data ) );
+    generate_block();
+
+    BOOST_TEST_MESSAGE( "--- Test the outer call's snapshot overwrites the whole table before hardfork 0.1" );
+
+    const auto& hardforks = db->get_hardfork_property_object();
+    auto processed_hardforks = hardforks.processed_hardforks;
+    db->modify( hardforks, [&]( hardfork_property_object& hpo ) { hpo.processed_hardforks.resize( TAIYI_HARDFORK_0_1 ); } );
+    BOOST_REQUIRE( !db->has_hardfork( TAIYI_HARDFORK_0_1 ) );
+
+    const auto& snapshot = db->get<contract_object, by_name>( "contract.snapshot" );
+    call_outer( "contract.snapshot" );
+    data = stored_data( snapshot );
+    BOOST_REQUIRE( data.size() == 2 );
+    BOOST_REQUIRE( data[count_key].get<lua_int>().v == 1 );
+    BOOST_REQUIRE( data[seen_key].get<lua_int>().v == 0 );
+    BOOST_REQUIRE( account_data( snapshot ).size() == 0 );
+    BOOST_REQUIRE( snapshot.contract_data_count == 2 );
+    BOOST_REQUIRE( snapshot.contract_data_pack_size() == fc::raw::pack_size( data ) );
+
+    db->modify( hardforks, [&]( hardfork_property_object& hpo ) { hpo.processed_hardforks = processed_hardforks; } );
+
+} FC_LOG_AND_RETHROW() }
+
+//=============================================================================
+BOOST_AUTO_TEST_CASE( lua_context_pool_recycle )
+{ try {
+    auto& pool = lua_context_pool::instance();
+    
+    BOOST_TEST_MESSAGE( "--- Test recycled context is back to the warmed up state" );
+    {
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
+        context.executeCode("leaked_global = { 1, 2, 3 }");
+        lua_pushnumber(context.mState, 1);
+        lua_enabledrops(context.mState, 1, 1);
+        lua_setdrops(context.mState, 1000);
+    }
+    uint64_t reused = pool.reused_contexts();
+    {
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
+        BOOST_REQUIRE_EQUAL( pool.reused_contexts(), reused + 1 );
+        
+        BOOST_REQUIRE_EQUAL( lua_gettop(context.mState), 0 );
+        BOOST_REQUIRE_EQUAL( lua_getdropsenabled(context.mState), 0 );
+        BOOST_REQUIRE_EQUAL( lua_getdrops(context.mState), 0 );
+        
+        lua_getglobal(context.mState, "leaked_global");
+        BOOST_REQUIRE( lua_isnil(context.mState, -1) );
+        lua_getglobal(context.mState, "import_contract");
+        BOOST_REQUIRE( lua_isfunction(context.mState, -1) );
+        lua_pop(context.mState, 2);
+        BOOST_REQUIRE_EQUAL( 3, context.executeCode<int>("return string.len('abc')") );
+    }
+    
+    BOOST_TEST_MESSAGE( "--- Test same code consumes same drops in recycled contexts" );
+    string lua_code = "local t = {} for i = 1, 2000 do t[i] = setmetatable({ tostring(i) }, { __gc = function(o) end }) end t = nil local s = '' for i = 1, 500 do s = s .. i end";
+    long long used_drops = -1;
+    for(int i = 0; i < 3; i++) {
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
+        lua_enabledrops(context.mState, 1, 1);
+        lua_setdrops(context.mState, 10000000);
+        context.executeCode(lua_code.c_str());
+        long long used = 10000000 - lua_getdrops(context.mState);
+        if(used_drops >= 0)
+            BOOST_REQUIRE_EQUAL( used, used_drops );
+        used_drops = used;
+    }
+    
+    BOOST_TEST_MESSAGE( "--- Test contexts are not reused before hardfork 0.1" );
+    pool.set_reuse_contexts(false);
+    BOOST_REQUIRE_EQUAL( pool.idle_contexts(), 0 );
+    uint64_t created = pool.created_contexts();
+    for(int i = 0; i < 2; i++) {
+        pooled_lua_context pooled_context;
+        LuaContext& context = *pooled_context;
+        lua_enabledrops(context.mState, 1, 1);
+        lua_setdrops(context.mState, 10000000);
+        context.executeCode(lua_code.c_str());
+    }
+    BOOST_REQUIRE_EQUAL( pool.created_contexts(), created + 2 );
+    BOOST_REQUIRE_EQUAL( pool.idle_contexts(), 0 );
+    pool.set_reuse_contexts(true);
+    
+} FC_LOG_AND_RETHROW() }
+
+
+BOOST_AUTO_TEST_CASE( lua_prototype_cache )
+{ try {
+    LuaContext context;
+    lua_setpooled(context.mState, 1);
+    auto dump_code = [&](const string& code) {
+        vector<char> code_b;
+        BOOST_REQUIRE_EQUAL( luaL_loadstring(context.mState, code.c_str()), 0 );
+        lua_dump(context.mState, contract_test_case_lua_vm::compiling_contract_writer_test, &code_b, 0);
+        lua_pop(context.mState, 1);
+        return code_b;
+    };
+    auto run_code = [&](const vector<char>& code_b, bool cached, long long& used) {
+        lua_enabledrops(context.mState, 1, 1);
+        lua_setdrops(context.mState, 1000000);
+        int err = cached ? context.load_cached_chunk(1, code_b.data(), code_b.size(), "test") : luaL_loadbuffer(context.mState, code_b.data(), code_b.size(), "test");
+        BOOST_REQUIRE_EQUAL( err, 0 );
+        BOOST_REQUIRE_EQUAL( lua_pcall(context.mState, 0, 1, 0), 0 );
+        used = 1000000 - lua_getdrops(context.mState);
+        lua_enabledrops(context.mState, 0, 1);
+        return LuaContext::readTopAndPop<string>(context.mState, -1);
+    };
+    
+    BOOST_TEST_MESSAGE( "--- Test cached prototype consumes same drops as decoding" );
+    auto code_v1 = dump_code("local t = {} for i = 1, 10 do t[i] = function() return i end end return 'v1' .. #t");
+    long long fresh_used = 0, cached_used = 0;
+    BOOST_REQUIRE_EQUAL( run_code(code_v1, false, fresh_used), "v110" );
+    for(int i = 0; i < 3; i++) {
+        BOOST_REQUIRE_EQUAL( run_code(code_v1, true, cached_used), "v110" );
+        BOOST_REQUIRE_EQUAL( cached_used, fresh_used );
+    }
+    BOOST_REQUIRE( context.prototype_cache_size() > 0 );
+    
+    BOOST_TEST_MESSAGE( "--- Test revised code invalidates cached prototype" );
+    auto code_v2 = dump_code("return 'v2'");
+    BOOST_REQUIRE_EQUAL( run_code(code_v2, true, cached_used), "v2" );
+    BOOST_REQUIRE_EQUAL( run_code(code_v1, true, cached_used), "v110" );
+    BOOST_REQUIRE_EQUAL( cached_used, fresh_used );
+    
+    BOOST_TEST_MESSAGE( "--- Test memory cap evicts cached prototypes" );
+    context.set_prototype_cache_limit(0);
+    BOOST_REQUIRE_EQUAL( context.prototype_cache_size(), 0 );
+    BOOST_REQUIRE_EQUAL( run_code(code_v1, true, cached_used), "v110" );
+    BOOST_REQUIRE_EQUAL( cached_used, fresh_used );
+    
+    BOOST_TEST_MESSAGE( "--- Test evicted prototypes free their registry slots" );
+    context.set_prototype_cache_limit(LUACONTEXT_PROTOTYPE_CACHE_LIMIT);
+    BOOST_REQUIRE_EQUAL( run_code(code_v1, true, cached_used), "v110" );
+    context.set_prototype_cache_limit(context.prototype_cache_size());
+    for(int64_t code_id = 2; code_id <= 50; code_id++) {
+        BOOST_REQUIRE_EQUAL( context.load_cached_chunk(code_id, code_v1.data(), code_v1.size(), "test"), 0 );
+        lua_pop(context.mState, 1);
+    }
+    lua_Integer max_slot = 0;
+    lua_getfield(context.mState, LUA_REGISTRYINDEX, LUACONTEXT_PROTOTYPE_CACHE);
+    lua_pushnil(context.mState);
+    while(lua_next(context.mState, -2)) {
+        lua_pop(context.mState, 1);
+        max_slot = std::max(max_slot, lua_tointeger(context.mState, -1));
+    }
+    lua_pop(context.mState, 1);
+    BOOST_REQUIRE( max_slot < 10 );
+    
+    BOOST_TEST_MESSAGE( "--- Test unpooled context decodes every time" );
+    LuaContext fresh_context;
+    BOOST_REQUIRE_EQUAL( fresh_context.load_cached_chunk(1, code_v1.data(), code_v1.size(), "test"), 0 );
+    lua_pop(fresh_context.mState, 1);
+    BOOST_REQUIRE_EQUAL( fresh_context.prototype_cache_size(), 0 );
+    
+} FC_LOG_AND_RETHROW() }
+
+
+BOOST_AUTO_TEST_CASE( lua_sandbox_gc_policy )
+{ try {
+    auto run_in_sandbox = [](LuaContext& context, const string& code) {
+        lua_newtable(context.mState);
+        lua_setglobal(context.mState, "gc_log");
+        lua_newtable(context.mState);
+        lua_getglobal(context.mState, "setmetatable");
+        lua_setfield(context.mState, -2, "setmetatable");
+        lua_getglobal(context.mState, "gc_log");
+        lua_setfield(context.mState, -2, "log");
+        lua_setglobal(context.mState, "space");
+        
+        lua_enabledrops(context.mState, 1, 1);
+        lua_setdrops(context.mState, 1000000);
+        BOOST_REQUIRE( context.load_script_to_sandbox("space", code.c_str(), code.size()) );
+        BOOST_REQUIRE( context.close_sandbox("space") );
+        long long used = 1000000 - lua_getdrops(context.mState);
+        lua_enabledrops(context.mState, 0, 1);
+        lua_settop(context.mState, 0);
+        return used;
+    };
+    auto finalized = [](LuaContext& context) {
+        lua_getglobal(context.mState, "gc_log");
+        lua_getfield(context.mState, -1, "finalized");
+        bool ret = lua_toboolean(context.mState, -1);
+        lua_pop(context.mState, 2);
+        return ret;
+    };
+    string lua_code = "local t = {} for i = 1, 200 do t[i] = { tostring(i) } end";
+    string fin_code = "local t = setmetatable({}, { __gc = function(o) local s = 0 for i = 1, 100 do s = s + i end log.finalized = true end }) t = nil";
+    
+    BOOST_TEST_MESSAGE( "--- Test every policy consumes same drops" );
+    LuaContext::sandbox_gc_mode modes[] = { LuaContext::sandbox_gc_full, LuaContext::sandbox_gc_threshold, LuaContext::sandbox_gc_skip };
+    long long used_drops = -1, used_fin_drops = -1;
+    for(auto mode : modes) {
+        LuaContext context;
+        lua_setpooled(context.mState, 1);
+        context.set_sandbox_gc_policy(mode, 0, 8);
+        long long used = run_in_sandbox(context, lua_code);
+        if(used_drops >= 0)
+            BOOST_REQUIRE_EQUAL( used, used_drops );
+        used_drops = used;
+        
+        BOOST_TEST_MESSAGE( "--- Test pending finalizers always run in close_sandbox" );
+        used = run_in_sandbox(context, fin_code);
+        BOOST_REQUIRE( finalized(context) );
+        BOOST_REQUIRE_EQUAL( lua_gc(context.mState, LUA_GCMETEREDFIN, 0), 0 );
+        if(used_fin_drops >= 0)
+            BOOST_REQUIRE_EQUAL( used, used_fin_drops );
+        used_fin_drops = used;
+    }
+    
+    BOOST_TEST_MESSAGE( "--- Test single-call leases before hardfork 0.1 consume the drops of a fresh context" );
+    //和心跳一样在close_sandbox之后读drops，完整回收时缩栈和缩字符串表的内存都要计入
+    string heavy_code = "local t = {} for i = 1, 5000 do t[i] = 'key' .. i end t = nil "
+                        "local function f(n) if n == 0 then return 0 end return 1 + f(n - 1) end f(3000)";
+    auto& pool = lua_context_pool::instance();
+    pool.set_reuse_contexts(false);
+    for(int i = 0; i < 2; i++) {
+        LuaContext baseline_context;
+        long long baseline_used = run_in_sandbox(baseline_context, heavy_code);
+        
+        pooled_lua_context pooled_context;
+        LuaContext& context = pooled_context.single_call();
+        BOOST_REQUIRE_EQUAL( lua_getpooled(context.mState), 0 );
+        BOOST_REQUIRE_EQUAL( run_in_sandbox(context, heavy_code), baseline_used );
+    }
+    pool.set_reuse_contexts(true);
+    
+} FC_LOG_AND_RETHROW() }
+
+
+BOOST_AUTO_TEST_CASE( lua_block_metering )
+{ try {
+    string lua_code = "local function f(n) if n < 2 then return n end return f(n - 1) + f(n - 2) end "
+                      "local s = 0 for i = 1, 20 do if i % 3 == 0 then s = s + f(i % 7) elseif i % 3 == 1 then s = s - 1 else s = s + 2 end end "
+                      "local t = {} for k = 1, 5 do t[k] = k * 2 end local i = 0 while i < 5 do i = i + 1 if t[i] == 6 then break end end "
+                      "for k, v in ipairs(t) do s = s + v end return s";
+    auto run_with_drops = [&](long long drops, long long& left, bool block_metered) {
+        LuaContext context;
+        //只有池化的虚拟机加载时才按基本块计量
+        lua_setpooled(context.mState, block_metered ? 1 : 0);
+        BOOST_REQUIRE_EQUAL( luaL_loadstring(context.mState, lua_code.c_str()), 0 );
+        lua_setpooled(context.mState, 0);
+        lua_enabledrops(context.mState, 1, 1);
+        lua_setdrops(context.mState, drops);
+        try {
+            int status = lua_pcall(context.mState, 0, 1, 0);
+            left = lua_getdrops(context.mState);
+            lua_enabledrops(context.mState, 0, 1);
+            return status == LUA_OK && left >= 0;
+        }
+        catch(const LuaContext::VMcollapseErrorException&) {
+            lua_enabledrops(context.mState, 0, 1);
+            return false;
+        }
+    };
+    
+    BOOST_TEST_MESSAGE( "--- Test contract runs out of drops at exactly the same point as per-instruction metering" );
+    long long left = 0;
+    BOOST_REQUIRE( run_with_drops(1000000, left, false) );
+    long long used = 1000000 - left;
+    BOOST_REQUIRE( run_with_drops(1000000, left, true) );
+    BOOST_REQUIRE_EQUAL( 1000000 - left, used );
+    for(long long drops = 0; drops < used; drops++)
+        BOOST_REQUIRE( !run_with_drops(drops, left, true) );
+    BOOST_REQUIRE( run_with_drops(used, left, true) );
+    BOOST_REQUIRE_EQUAL( left, 0 );
+    
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( lua_block_metering_gc )
+{ try {
+    //大量分配和终结，回收时机一变drops就会不同
+    string lua_code = "local t = {} for i = 1, 20000 do t[i] = { i, i * 2 } end t = nil "
+                      "local function f(n) if n == 0 then return 0 end return 1 + f(n - 1) end f(3000) "
+                      "local u = {} for i = 1, 3000 do u[i] = setmetatable({}, { __gc = function(o) end }) end u = nil "
+                      "local c = {} for i = 1, 5000 do c[i] = function() return i end end c = nil "
+                      "return collectgarbage('count')";
+    auto run = [&](bool block_metered, long long& left, double& count) {
+        LuaContext context;
+        lua_setpooled(context.mState, block_metered ? 1 : 0);
+        BOOST_REQUIRE_EQUAL( luaL_loadstring(context.mState, lua_code.c_str()), 0 );
+        lua_setpooled(context.mState, 0);
+        lua_enabledrops(context.mState, 1, 1);
+        lua_setdrops(context.mState, 100000000000LL);
+        BOOST_REQUIRE_EQUAL( lua_pcall(context.mState, 0, 1, 0), LUA_OK );
+        left = lua_getdrops(context.mState);
+        lua_enabledrops(context.mState, 0, 1);
+        count = lua_tonumber(context.mState, -1);
+    };
+    
+    BOOST_TEST_MESSAGE( "--- Test block metering data does not change collection timing or drops" );
+    long long per_instruction_left = 0, block_left = 0;
+    double per_instruction_count = 0, block_count = 0;
+    run(false, per_instruction_left, per_instruction_count);
+    run(true, block_left, block_count);
+    BOOST_REQUIRE_EQUAL( block_left, per_instruction_left );
+    BOOST_REQUIRE_EQUAL( block_count, per_instruction_count );
+    
+} FC_LOG_AND_RETHROW() }
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -13,6 +13,7 @@
 #include <chain/account_object.hpp>
 #include <chain/contract_objects.hpp>
 #include <chain/nfa_objects.hpp>
+#include <chain/tick_schedule_object.hpp>
 
 #include <chain/lua_context.hpp>
 
@@ -21,6 +22,7 @@
 
 #include "../db_fixture/database_fixture.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <stdexcept>
@@ -696,8 +698,8 @@ BOOST_AUTO_TEST_CASE( heart_beat )
     db_plugin->debug_update( [&]( database& db ) {
         db.modify( *nfa, [&](nfa_object& obj) {
             obj.qi += asset(5000000, QI_SYMBOL);
-            obj.next_tick_time = time_point_sec::min(); //激活
         });
+        db.schedule_nfa_tick( *nfa, time_point_sec::min() ); //激活
         db.modify( db.get_dynamic_global_properties(), [&](dynamic_global_property_object& obj) {
             obj.current_supply += asset(5000, YANG_SYMBOL);
             obj.total_qi += asset(5000000, QI_SYMBOL);
@@ -718,9 +720,7 @@ BOOST_AUTO_TEST_CASE( heart_beat )
         //激活
         generate_block(); //REVIEW: 如果没有这句，后面debug_updata不会进入
         db_plugin->debug_update( [&]( database& db ) {
-            db.modify( *nfa, [&]( nfa_object& obj ) {
-                obj.next_tick_time = time_point_sec::min();
-            });
+            db.schedule_nfa_tick( *nfa, time_point_sec::min() );
         });
         generate_block(); //beat
 
@@ -733,6 +733,12 @@ BOOST_AUTO_TEST_CASE( heart_beat )
             idump( (old_mana)(nfa->qi.amount) );
             BOOST_CHECK_EQUAL( nfa->qi.amount.value, old_mana - used_mana );
             BOOST_REQUIRE( nfa->next_tick_time == (db->head_block_time() + TAIYI_NFA_TICK_PERIOD_MAX_BLOCK_NUM * TAIYI_BLOCK_INTERVAL) );
+            
+            //心跳后改期登记到时间轮的下一个桶，已处理的桶被删除
+            BOOST_REQUIRE( db->find< tick_schedule_object, by_tick_time >( boost::make_tuple( NFA_TICK, time_point_sec::min() ) ) == nullptr );
+            const auto* bucket = db->find< tick_schedule_object, by_tick_time >( boost::make_tuple( NFA_TICK, nfa->next_tick_time ) );
+            BOOST_REQUIRE( bucket != nullptr );
+            BOOST_REQUIRE( std::find( bucket->entities.begin(), bucket->entities.end(), nfa->id._id ) != bucket->entities.end() );
         }
     }
     
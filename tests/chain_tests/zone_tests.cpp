@@ -0,0 +1,144 @@
+#include <boost/test/unit_test.hpp>
+
+#include <chain/taiyi_fwd.hpp>
+
+#include <protocol/exceptions.hpp>
+#include <protocol/hardfork.hpp>
+
+#include <chain/database.hpp>
+#include <chain/database_exceptions.hpp>
+#include <chain/taiyi_objects.hpp>
+#include <chain/zone_objects.hpp>
+#include <chain/contract_objects.hpp>
+
+#include <fc/macros.hpp>
+#include <fc/crypto/digest.hpp>
+
+#include "../db_fixture/database_fixture.hpp"
+#include "../undo_data/undo.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+using namespace taiyi;
+using namespace taiyi::chain;
+using namespace taiyi::protocol;
+using std::string;
+
+BOOST_FIXTURE_TEST_SUITE( zone_tests, clean_database_fixture )
+
+BOOST_AUTO_TEST_CASE( zone_route )
+{
+    try
+    {
+        BOOST_TEST_MESSAGE( "--- Testing: zone_route" );
+        
+        auto create_zone = [&]( const string& name, E_ZONE_TYPE type, int64_t nfa_id ) -> const zone_object& {
+            return db->create< zone_object >( [&]( zone_object& obj ) {
+                obj.name = name;
+                obj.type = type;
+                obj.nfa_id = nfa_id;
+            });
+        };
+        auto connect = [&]( const zone_object& from, const zone_object& to ) {
+            db->create< zone_connect_object >( [&]( zone_connect_object& obj ) {
+                obj.from = from.id;
+                obj.to = to.id;
+            });
+        };
+        
+        //a->b->d 经过的区域少，a->c->e->d 移动天数少
+        const auto& za = create_zone( "route_a", YUANYE, 100001 );
+        const auto& zb = create_zone( "route_b", SHANYUE, 100002 );
+        const auto& zc = create_zone( "route_c", YUANYE, 100003 );
+        const auto& zd = create_zone( "route_d", YUANYE, 100004 );
+        const auto& ze = create_zone( "route_e", YUANYE, 100005 );
+        connect( za, zb );
+        connect( zb, zd );
+        connect( za, zc );
+        connect( zc, ze );
+        connect( ze, zd );
+        
+        typedef std::vector< zone_id_type > route_type;
+        BOOST_REQUIRE( db->find_zone_route( za, zd, false ) == route_type({ zb.id, zd.id }) );
+        BOOST_REQUIRE( db->find_zone_route( za, zd, true ) == route_type({ zc.id, ze.id, zd.id }) );
+        BOOST_REQUIRE( db->find_zone_route( zd, za, false ).empty() );
+        BOOST_REQUIRE( db->find_zone_route( za, za, false ).empty() );
+        
+        BOOST_TEST_MESSAGE( "--- Connection reverted by undo" );
+        undo_db udb( *db );
+        udb.undo_begin();
+        connect( za, zd );
+        BOOST_REQUIRE( db->find_zone_route( za, zd, false ) == route_type({ zd.id }) );
+        BOOST_REQUIRE( db->find_zone_route( za, zd, true ) == route_type({ zd.id }) );
+        udb.undo_end();
+        BOOST_REQUIRE( db->find_zone_route( za, zd, false ) == route_type({ zb.id, zd.id }) );
+        BOOST_REQUIRE( db->find_zone_route( za, zd, true ) == route_type({ zc.id, ze.id, zd.id }) );
+        
+        BOOST_TEST_MESSAGE( "--- Zone type changes moving days" );
+        db->change_zone_type( zb, YUANYE );
+        BOOST_REQUIRE( db->find_zone_route( za, zd, true ) == route_type({ zb.id, zd.id }) );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( contract_find_way_to_zone )
+{
+    try
+    {
+        BOOST_TEST_MESSAGE( "--- Testing: contract_find_way_to_zone" );
+        
+        ACTORS( (alice) )
+        vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+        generate_block();
+        
+        signed_transaction tx;
+        auto push = [&]( const operation& op ) {
+            tx.operations.clear();
+            tx.signatures.clear();
+            tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+            tx.operations.push_back( op );
+            sign( tx, alice_private_key );
+            db->push_transaction( tx, 0 );
+        };
+        
+        create_contract_operation cop;
+        cop.owner = "alice";
+        cop.name = "contract.route";
+        cop.data = "function way() \n \
+                        local w = contract_helper:find_way_to_zone('way_a', 'way_c', false) \n \
+                        contract_helper:write_contract_data({hops = #w}, {hops = true}) \n \
+                    end";
+        push( cop );
+        generate_block();
+        
+        const auto& za = db->create< zone_object >( [&]( zone_object& obj ) { obj.name = "way_a"; obj.type = YUANYE; obj.nfa_id = 100011; });
+        const auto& zb = db->create< zone_object >( [&]( zone_object& obj ) { obj.name = "way_b"; obj.type = YUANYE; obj.nfa_id = 100012; });
+        const auto& zc = db->create< zone_object >( [&]( zone_object& obj ) { obj.name = "way_c"; obj.type = YUANYE; obj.nfa_id = 100013; });
+        db->create< zone_connect_object >( [&]( zone_connect_object& obj ) { obj.from = za.id; obj.to = zb.id; });
+        db->create< zone_connect_object >( [&]( zone_connect_object& obj ) { obj.from = zb.id; obj.to = zc.id; });
+        
+        call_contract_function_operation op;
+        op.caller = "alice";
+        op.contract_name = "contract.route";
+        op.function_name = "way";
+        
+        BOOST_TEST_MESSAGE( "--- Contract routing fails before hardfork 0.1" );
+        const auto& hardforks = db->get_hardfork_property_object();
+        auto processed_hardforks = hardforks.processed_hardforks;
+        db->modify( hardforks, [&]( hardfork_property_object& hpo ) { hpo.processed_hardforks.resize( TAIYI_HARDFORK_0_1 ); } );
+        BOOST_REQUIRE( !db->has_hardfork( TAIYI_HARDFORK_0_1 ) );
+        BOOST_REQUIRE_THROW( push( op ), fc::exception );
+        db->modify( hardforks, [&]( hardfork_property_object& hpo ) { hpo.processed_hardforks = processed_hardforks; } );
+        
+        BOOST_TEST_MESSAGE( "--- Contract routing works after hardfork 0.1" );
+        push( op );
+        const auto& contract = db->get< contract_object, by_name >( "contract.route" );
+        const auto& hops = db->get< contract_data_object, by_contract_key >( boost::make_tuple( contract.id, lua_key( lua_string( "hops" ) ) ) );
+        BOOST_REQUIRE( hops.value.get< lua_int >().v == 2 );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
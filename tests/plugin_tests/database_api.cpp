@@ -0,0 +1,84 @@
+#include <boost/test/unit_test.hpp>
+
+#include <chain/account_object.hpp>
+#include <chain/actor_objects.hpp>
+#include <chain/nfa_objects.hpp>
+#include <chain/zone_objects.hpp>
+#include <chain/population_stats_object.hpp>
+#include <protocol/taiyi_operations.hpp>
+#include <plugins/database_api/database_api.hpp>
+#include <plugins/database_api/database_api_plugin.hpp>
+
+#include "../db_fixture/database_fixture.hpp"
+
+using namespace taiyi::chain;
+using namespace taiyi::protocol;
+using namespace taiyi::plugins::database_api;
+
+BOOST_FIXTURE_TEST_SUITE( database_api_tests, json_rpc_database_fixture )
+
+BOOST_AUTO_TEST_CASE( get_population_stats_after_undo )
+{
+    try
+    {
+        BOOST_TEST_MESSAGE( "Testing: get_population_stats_after_undo" );
+        
+        ACTORS( (alice) )
+        generate_block();
+        
+        auto& api = *appbase::app().get_plugin< database_api_plugin >().api;
+        
+        const auto& zone = db->create< zone_object >( [&]( zone_object& obj ) {
+            obj.name = "population_zone";
+            obj.type = YUANYE;
+            obj.nfa_id = 300001;
+        });
+        
+        get_population_stats_args world_args;
+        get_population_stats_args zone_args;
+        zone_args.zone = "population_zone";
+        
+        auto world_before = api.get_population_stats( world_args, true );
+        auto zone_before = api.get_population_stats( zone_args, true );
+        BOOST_REQUIRE( zone_before.zone == zone.id );
+        BOOST_REQUIRE_EQUAL( zone_before.living, 0u );
+        
+        {
+            auto session = db->start_undo_session();
+            
+            const auto& nfa = db->create< nfa_object >( [&]( nfa_object& obj ) {
+                obj.creator_account = alice.id;
+                obj.owner_account = alice.id;
+                obj.active_account = alice.id;
+            });
+            const auto& act = db->create< actor_object >( [&]( actor_object& obj ) {
+                obj.name = "population_actor";
+                obj.nfa_id = nfa.id;
+            });
+            db->initialize_actor_talents( act );
+            db->adjust_population_stats( act, 1 );
+            db->born_actor( act, 1, 1, zone );
+            
+            auto world = api.get_population_stats( world_args, true );
+            BOOST_REQUIRE_EQUAL( world.living, world_before.living + 1 );
+            BOOST_REQUIRE_EQUAL( world.living_by_zone_type[YUANYE], world_before.living_by_zone_type[YUANYE] + 1 );
+            BOOST_REQUIRE_EQUAL( api.get_population_stats( zone_args, true ).living, 1u );
+            
+            session.undo();
+        }
+        
+        auto world_after = api.get_population_stats( world_args, true );
+        BOOST_REQUIRE_EQUAL( world_after.living, world_before.living );
+        BOOST_REQUIRE_EQUAL( world_after.dead, world_before.dead );
+        BOOST_REQUIRE( world_after.living_by_zone_type == world_before.living_by_zone_type );
+        BOOST_REQUIRE( world_after.living_by_age == world_before.living_by_age );
+        
+        auto zone_after = api.get_population_stats( zone_args, true );
+        BOOST_REQUIRE( zone_after.zone == zone.id );
+        BOOST_REQUIRE_EQUAL( zone_after.living, 0u );
+        BOOST_REQUIRE_EQUAL( zone_after.dead, 0u );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()